@@ -0,0 +1,222 @@
+/**
+  ******************************************************************************
+  * @file    accel_fixed.c
+  * @brief   Weight-resident accelerator : LOAD writes the parameters into
+  *          local storage once, INFER moves only the image and the logits
+  *          and streams FC1 from DDR by tiles
+  *          (+ CPU emulation of the protocol with byte counts)
+  * @note    Designed for Vivado HLS synthesis ; la partie émulation est
+  *          CPU only.
+  ******************************************************************************
+  */
+
+#include "lenet_cnn_fixed_point.h"
+
+
+/**************************************
+ *  MEMOIRE LOCALE DE L'ACCELERATEUR
+ *  Variables statiques : BRAM en HLS, conservées d'un appel à l'autre.
+ *  FC1_KERNEL (250 BRAM18) n'y est pas : avec lui les paramètres seuls
+ *  prendraient 279 des 280 BRAM18 du Zynq-7020. Il reste en DDR et
+ *  Fc1_40_400_fixed_tiled le lit par tuiles à chaque INFER.
+ *
+ *  Budget BRAM18 (1K x 16, un bloc au moins par tableau) :
+ *    paramètres résidents  conv1 2, conv2 21, fc1_b 1, fc2 5   = 29
+ *    activations           conv1_out 12, pool1 3, conv2_out 3,
+ *                          pool2 1, fc1_out 1                  = 20
+ *    tuiles FC1            ping + pong, 4 bancs chacun         = 24
+ *    image (copie sdscc)                                       =  1
+ *    total                                                     = 74 / 280
+ **************************************/
+static short acc_conv1_k[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM];
+static short acc_conv1_b[CONV1_NBOUTPUT];
+static short acc_conv2_k[CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM];
+static short acc_conv2_b[CONV2_NBOUTPUT];
+static short acc_fc1_b  [FC1_NBOUTPUT];
+static short acc_fc2_k  [FC2_NBOUTPUT][FC1_NBOUTPUT];
+static short acc_fc2_b  [FC2_NBOUTPUT];
+
+
+/* Copie séquentielle (burst AXI) de n mots de src vers dst */
+static void accel_copy(short *dst, const short *src, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+LENET_PRAGMA(HLS PIPELINE II=1)
+        dst[i] = src[i];
+    }
+}
+
+
+/* lenet_cnn_fixed() sur les poids locaux, FC1 par tuiles depuis la DDR */
+static void accel_infer(
+        short  input   [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short  fc1_k   [FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short  out     [FC2_NBOUTPUT])
+{
+    short conv1_out[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH];
+    short pool1_out[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH];
+    short conv2_out[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH];
+    short pool2_out[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH];
+    short fc1_out[FC1_NBOUTPUT];
+
+    Conv1_28x28x1_5x5x20_1_0_fixed(input, acc_conv1_k, acc_conv1_b, conv1_out);
+    Pool1_24x24x20_2x2x20_2_0_fixed(conv1_out, pool1_out);
+    Conv2_12x12x20_5x5x40_1_0_fixed(pool1_out, acc_conv2_k, acc_conv2_b, conv2_out);
+    Pool2_8x8x40_2x2x40_2_0_fixed(conv2_out, pool2_out);
+    Fc1_40_400_fixed_tiled(pool2_out, fc1_k, acc_fc1_b, fc1_out);
+    Fc2_400_10_fixed(fc1_out, acc_fc2_k, acc_fc2_b, out);
+}
+
+
+/**************************************
+ *  TOP LEVEL
+ *  LOAD  : params (LENET_PARAM_WORDS mots) → mémoire locale, input ignoré
+ *  INFER : accel_infer() sur les poids locaux et fc1_k (DDR), params ignoré
+ **************************************/
+void lenet_accel(
+        int    cmd,
+        short *params,
+        int    nparams,
+        short  fc1_k   [FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short  input   [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short  out     [FC2_NBOUTPUT])
+{
+LENET_PRAGMA(HLS INTERFACE s_axilite port=return bundle=CTRL)
+LENET_PRAGMA(HLS INTERFACE s_axilite port=cmd bundle=CTRL)
+LENET_PRAGMA(HLS INTERFACE s_axilite port=nparams bundle=CTRL)
+LENET_PRAGMA(HLS INTERFACE m_axi port=params offset=slave depth=LENET_PARAM_WORDS)
+LENET_PRAGMA(HLS INTERFACE m_axi port=fc1_k offset=slave depth=LENET_PW_FC1_K bundle=FC1)
+
+    if (cmd == LENET_ACCEL_LOAD) {
+        const short *p = params;
+
+        if (nparams != LENET_PARAM_WORDS)
+            return;
+
+        accel_copy(&acc_conv1_k[0][0][0][0], p, LENET_PW_CONV1_K);   p += LENET_PW_CONV1_K;
+        accel_copy(acc_conv1_b,              p, CONV1_NBOUTPUT);     p += CONV1_NBOUTPUT;
+        accel_copy(&acc_conv2_k[0][0][0][0], p, LENET_PW_CONV2_K);   p += LENET_PW_CONV2_K;
+        accel_copy(acc_conv2_b,              p, CONV2_NBOUTPUT);     p += CONV2_NBOUTPUT;
+        accel_copy(acc_fc1_b,                p, FC1_NBOUTPUT);       p += FC1_NBOUTPUT;
+        accel_copy(&acc_fc2_k[0][0],         p, LENET_PW_FC2_K);     p += LENET_PW_FC2_K;
+        accel_copy(acc_fc2_b,                p, FC2_NBOUTPUT);
+        return;
+    }
+
+    accel_infer(input, fc1_k, out);
+}
+
+
+#ifndef __SYNTHESIS__
+
+#include <stdio.h>
+#include <string.h>
+
+
+/**************************************
+ *  EMULATION DU PROTOCOLE (CPU)
+ **************************************/
+void lenet_accel_pack_params(const lenet_weights_t *w, short params[LENET_PARAM_WORDS])
+{
+    short *p = params;
+
+    memcpy(p, w->conv1_k, LENET_PW_CONV1_K * sizeof(short));  p += LENET_PW_CONV1_K;
+    memcpy(p, w->conv1_b, CONV1_NBOUTPUT   * sizeof(short));  p += CONV1_NBOUTPUT;
+    memcpy(p, w->conv2_k, LENET_PW_CONV2_K * sizeof(short));  p += LENET_PW_CONV2_K;
+    memcpy(p, w->conv2_b, CONV2_NBOUTPUT   * sizeof(short));  p += CONV2_NBOUTPUT;
+    memcpy(p, w->fc1_b,   FC1_NBOUTPUT     * sizeof(short));  p += FC1_NBOUTPUT;
+    memcpy(p, w->fc2_k,   LENET_PW_FC2_K   * sizeof(short));  p += LENET_PW_FC2_K;
+    memcpy(p, w->fc2_b,   FC2_NBOUTPUT     * sizeof(short));
+}
+
+
+/* Arguments inutilisés par une commande : buffers valides quand même,
+   le data mover de sdscc transfère chaque tableau quelle que soit la commande */
+static short accel_idle_params[1];
+static short accel_idle_input[IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH];
+static short accel_idle_out[FC2_NBOUTPUT];
+
+void lenet_accel_emu_load(lenet_accel_stats_t *st, short params[LENET_PARAM_WORDS],
+                          short fc1_k[FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH])
+{
+    lenet_accel(LENET_ACCEL_LOAD, params, LENET_PARAM_WORDS, fc1_k, accel_idle_input, accel_idle_out);
+
+    st->load_bytes += (LENET_PARAM_WORDS + IMG_DEPTH * IMG_HEIGHT * IMG_WIDTH + FC2_NBOUTPUT) * sizeof(short);
+    st->loads++;
+}
+
+
+void lenet_accel_emu_infer(lenet_accel_stats_t *st,
+                           short fc1_k[FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+                           short input[IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+                           short out[FC2_NBOUTPUT])
+{
+    lenet_accel(LENET_ACCEL_INFER, accel_idle_params, 0, fc1_k, input, out);
+
+    st->in_bytes  += IMG_DEPTH * IMG_HEIGHT * IMG_WIDTH * sizeof(short);
+    st->out_bytes += FC2_NBOUTPUT * sizeof(short);
+    st->fc1_bytes += LENET_PW_FC1_K * sizeof(short);
+    st->infers++;
+}
+
+
+unsigned int lenet_accel_eval(const lenet_weights_t *w, lenet_load_fn load, void *load_arg,
+                              const unsigned char *labels, int n, lenet_accel_stats_t *st)
+{
+    static short params[LENET_PARAM_WORDS];
+    unsigned char buf[IMG_WIDTH * IMG_HEIGHT];
+    short input[IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH];
+    short logits[FC2_NBOUTPUT], ref[FC2_NBOUTPUT];
+    unsigned int errors = 0;
+    int i;
+
+    memset(st, 0, sizeof(*st));
+
+    lenet_accel_pack_params(w, params);
+    lenet_accel_emu_load(st, params, w->fc1_k);
+
+    for (i = 0; i < n; i++) {
+        NormalizeImg_fixed(load(load_arg, i, buf), (short*)input, IMG_WIDTH, IMG_HEIGHT);
+        lenet_accel_emu_infer(st, w->fc1_k, input, logits);
+
+        /* référence Q8 : mêmes poids, lenet_cnn_fixed() sur CPU */
+        lenet_cnn_fixed(input, w->conv1_k, w->conv1_b, w->conv2_k, w->conv2_b,
+                        w->fc1_k, w->fc1_b, w->fc2_k, w->fc2_b, ref);
+        if (Argmax_fixed(ref, 0) != labels[i])
+            st->ref_errors++;
+        if (memcmp(logits, ref, sizeof(ref)) != 0)
+            st->mismatches++;
+
+        if (Argmax_fixed(logits, 0) != labels[i])
+            errors++;
+    }
+    return errors;
+}
+
+
+void lenet_accel_report(const lenet_accel_stats_t *st)
+{
+    /* lenet_cnn_fixed() en top : les 8 tableaux de poids + image + logits à chaque appel */
+    double legacy = (double)(LENET_PARAM_WORDS + LENET_PW_FC1_K + IMG_DEPTH * IMG_HEIGHT * IMG_WIDTH +
+                             FC2_NBOUTPUT) * sizeof(short);
+    double per_img, copied, total;
+
+    if (!st->infers)
+        return;
+    per_img = (double)(st->in_bytes + st->out_bytes) / st->infers;
+    copied  = per_img + (double)st->load_bytes / st->infers;
+    total   = copied + (double)st->fc1_bytes / st->infers;
+
+    printf("\nWeight-resident accelerator (%u image(s), %u load(s))\n", st->infers, st->loads);
+    printf("  LOAD     : %llu bytes of parameters (FC1 kernel excluded) and idle image / logits, once\n", st->load_bytes);
+    printf("  INFER    : %.0f bytes / image copied (in %llu + out %llu in total), + %.0f bytes / image of FC1 read from DDR (m_axi)\n",
+           per_img, st->in_bytes, st->out_bytes, (double)st->fc1_bytes / st->infers);
+    printf("  amortized: %.1f bytes / image copied, vs %.0f bytes / image when lenet_cnn_fixed() gets the weights each call (%.0fx less)\n",
+           copied, legacy, legacy / copied);
+    printf("             %.1f bytes / image with the FC1 stream (%.2fx less)\n",
+           total, legacy / total);
+}
+
+#endif
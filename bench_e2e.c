@@ -0,0 +1,425 @@
+/**
+  ******************************************************************************
+  * @file    bench_e2e.c
+  * @brief   End-to-end benchmark : images/s, per-image latency percentiles
+  *          and accuracy on the MNIST test set, swept over thread counts
+  *          and batch sizes, with JSON output
+  * @note    gcc -O2 -DLENET_NO_MAIN -o bench_e2e bench_e2e.c
+  *              lenet_cnn_fixed_point.c lenet_ctx.c conv_fixed.c conv_simd.c
+  *              conv_gemm.c conv_int8.c pool_fixed.c pool_int8.c fc_fixed.c
+  *              fc_int8.c packed_fixed.c sparse_fixed.c csr_fixed.c
+  *              lowrank_fixed.c codebook_fixed.c stream_fixed.c quant_int8.c
+  *              tiled_fixed.c utils_fixed.c mnist_idx.c -lm -lpthread
+  *          ./bench_e2e --threads 1,2,4 --batch 1,8,32 --json e2e.json
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "lenet_cnn_fixed_point.h"
+
+
+#define E2E_MAX_SWEEP   16
+#define E2E_HIST_BINS   24      // latence : cases log2 en µs, [2^(k-1), 2^k)
+
+
+/**************************************
+ *  UNE CONFIGURATION (threads x batch)
+ *  Les images sont distribuées par paquets de `batch` (compteur
+ *  atomique). Moteur "top" : lenet_cnn_fixed() pour batch = 1,
+ *  lenet_cnn_fixed_batch() sinon ; "stream" : lenet_cnn_fixed_stream(),
+ *  batch = 1 (C-simulation des FIFOs). Autres moteurs : lenet_ctx_run() avec
+ *  le backend de convolution choisi, batch = 1.
+ *  Latence d'une image = lecture + normalisation + inférence de son
+ *  paquet (toutes les images d'un paquet sortent ensemble).
+ **************************************/
+
+typedef struct {
+    const lenet_weights_t *w;
+    const lenet_ctx_t     *proto;       // NULL : moteur top
+    int                    stream;      // moteur top en flux (DATAFLOW)
+    lenet_load_fn          load;
+    void                  *load_arg;
+    const unsigned char   *labels;
+    int                    n;
+    int                    batch;
+    int                    next;
+    double                *lat_ns;      // une case par image
+} e2e_run_t;
+
+typedef struct {
+    e2e_run_t    *r;
+    unsigned int  errors;
+} e2e_worker_t;
+
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static void *e2e_worker(void *p)
+{
+    e2e_worker_t *wk = (e2e_worker_t*)p;
+    e2e_run_t *r = wk->r;
+    const lenet_weights_t *w = r->w;
+    unsigned char buf[IMG_WIDTH * IMG_HEIGHT];
+    lenet_ctx_t ctx;
+    int j;
+
+    short (*in)[IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH] = malloc(r->batch * sizeof(*in));
+    short (*out)[FC2_NBOUTPUT]                    = malloc(r->batch * sizeof(*out));
+    if (!in || !out) {
+        printf("ERROR: out of memory\n");
+        exit(1);
+    }
+    if (r->proto)
+        ctx = *r->proto;
+
+    while (1) {
+        int i0 = __sync_fetch_and_add(&r->next, r->batch);
+        if (i0 >= r->n) break;
+        int nb = (r->n - i0 < r->batch) ? r->n - i0 : r->batch;
+        int pred[nb];
+
+        double t0 = now_ns();
+
+        if (r->proto) {
+            NormalizeImg_fixed(r->load(r->load_arg, i0, buf), (short*)ctx.input, IMG_WIDTH, IMG_HEIGHT);
+            pred[0] = lenet_ctx_run(&ctx);
+        } else {
+            for (j = 0; j < nb; j++)
+                NormalizeImg_fixed(r->load(r->load_arg, i0 + j, buf), (short*)in[j], IMG_WIDTH, IMG_HEIGHT);
+
+            if (r->stream)
+                lenet_cnn_fixed_stream(in[0], w->conv1_k, w->conv1_b, w->conv2_k, w->conv2_b,
+                                       w->fc1_k, w->fc1_b, w->fc2_k, w->fc2_b, out[0]);
+            else if (nb == 1)
+                lenet_cnn_fixed(in[0], w->conv1_k, w->conv1_b, w->conv2_k, w->conv2_b,
+                                w->fc1_k, w->fc1_b, w->fc2_k, w->fc2_b, out[0]);
+            else
+                lenet_cnn_fixed_batch(nb, in, w->conv1_k, w->conv1_b, w->conv2_k, w->conv2_b,
+                                      w->fc1_k, w->fc1_b, w->fc2_k, w->fc2_b, out);
+
+            for (j = 0; j < nb; j++)
+                pred[j] = Argmax_fixed(out[j], 0);
+        }
+
+        double dt = now_ns() - t0;
+
+        for (j = 0; j < nb; j++) {
+            r->lat_ns[i0 + j] = dt;
+            if (pred[j] != r->labels[i0 + j])
+                wk->errors++;
+        }
+    }
+
+    free(in);
+    free(out);
+    return NULL;
+}
+
+
+/* Lance nthreads workers (le thread appelant est le worker 0), renvoie les erreurs */
+static unsigned int e2e_pass(e2e_run_t *r, int nthreads)
+{
+    e2e_worker_t wk[nthreads];
+    pthread_t    tid[nthreads];
+    unsigned int errors = 0;
+    int t;
+
+    r->next = 0;
+    for (t = 0; t < nthreads; t++) {
+        wk[t].r = r;
+        wk[t].errors = 0;
+    }
+    for (t = 1; t < nthreads; t++) {
+        if (pthread_create(&tid[t], NULL, e2e_worker, &wk[t]) != 0) {
+            printf("ERROR: pthread_create failed\n");
+            exit(1);
+        }
+    }
+    e2e_worker(&wk[0]);
+
+    for (t = 1; t < nthreads; t++)
+        pthread_join(tid[t], NULL);
+    for (t = 0; t < nthreads; t++)
+        errors += wk[t].errors;
+
+    return errors;
+}
+
+
+/**************************************
+ *  STATISTIQUES
+ **************************************/
+
+typedef struct {
+    int          threads, batch, n;
+    unsigned int errors;
+    double       wall_s;
+    double       mean, p50, p90, p99, p999, max;        // µs
+    unsigned int hist[E2E_HIST_BINS];
+} e2e_result_t;
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Rang le plus proche : plus petite valeur dont la part cumulée >= p */
+static double percentile(const double *sorted, int n, double p)
+{
+    int k = (int)(p * n + 0.999999);
+    if (k < 1) k = 1;
+    if (k > n) k = n;
+    return sorted[k - 1];
+}
+
+static void e2e_stats(e2e_result_t *res, double *lat_ns, int n)
+{
+    double sum = 0.0;
+    int i, b;
+
+    memset(res->hist, 0, sizeof(res->hist));
+    for (i = 0; i < n; i++) {
+        lat_ns[i] *= 1e-3;
+        sum += lat_ns[i];
+        for (b = 0; b < E2E_HIST_BINS - 1 && lat_ns[i] >= (double)(1 << b); b++)
+            ;
+        res->hist[b]++;
+    }
+    qsort(lat_ns, n, sizeof(double), cmp_double);
+
+    res->mean = sum / n;
+    res->p50  = percentile(lat_ns, n, 0.50);
+    res->p90  = percentile(lat_ns, n, 0.90);
+    res->p99  = percentile(lat_ns, n, 0.99);
+    res->p999 = percentile(lat_ns, n, 0.999);
+    res->max  = lat_ns[n - 1];
+}
+
+
+static int parse_list(const char *s, int *v, int max)
+{
+    int n = 0;
+
+    while (*s && n < max) {
+        v[n] = atoi(s);
+        if (v[n] < 1) {
+            printf("ERROR: bad list value in '%s'\n", s);
+            exit(1);
+        }
+        n++;
+        s = strchr(s, ',');
+        if (!s) break;
+        s++;
+    }
+    return n;
+}
+
+
+static void e2e_json(const char *filename, const char *images, const char *engine,
+                     const e2e_result_t *res, int nres)
+{
+    FILE *f = fopen(filename, "w");
+    int i, b;
+
+    if (!f) {
+        printf("ERROR: Could not open %s\n", filename);
+        return;
+    }
+
+    fprintf(f, "{\n  \"build\": {\"compiler\": \"%s\", \"simd\": \"%s\", \"date\": \"%s %s\"},\n",
+            __VERSION__, lenet_simd_isa(), __DATE__, __TIME__);
+    fprintf(f, "  \"dataset\": \"%s\",\n  \"engine\": \"%s\",\n  \"runs\": [\n", images, engine);
+
+    for (i = 0; i < nres; i++) {
+        const e2e_result_t *r = &res[i];
+
+        fprintf(f, "    {\"threads\": %d, \"batch\": %d, \"images\": %d, \"errors\": %u, "
+                   "\"accuracy\": %.4f, \"wall_s\": %.6f, \"images_per_s\": %.1f,\n",
+                r->threads, r->batch, r->n, r->errors,
+                1.0 - (double)r->errors / r->n, r->wall_s, r->n / r->wall_s);
+        fprintf(f, "     \"latency_us\": {\"mean\": %.2f, \"p50\": %.2f, \"p90\": %.2f, "
+                   "\"p99\": %.2f, \"p99.9\": %.2f, \"max\": %.2f},\n",
+                r->mean, r->p50, r->p90, r->p99, r->p999, r->max);
+        fprintf(f, "     \"histogram_us\": [");
+        int first = 1;
+        for (b = 0; b < E2E_HIST_BINS; b++) {
+            if (!r->hist[b]) continue;
+            if (b < E2E_HIST_BINS - 1)
+                fprintf(f, "%s{\"lt\": %d, \"count\": %u}", first ? "" : ", ", 1 << b, r->hist[b]);
+            else
+                fprintf(f, "%s{\"lt\": null, \"count\": %u}", first ? "" : ", ", r->hist[b]);
+            first = 0;
+        }
+        fprintf(f, "]}%s\n", (i + 1 < nres) ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+
+    printf("\nJSON written to %s\n", filename);
+}
+
+
+int main(int argc, char **argv)
+{
+    const char *images = "mnist/t10k-images-idx3-ubyte";
+    const char *labels_file = "mnist/t10k-labels-idx1-ubyte";
+    const char *json = NULL;
+    const char *engine = "top";
+    int threads[E2E_MAX_SWEEP] = {1}, nthreads = 1;
+    int batch[E2E_MAX_SWEEP]   = {1}, nbatch = 1;
+    int warmup = 200;
+    int limit = 0;
+    lenet_conv_backend_t conv = LENET_CONV_SCALAR;
+    int a, ti, bi;
+
+    for (a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "--threads") && a + 1 < argc) {
+            nthreads = parse_list(argv[++a], threads, E2E_MAX_SWEEP);
+        } else if (!strcmp(argv[a], "--batch") && a + 1 < argc) {
+            nbatch = parse_list(argv[++a], batch, E2E_MAX_SWEEP);
+        } else if (!strcmp(argv[a], "--images") && a + 1 < argc) {
+            images = argv[++a];
+        } else if (!strcmp(argv[a], "--labels") && a + 1 < argc) {
+            labels_file = argv[++a];
+        } else if (!strcmp(argv[a], "--json") && a + 1 < argc) {
+            json = argv[++a];
+        } else if (!strcmp(argv[a], "--warmup") && a + 1 < argc) {
+            warmup = atoi(argv[++a]);
+        } else if (!strcmp(argv[a], "-n") && a + 1 < argc) {
+            limit = atoi(argv[++a]);
+        } else if (!strcmp(argv[a], "--engine") && a + 1 < argc) {
+            engine = argv[++a];
+            if      (!strcmp(engine, "top"))    ;
+            else if (!strcmp(engine, "stream")) ;
+            else if (!strcmp(engine, "scalar")) conv = LENET_CONV_SCALAR;
+            else if (!strcmp(engine, "simd"))   conv = LENET_CONV_SIMD;
+            else if (!strcmp(engine, "gemm"))   conv = LENET_CONV_GEMM;
+            else if (!strcmp(engine, "fused"))  conv = LENET_CONV_FUSED;
+            else if (!strcmp(engine, "packed")) conv = LENET_CONV_PACKED;
+            else {
+                printf("ERROR: unknown engine %s\n", engine);
+                return -1;
+            }
+        } else {
+            printf("usage: %s [--threads 1,2,4] [--batch 1,8,32] [--engine top|stream|scalar|simd|gemm|fused|packed] [--images idx3] [--labels idx1] [-n N] [--warmup N] [--json out.json]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    lenet_idx_t label_idx, image_idx;
+
+    if (lenet_idx_open(&label_idx, labels_file) != 0 || lenet_idx_open(&image_idx, images) != 0)
+        return -1;
+    if (image_idx.rows != IMG_HEIGHT || image_idx.cols != IMG_WIDTH) {
+        printf("ERROR: %s : images %dx%d, expected %dx%d\n", images,
+               image_idx.rows, image_idx.cols, IMG_HEIGHT, IMG_WIDTH);
+        return -1;
+    }
+
+    int n = (image_idx.n < label_idx.n) ? image_idx.n : label_idx.n;
+    if (limit > 0 && limit < n)
+        n = limit;
+    if (n < 1) {
+        printf("ERROR: no images\n");
+        return -1;
+    }
+
+    lenet_weights_t weights;
+    lenet_packed_t  packed_w;
+    lenet_ctx_t     proto;
+    int use_stream = strcmp(engine, "stream") == 0;
+    int use_ctx = strcmp(engine, "top") != 0 && !use_stream;
+
+    lenet_weights_builtin(&weights);
+    if (!weights.fc1_k) {
+        printf("ERROR: built without Weights.h\n");
+        return -1;
+    }
+    if (conv == LENET_CONV_PACKED) {
+        lenet_weights_pack(&weights, &packed_w);
+        weights.packed = &packed_w;
+    }
+    if (use_ctx) {
+        lenet_ctx_init(&proto, &weights);
+        lenet_ctx_set_conv(&proto, conv);
+        proto.int_output = 1;               // argmax sur les logits, comme "top"
+    }
+    if (use_ctx || use_stream) {
+        if (nbatch > 1 || batch[0] != 1)
+            printf("NOTE: engine %s runs one image at a time, batch sweep ignored\n", engine);
+        batch[0] = 1;
+        nbatch = 1;
+    }
+
+    double       *lat = malloc(n * sizeof(double));
+    e2e_result_t *res = calloc(nthreads * nbatch, sizeof(*res));
+    if (!lat || !res) {
+        printf("ERROR: out of memory\n");
+        return -1;
+    }
+
+    printf("Dataset: %s (%d images) ; engine: %s ; SIMD: %s\n\n", images, n, engine, lenet_simd_isa());
+    printf("%7s %6s %10s %9s %9s %9s %9s %9s %9s\n",
+           "threads", "batch", "img/s", "accuracy", "p50 us", "p90 us", "p99 us", "p99.9 us", "max us");
+
+    int nres = 0;
+
+    for (ti = 0; ti < nthreads; ti++) {
+        for (bi = 0; bi < nbatch; bi++) {
+            e2e_run_t r;
+            e2e_result_t *o = &res[nres++];
+
+            r.w        = &weights;
+            r.proto    = use_ctx ? &proto : NULL;
+            r.stream   = use_stream;
+            r.load     = lenet_load_idx;
+            r.load_arg = &image_idx;
+            r.labels   = label_idx.data;
+            r.batch    = batch[bi];
+            r.lat_ns   = lat;
+
+            /* chauffe : caches, pages des fichiers mappés, threads */
+            r.n = (warmup < n) ? warmup : n;
+            if (r.n > 0)
+                e2e_pass(&r, threads[ti]);
+
+            r.n = n;
+            double t0 = now_ns();
+            o->errors = e2e_pass(&r, threads[ti]);
+            o->wall_s = (now_ns() - t0) * 1e-9;
+
+            o->threads = threads[ti];
+            o->batch   = batch[bi];
+            o->n       = n;
+            e2e_stats(o, lat, n);
+
+            printf("%7d %6d %10.1f %8.2f%% %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+                   o->threads, o->batch, n / o->wall_s, 100.0 * (1.0 - (double)o->errors / n),
+                   o->p50, o->p90, o->p99, o->p999, o->max);
+        }
+    }
+
+    if (json)
+        e2e_json(json, images, engine, res, nres);
+
+    free(lat);
+    free(res);
+    if (weights.packed)
+        lenet_packed_free(&packed_w);
+    lenet_idx_close(&image_idx);
+    lenet_idx_close(&label_idx);
+
+    return 0;
+}
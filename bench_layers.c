@@ -0,0 +1,343 @@
+/**
+  ******************************************************************************
+  * @file    bench_layers.c
+  * @brief   Per-layer microbenchmarks : ns/call (median / p99), GOPS and
+  *          weight bandwidth, warm and cold caches, Weights.h parameters
+  * @note    gcc -O2 -o bench_layers bench_layers.c conv_fixed.c conv_simd.c
+  *              conv_gemm.c pool_fixed.c fc_fixed.c packed_fixed.c
+  *              sparse_fixed.c utils_fixed.c mnist_idx.c -lm
+  *          ./bench_layers [--samples N] [--cold N] [--flush-mb M]
+  *                         [--mnist t10k-images-idx3-ubyte] [--layer name]
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lenet_cnn_fixed_point.h"
+#include LENET_WEIGHTS_FILE
+
+
+#define BENCH_NIMG      16          // entrées différentes, utilisées à tour de rôle
+#define BENCH_MIN_NS    20000.0     // durée minimale d'un échantillon "warm"
+
+
+/**************************************
+ *  ENTREES ET BUFFERS
+ *  Les entrées de chaque couche sont les vraies activations des couches
+ *  précédentes sur BENCH_NIMG images (MNIST ou pixels aléatoires).
+ **************************************/
+
+typedef struct {
+    lenet_weights_t w;
+    lenet_packed_t  packed;
+
+    short in   [BENCH_NIMG][IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH];
+    short conv1[BENCH_NIMG][CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH];
+    short pool1[BENCH_NIMG][POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH];
+    short conv2[BENCH_NIMG][CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH];
+    short pool2[BENCH_NIMG][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH];
+    short fc1  [BENCH_NIMG][FC1_NBOUTPUT];
+    short fc2  [BENCH_NIMG][FC2_NBOUTPUT];
+
+    /* sorties des noyaux mesurés */
+    short conv1_out[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH];
+    short pool1_out[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH];
+    short conv2_out[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH];
+    short pool2_out[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH];
+    short fc1_out  [LENET_BATCH_MAX][FC1_NBOUTPUT];
+    short fc2_out  [FC2_NBOUTPUT];
+    short pool2_batch[LENET_BATCH_MAX][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH];
+    float proba    [FC2_NBOUTPUT];
+    short proba_q  [FC2_NBOUTPUT];
+} bench_state_t;
+
+
+static void bench_inputs(bench_state_t *s, const char *mnist)
+{
+    unsigned char px[IMG_WIDTH * IMG_HEIGHT];
+    lenet_idx_t idx;
+    int use_idx = 0;
+    int i, k;
+
+    if (mnist) {
+        if (lenet_idx_open(&idx, mnist) != 0)
+            exit(1);
+        if (idx.rows != IMG_HEIGHT || idx.cols != IMG_WIDTH || idx.n < BENCH_NIMG) {
+            printf("ERROR: %s : need %d images of %dx%d\n", mnist, BENCH_NIMG, IMG_HEIGHT, IMG_WIDTH);
+            exit(1);
+        }
+        use_idx = 1;
+    }
+
+    srand(1);
+    for (i = 0; i < BENCH_NIMG; i++) {
+        if (use_idx)
+            memcpy(px, lenet_load_idx(&idx, i, px), sizeof(px));
+        else
+            for (k = 0; k < IMG_WIDTH * IMG_HEIGHT; k++)
+                px[k] = (unsigned char)(rand() & 0xFF);
+
+        NormalizeImg_fixed(px, (short*)s->in[i], IMG_WIDTH, IMG_HEIGHT);
+        Conv1_28x28x1_5x5x20_1_0_fixed(s->in[i], s->w.conv1_k, s->w.conv1_b, s->conv1[i]);
+        Pool1_24x24x20_2x2x20_2_0_fixed(s->conv1[i], s->pool1[i]);
+        Conv2_12x12x20_5x5x40_1_0_fixed(s->pool1[i], s->w.conv2_k, s->w.conv2_b, s->conv2[i]);
+        Pool2_8x8x40_2x2x40_2_0_fixed(s->conv2[i], s->pool2[i]);
+        Fc1_40_400_fixed(s->pool2[i], s->w.fc1_k, s->w.fc1_b, s->fc1[i]);
+        Fc2_400_10_fixed(s->fc1[i], s->w.fc2_k, s->w.fc2_b, s->fc2[i]);
+    }
+
+    for (i = 0; i < LENET_BATCH_MAX; i++)
+        memcpy(s->pool2_batch[i], s->pool2[i % BENCH_NIMG], sizeof(s->pool2_batch[0]));
+
+    if (use_idx)
+        lenet_idx_close(&idx);
+}
+
+
+/**************************************
+ *  NOYAUX MESURES
+ *  Un appel = une image (sauf batch : LENET_BATCH_MAX images).
+ **************************************/
+
+typedef void (*bench_fn)(bench_state_t *s, int i);
+
+static void b_conv1_scalar(bench_state_t *s, int i) { Conv1_28x28x1_5x5x20_1_0_fixed(s->in[i], s->w.conv1_k, s->w.conv1_b, s->conv1_out); }
+static void b_conv1_simd  (bench_state_t *s, int i) { Conv1_28x28x1_5x5x20_1_0_fixed_simd(s->in[i], s->w.conv1_k, s->w.conv1_b, s->conv1_out); }
+static void b_conv1_gemm  (bench_state_t *s, int i) { Conv1_28x28x1_5x5x20_1_0_fixed_gemm(s->in[i], s->w.conv1_k, s->w.conv1_b, s->conv1_out); }
+static void b_conv1_packed(bench_state_t *s, int i) { Conv1_28x28x1_5x5x20_1_0_fixed_packed(s->in[i], &s->packed, s->w.conv1_b, s->conv1_out); }
+static void b_conv1_fused (bench_state_t *s, int i) { Conv1Pool1_28x28x1_5x5x20_2x2_fixed(s->in[i], s->w.conv1_k, s->w.conv1_b, s->pool1_out); }
+static void b_pool1       (bench_state_t *s, int i) { Pool1_24x24x20_2x2x20_2_0_fixed(s->conv1[i], s->pool1_out); }
+
+static void b_conv2_scalar(bench_state_t *s, int i) { Conv2_12x12x20_5x5x40_1_0_fixed(s->pool1[i], s->w.conv2_k, s->w.conv2_b, s->conv2_out); }
+static void b_conv2_simd  (bench_state_t *s, int i) { Conv2_12x12x20_5x5x40_1_0_fixed_simd(s->pool1[i], s->w.conv2_k, s->w.conv2_b, s->conv2_out); }
+static void b_conv2_gemm  (bench_state_t *s, int i) { Conv2_12x12x20_5x5x40_1_0_fixed_gemm(s->pool1[i], s->w.conv2_k, s->w.conv2_b, s->conv2_out); }
+static void b_conv2_packed(bench_state_t *s, int i) { Conv2_12x12x20_5x5x40_1_0_fixed_packed(s->pool1[i], &s->packed, s->w.conv2_b, s->conv2_out); }
+static void b_conv2_fused (bench_state_t *s, int i) { Conv2Pool2_12x12x20_5x5x40_2x2_fixed(s->pool1[i], s->w.conv2_k, s->w.conv2_b, s->pool2_out); }
+static void b_conv2_sparse(bench_state_t *s, int i) { Conv2_12x12x20_5x5x40_1_0_fixed_sparse(s->pool1[i], s->w.conv2_k, s->w.conv2_b, s->conv2_out); }
+static void b_pool2       (bench_state_t *s, int i) { Pool2_8x8x40_2x2x40_2_0_fixed(s->conv2[i], s->pool2_out); }
+
+static void b_fc1_scalar  (bench_state_t *s, int i) { Fc1_40_400_fixed(s->pool2[i], s->w.fc1_k, s->w.fc1_b, s->fc1_out[0]); }
+static void b_fc1_packed  (bench_state_t *s, int i) { Fc1_40_400_fixed_packed(s->pool2[i], &s->packed, s->w.fc1_b, s->fc1_out[0]); }
+static void b_fc1_batch   (bench_state_t *s, int i) { (void)i; Fc1_40_400_fixed_batch(LENET_BATCH_MAX, s->pool2_batch, s->w.fc1_k, s->w.fc1_b, s->fc1_out); }
+static void b_fc1_sparse  (bench_state_t *s, int i) { Fc1_40_400_fixed_sparse(s->pool2[i], s->w.fc1_k, s->w.fc1_b, s->fc1_out[0]); }
+static void b_fc1_pk_sparse(bench_state_t *s, int i) { Fc1_40_400_fixed_packed_sparse(s->pool2[i], &s->packed, s->w.fc1_b, s->fc1_out[0]); }
+static void b_fc2         (bench_state_t *s, int i) { Fc2_400_10_fixed(s->fc1[i], s->w.fc2_k, s->w.fc2_b, s->fc2_out); }
+static void b_fc2_sparse  (bench_state_t *s, int i) { Fc2_400_10_fixed_sparse(s->fc1[i], s->w.fc2_k, s->w.fc2_b, s->fc2_out); }
+
+static void b_softmax     (bench_state_t *s, int i) { Softmax_fixed(s->fc2[i], s->proba); }
+static void b_softmax_lut (bench_state_t *s, int i) { Softmax_fixed_lut(s->fc2[i], s->proba_q); }
+
+
+#define W_CONV1     ( (CONV1_NBOUTPUT * IMG_DEPTH * CONV1_DIM * CONV1_DIM + CONV1_NBOUTPUT) * 2 )
+#define W_CONV2     ( (CONV2_NBOUTPUT * POOL1_NBOUTPUT * CONV2_DIM * CONV2_DIM + CONV2_NBOUTPUT) * 2 )
+#define W_FC1       ( (FC1_NBOUTPUT * FC1_NBINPUT + FC1_NBOUTPUT) * 2 )
+#define W_FC2       ( (FC2_NBOUTPUT * FC1_NBOUTPUT + FC2_NBOUTPUT) * 2 )
+#define W_CONV1_PK  ( (LENET_CONV1_KBLOCKS * LENET_CONV_KB * IMG_DEPTH * CONV1_DIM * CONV1_DIM + CONV1_NBOUTPUT) * 2 )
+#define W_CONV2_PK  ( (LENET_CONV2_KBLOCKS * LENET_CONV_KB * POOL1_NBOUTPUT * CONV2_DIM * CONV2_DIM + CONV2_NBOUTPUT) * 2 )
+#define W_FC1_PK    ( (LENET_FC1_KBLOCKS * LENET_FC1_KB * FC1_NBINPUT + FC1_NBOUTPUT) * 2 )
+
+static const struct {
+    const char *layer;
+    const char *variant;
+    bench_fn    fn;
+    long        macs;           // par appel
+    long        wbytes;         // octets de poids lus par appel
+} bench_case[] = {
+    { "conv1",   "scalar", b_conv1_scalar, CONV1_MACS, W_CONV1 },
+    { "conv1",   "simd",   b_conv1_simd,   CONV1_MACS, W_CONV1 },
+    { "conv1",   "gemm",   b_conv1_gemm,   CONV1_MACS, W_CONV1 },
+    { "conv1",   "packed", b_conv1_packed, CONV1_MACS, W_CONV1_PK },
+    { "conv1",   "fused",  b_conv1_fused,  CONV1_MACS, W_CONV1 },
+    { "pool1",   "scalar", b_pool1,        0,          0 },
+    { "conv2",   "scalar", b_conv2_scalar, CONV2_MACS, W_CONV2 },
+    { "conv2",   "simd",   b_conv2_simd,   CONV2_MACS, W_CONV2 },
+    { "conv2",   "gemm",   b_conv2_gemm,   CONV2_MACS, W_CONV2 },
+    { "conv2",   "packed", b_conv2_packed, CONV2_MACS, W_CONV2_PK },
+    { "conv2",   "fused",  b_conv2_fused,  CONV2_MACS, W_CONV2 },
+    { "conv2",   "sparse", b_conv2_sparse, CONV2_MACS, W_CONV2 },
+    { "pool2",   "scalar", b_pool2,        0,          0 },
+    { "fc1",     "scalar", b_fc1_scalar,   FC1_MACS,   W_FC1 },
+    { "fc1",     "packed", b_fc1_packed,   FC1_MACS,   W_FC1_PK },
+    { "fc1",     "batch",  b_fc1_batch,    (long)FC1_MACS * LENET_BATCH_MAX, W_FC1 },
+    { "fc1",     "sparse", b_fc1_sparse,   FC1_MACS,   W_FC1 },
+    { "fc1",     "pk-sparse", b_fc1_pk_sparse, FC1_MACS, W_FC1_PK },
+    { "fc2",     "scalar", b_fc2,          FC2_MACS,   W_FC2 },
+    { "fc2",     "sparse", b_fc2_sparse,   FC2_MACS,   W_FC2 },
+    { "softmax", "float",  b_softmax,      0,          0 },
+    { "softmax", "lut",    b_softmax_lut,  0,          0 },
+};
+
+#define BENCH_NCASES ( (int)(sizeof(bench_case) / sizeof(bench_case[0])) )
+
+
+/**************************************
+ *  MESURE
+ **************************************/
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Evince caches de données : lecture + écriture d'un buffer plus grand que le LLC */
+static volatile unsigned char flush_sink;
+
+static void flush_caches(unsigned char *buf, size_t size)
+{
+    unsigned char acc = 0;
+    size_t k;
+
+    for (k = 0; k < size; k += 64) {
+        buf[k]++;
+        acc ^= buf[k];
+    }
+    flush_sink = acc;
+}
+
+typedef struct {
+    double med, p99;
+} bench_stat_t;
+
+static bench_stat_t stats(double *t, int n)
+{
+    bench_stat_t r;
+    qsort(t, n, sizeof(double), cmp_double);
+    r.med = t[n / 2];
+    r.p99 = t[(n * 99) / 100 < n ? (n * 99) / 100 : n - 1];
+    return r;
+}
+
+/* Warm : chaque échantillon = reps appels consécutifs (>= BENCH_MIN_NS), ns/appel */
+static bench_stat_t bench_warm(bench_state_t *s, bench_fn fn, int samples, double *t)
+{
+    int reps = 1, r, k, i = 0;
+
+    for (k = 0; k < 10; k++)        // chauffe caches / prédicteurs
+        fn(s, k % BENCH_NIMG);
+
+    while (1) {
+        double t0 = now_ns();
+        for (r = 0; r < reps; r++)
+            fn(s, r % BENCH_NIMG);
+        if (now_ns() - t0 >= BENCH_MIN_NS || reps >= (1 << 20))
+            break;
+        reps *= 2;
+    }
+
+    for (k = 0; k < samples; k++) {
+        double t0 = now_ns();
+        for (r = 0; r < reps; r++, i++)
+            fn(s, i % BENCH_NIMG);
+        t[k] = (now_ns() - t0) / reps;
+    }
+    return stats(t, samples);
+}
+
+/* Cold : caches évincés avant chaque appel, un appel par échantillon */
+static bench_stat_t bench_cold(bench_state_t *s, bench_fn fn, int samples, double *t,
+                               unsigned char *flush, size_t flush_size)
+{
+    int k;
+
+    for (k = 0; k < samples; k++) {
+        flush_caches(flush, flush_size);
+        double t0 = now_ns();
+        fn(s, k % BENCH_NIMG);
+        t[k] = now_ns() - t0;
+    }
+    return stats(t, samples);
+}
+
+
+int main(int argc, char **argv)
+{
+    int samples = 200, cold = 50, flush_mb = 64;
+    const char *mnist = NULL, *only = NULL;
+    int a, c;
+
+    for (a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "--samples") && a + 1 < argc) {
+            samples = atoi(argv[++a]);
+        } else if (!strcmp(argv[a], "--cold") && a + 1 < argc) {
+            cold = atoi(argv[++a]);
+        } else if (!strcmp(argv[a], "--flush-mb") && a + 1 < argc) {
+            flush_mb = atoi(argv[++a]);
+        } else if (!strcmp(argv[a], "--mnist") && a + 1 < argc) {
+            mnist = argv[++a];
+        } else if (!strcmp(argv[a], "--layer") && a + 1 < argc) {
+            only = argv[++a];
+        } else {
+            printf("usage: %s [--samples N] [--cold N] [--flush-mb M] [--mnist images-idx3-ubyte] [--layer conv1|pool1|conv2|pool2|fc1|fc2|softmax]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (samples < 1) samples = 1;
+    if (cold < 0) cold = 0;
+
+    bench_state_t *s = malloc(sizeof(*s));
+    size_t flush_size = (size_t)flush_mb << 20;
+    unsigned char *flush = calloc(flush_size ? flush_size : 1, 1);
+    double *t = malloc(sizeof(double) * (samples > cold ? samples : cold));
+    if (!s || !flush || !t) {
+        printf("ERROR: out of memory\n");
+        return -1;
+    }
+
+    lenet_weights_init(&s->w);
+    s->w.conv1_k = CONV1_KERNEL;  s->w.conv1_b = CONV1_BIAS;
+    s->w.conv2_k = CONV2_KERNEL;  s->w.conv2_b = CONV2_BIAS;
+    s->w.fc1_k   = FC1_KERNEL;    s->w.fc1_b   = FC1_BIAS;
+    s->w.fc2_k   = FC2_KERNEL;    s->w.fc2_b   = FC2_BIAS;
+    lenet_weights_pack(&s->w, &s->packed);
+
+    bench_inputs(s, mnist);
+
+    printf("Inputs: %s, %d images ; SIMD: %s ; warm %d samples, cold %d samples (flush %d MB)\n",
+           mnist ? mnist : "random pixels", BENCH_NIMG, lenet_simd_isa(), samples, cold, flush_mb);
+    printf("GOPS = 2 ops/MAC ; W GB/s = weight bytes / time ; batch = %d images per call\n\n",
+           LENET_BATCH_MAX);
+    printf("%-8s %-9s %10s %10s %7s %8s %10s %10s %8s\n",
+           "layer", "variant", "warm med", "warm p99", "GOPS", "W GB/s",
+           "cold med", "cold p99", "W GB/s");
+    printf("%-8s %-9s %10s %10s %7s %8s %10s %10s %8s\n",
+           "", "", "(ns)", "(ns)", "", "", "(ns)", "(ns)", "");
+
+    for (c = 0; c < BENCH_NCASES; c++) {
+        if (only && strcmp(only, bench_case[c].layer))
+            continue;
+
+        bench_stat_t wm = bench_warm(s, bench_case[c].fn, samples, t);
+        bench_stat_t cd = { 0.0, 0.0 };
+        if (cold > 0)
+            cd = bench_cold(s, bench_case[c].fn, cold, t, flush, flush_size);
+
+        printf("%-8s %-9s %10.0f %10.0f", bench_case[c].layer, bench_case[c].variant, wm.med, wm.p99);
+        if (bench_case[c].macs) printf(" %7.2f", 2.0 * bench_case[c].macs / wm.med);
+        else                    printf(" %7s", "-");
+        if (bench_case[c].wbytes) printf(" %8.3f", bench_case[c].wbytes / wm.med);
+        else                      printf(" %8s", "-");
+        if (cold > 0) {
+            printf(" %10.0f %10.0f", cd.med, cd.p99);
+            if (bench_case[c].wbytes) printf(" %8.3f", bench_case[c].wbytes / cd.med);
+            else                      printf(" %8s", "-");
+        }
+        printf("\n");
+    }
+
+    lenet_packed_free(&s->packed);
+    free(t);
+    free(flush);
+    free(s);
+    return 0;
+}
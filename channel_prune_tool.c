@@ -0,0 +1,393 @@
+/**
+  ******************************************************************************
+  * @file    channel_prune_tool.c
+  * @brief   Structured pruning of Conv1/Conv2 : ranks the filters by L1 norm,
+  *          removes whole output channels, cuts the matching input slices of
+  *          Conv2 / FC1 and writes a smaller Weights header
+  * @note    gcc -O2 -o channel_prune_tool channel_prune_tool.c lenet_ctx.c
+  *              csr_fixed.c lowrank_fixed.c codebook_fixed.c sparse_fixed.c packed_fixed.c conv_fixed.c
+  *              conv_simd.c conv_gemm.c conv_int8.c pool_fixed.c pool_int8.c
+  *              fc_fixed.c fc_int8.c quant_int8.c utils_fixed.c mnist_idx.c
+  *              tiled_fixed.c -lm -lpthread
+  *          ./channel_prune_tool --conv1 12 --conv2 24 -o Weights_pruned.h
+  *          puis recompiler avec les dimensions affichées par l'outil.
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lenet_cnn_fixed_point.h"
+#include LENET_WEIGHTS_FILE
+
+
+/*
+   Retirer un canal revient, dans le modèle complet, à annuler son noyau et
+   son biais : sa sortie ReLU vaut 0 et n'apporte rien aux couches suivantes.
+   La précision du modèle réduit est donc mesurée sur le modèle complet
+   masqué (bit-exact : mêmes termes dans les accumulateurs int).
+*/
+
+typedef struct {
+    int n1, n2;                         // canaux conservés
+    unsigned char keep1[CONV1_NBOUTPUT];
+    unsigned char keep2[CONV2_NBOUTPUT];
+} prune_cfg_t;
+
+static short conv1_k[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM];
+static short conv1_b[CONV1_NBOUTPUT];
+static short conv2_k[CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM];
+static short conv2_b[CONV2_NBOUTPUT];
+
+
+/* Norme L1 de chaque filtre de Conv1 */
+static void conv1_norms(long norm[CONV1_NBOUTPUT])
+{
+    unsigned short k, z, y, x;
+
+    for (k = 0; k < CONV1_NBOUTPUT; k++) {
+        norm[k] = 0;
+        for (z = 0; z < IMG_DEPTH; z++)
+            for (y = 0; y < CONV1_DIM; y++)
+                for (x = 0; x < CONV1_DIM; x++)
+                    norm[k] += abs(CONV1_KERNEL[k][z][y][x]);
+    }
+}
+
+/* Norme L1 de chaque filtre de Conv2, restreinte aux canaux d'entrée conservés */
+static void conv2_norms(const unsigned char keep1[CONV1_NBOUTPUT], long norm[CONV2_NBOUTPUT])
+{
+    unsigned short k, z, y, x;
+
+    for (k = 0; k < CONV2_NBOUTPUT; k++) {
+        norm[k] = 0;
+        for (z = 0; z < POOL1_NBOUTPUT; z++) {
+            if (!keep1[z]) continue;
+            for (y = 0; y < CONV2_DIM; y++)
+                for (x = 0; x < CONV2_DIM; x++)
+                    norm[k] += abs(CONV2_KERNEL[k][z][y][x]);
+        }
+    }
+}
+
+/* Garde les n filtres de plus forte norme (ordre d'origine conservé) */
+static void select_top(const long *norm, int count, int n, unsigned char *keep)
+{
+    int i, j;
+
+    for (i = 0; i < count; i++) {
+        int rank = 0;       // filtres strictement meilleurs (égalités : indice le plus bas)
+        for (j = 0; j < count; j++)
+            rank += (norm[j] > norm[i]) || (norm[j] == norm[i] && j < i);
+        keep[i] = (rank < n);
+    }
+}
+
+static void prune_select(int n1, int n2, prune_cfg_t *cfg)
+{
+    long norm1[CONV1_NBOUTPUT], norm2[CONV2_NBOUTPUT];
+
+    cfg->n1 = n1;
+    cfg->n2 = n2;
+    conv1_norms(norm1);
+    select_top(norm1, CONV1_NBOUTPUT, n1, cfg->keep1);
+    conv2_norms(cfg->keep1, norm2);
+    select_top(norm2, CONV2_NBOUTPUT, n2, cfg->keep2);
+}
+
+
+/* Modèle complet avec les canaux retirés annulés (noyau + biais) */
+static void prune_mask(const prune_cfg_t *cfg)
+{
+    unsigned short k;
+
+    memcpy(conv1_k, CONV1_KERNEL, sizeof(conv1_k));
+    memcpy(conv1_b, CONV1_BIAS,   sizeof(conv1_b));
+    memcpy(conv2_k, CONV2_KERNEL, sizeof(conv2_k));
+    memcpy(conv2_b, CONV2_BIAS,   sizeof(conv2_b));
+
+    for (k = 0; k < CONV1_NBOUTPUT; k++)
+        if (!cfg->keep1[k]) {
+            memset(conv1_k[k], 0, sizeof(conv1_k[k]));
+            conv1_b[k] = 0;
+        }
+    for (k = 0; k < CONV2_NBOUTPUT; k++)
+        if (!cfg->keep2[k]) {
+            memset(conv2_k[k], 0, sizeof(conv2_k[k]));
+            conv2_b[k] = 0;
+        }
+}
+
+static double accuracy(const prune_cfg_t *cfg, lenet_idx_t *images, const unsigned char *labels,
+                       int n, int nthreads)
+{
+    lenet_weights_t w;
+    lenet_ctx_t proto;
+    lenet_eval_result_t res;
+
+    prune_mask(cfg);
+
+    lenet_weights_init(&w);
+    w.conv1_k = conv1_k;       w.conv1_b = conv1_b;
+    w.conv2_k = conv2_k;       w.conv2_b = conv2_b;
+    w.fc1_k   = FC1_KERNEL;    w.fc1_b   = FC1_BIAS;
+    w.fc2_k   = FC2_KERNEL;    w.fc2_b   = FC2_BIAS;
+
+    lenet_ctx_init(&proto, &w);
+    proto.int_output = 1;
+    lenet_eval(&proto, lenet_load_idx, images, labels, n, nthreads, &res);
+
+    return 100.0 * (1.0 - (double)res.errors / res.n);
+}
+
+
+/* Coût du modèle réduit : MACs par image et octets de poids (BRAM) */
+static void prune_cost(int n1, int n2, long *macs, long *bytes)
+{
+    long c1 = (long)n1 * CONV1_HEIGHT * CONV1_WIDTH * IMG_DEPTH * CONV1_DIM * CONV1_DIM;
+    long c2 = (long)n2 * CONV2_HEIGHT * CONV2_WIDTH * n1 * CONV2_DIM * CONV2_DIM;
+    long f1 = (long)FC1_NBOUTPUT * n2 * POOL2_HEIGHT * POOL2_WIDTH;
+
+    *macs  = c1 + c2 + f1 + FC2_MACS;
+    *bytes = (long)sizeof(short) * (c1 / (CONV1_HEIGHT * CONV1_WIDTH) + n1
+                                  + c2 / (CONV2_HEIGHT * CONV2_WIDTH) + n2
+                                  + f1 + FC1_NBOUTPUT
+                                  + FC2_NBOUTPUT * FC1_NBOUTPUT + FC2_NBOUTPUT);
+}
+
+
+/**************************************
+ *  ECRITURE DU HEADER REDUIT
+ *  Même format que Weights.h : un élément de premier niveau par ligne.
+ **************************************/
+static void emit(FILE *f, const short *v, const int *dims, int nd)
+{
+    int i, stride = 1;
+
+    for (i = 1; i < nd; i++)
+        stride *= dims[i];
+
+    fputc('{', f);
+    for (i = 0; i < dims[0]; i++) {
+        if (nd == 1)
+            fprintf(f, "%d,", v[i]);
+        else {
+            emit(f, v + i * stride, dims + 1, nd - 1);
+            fputc(',', f);
+        }
+    }
+    fputc('}', f);
+}
+
+static void emit_array(FILE *f, const char *name, const char *decl, const short *v,
+                       const int *dims, int nd)
+{
+    int i, stride = 1;
+
+    for (i = 1; i < nd; i++)
+        stride *= dims[i];
+
+    fprintf(f, "//#pragma HLS RESOURCE variable=%s core=ROM_1P\n", name);
+    fprintf(f, "static short %s%s =\n", name, decl);
+    if (nd == 1) {
+        emit(f, v, dims, 1);
+        fprintf(f, ";\n");
+        return;
+    }
+    fprintf(f, "{\n");
+    for (i = 0; i < dims[0]; i++) {
+        emit(f, v + i * stride, dims + 1, nd - 1);
+        fprintf(f, ",\n");
+    }
+    fprintf(f, "};\n");
+}
+
+static int write_header(const char *filename, const prune_cfg_t *cfg)
+{
+    const int n1 = cfg->n1, n2 = cfg->n2;
+    const int k1 = IMG_DEPTH * CONV1_DIM * CONV1_DIM;
+    const int k2 = CONV2_DIM * CONV2_DIM;
+    const int f1 = POOL2_HEIGHT * POOL2_WIDTH;
+    unsigned short k, z, i;
+    int o, p;
+
+    short *c1k = malloc(n1 * k1 * sizeof(short));
+    short *c1b = malloc(n1 * sizeof(short));
+    short *c2k = malloc(n2 * n1 * k2 * sizeof(short));
+    short *c2b = malloc(n2 * sizeof(short));
+    short *fck = malloc(FC1_NBOUTPUT * n2 * f1 * sizeof(short));
+    if (!c1k || !c1b || !c2k || !c2b || !fck) {
+        printf("ERROR: out of memory\n");
+        return -1;
+    }
+
+    /* Conv1 : filtres conservés */
+    for (k = 0, o = 0; k < CONV1_NBOUTPUT; k++) {
+        if (!cfg->keep1[k]) continue;
+        memcpy(&c1k[o * k1], CONV1_KERNEL[k], k1 * sizeof(short));
+        c1b[o++] = CONV1_BIAS[k];
+    }
+    /* Conv2 : filtres conservés, canaux d'entrée réduits aux sorties de Conv1 gardées */
+    for (k = 0, o = 0; k < CONV2_NBOUTPUT; k++) {
+        if (!cfg->keep2[k]) continue;
+        for (z = 0, p = 0; z < POOL1_NBOUTPUT; z++) {
+            if (!cfg->keep1[z]) continue;
+            memcpy(&c2k[(o * n1 + p++) * k2], CONV2_KERNEL[k][z], k2 * sizeof(short));
+        }
+        c2b[o++] = CONV2_BIAS[k];
+    }
+    /* FC1 : blocs [z][y][x] des canaux de Pool2 conservés */
+    for (i = 0; i < FC1_NBOUTPUT; i++)
+        for (z = 0, p = 0; z < POOL2_NBOUTPUT; z++) {
+            if (!cfg->keep2[z]) continue;
+            memcpy(&fck[(i * n2 + p++) * f1], FC1_KERNEL[i][z], f1 * sizeof(short));
+        }
+
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        printf("ERROR: Cannot create %s\n", filename);
+        return -1;
+    }
+
+    {
+        const int d_c1k[] = { n1, IMG_DEPTH, CONV1_DIM, CONV1_DIM };
+        const int d_c1b[] = { n1 };
+        const int d_c2k[] = { n2, n1, CONV2_DIM, CONV2_DIM };
+        const int d_c2b[] = { n2 };
+        const int d_fck[] = { FC1_NBOUTPUT, n2, POOL2_HEIGHT, POOL2_WIDTH };
+        const int d_fcb[] = { FC1_NBOUTPUT };
+        const int d_f2k[] = { FC2_NBOUTPUT, FC1_NBOUTPUT };
+        const int d_f2b[] = { FC2_NBOUTPUT };
+
+        fprintf(f, "#ifndef WEIGHTS_H\n#define WEIGHTS_H\n");
+        fprintf(f, "/* Modèle élagué par canaux (channel_prune_tool) : Conv1 %d -> %d, Conv2 %d -> %d\n",
+                CONV1_NBOUTPUT, n1, CONV2_NBOUTPUT, n2);
+        fprintf(f, "   -DCONV1_NBOUTPUT=%d -DCONV2_NBOUTPUT=%d -DLENET_WEIGHTS_FILE='\"%s\"' */\n",
+                n1, n2, filename);
+        fprintf(f, "#if CONV1_NBOUTPUT != %d || CONV2_NBOUTPUT != %d\n", n1, n2);
+        fprintf(f, "#error \"%s : compiler avec -DCONV1_NBOUTPUT=%d -DCONV2_NBOUTPUT=%d\"\n", filename, n1, n2);
+        fprintf(f, "#endif\n");
+
+        emit_array(f, "CONV1_KERNEL", "[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM]", c1k, d_c1k, 4);
+        emit_array(f, "CONV1_BIAS",   "[CONV1_NBOUTPUT]", c1b, d_c1b, 1);
+        emit_array(f, "CONV2_KERNEL", "[CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM]", c2k, d_c2k, 4);
+        emit_array(f, "CONV2_BIAS",   "[CONV2_NBOUTPUT]", c2b, d_c2b, 1);
+        emit_array(f, "FC1_KERNEL",   "[FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH]", fck, d_fck, 4);
+        emit_array(f, "FC1_BIAS",     "[FC1_NBOUTPUT]", FC1_BIAS, d_fcb, 1);
+        emit_array(f, "FC2_KERNEL",   "[FC2_NBOUTPUT][FC1_NBOUTPUT]", &FC2_KERNEL[0][0], d_f2k, 2);
+        emit_array(f, "FC2_BIAS",     "[FC2_NBOUTPUT]", FC2_BIAS, d_f2b, 1);
+        fprintf(f, "#endif\n");
+    }
+
+    free(c1k); free(c1b); free(c2k); free(c2b); free(fck);
+
+    if (fclose(f) != 0) {
+        printf("ERROR: Write error on %s\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    const char *images_file = "mnist/t10k-images-idx3-ubyte";
+    const char *labels_file = "mnist/t10k-labels-idx1-ubyte";
+    const char *out = "Weights_pruned.h";
+    int n1 = CONV1_NBOUTPUT, n2 = CONV2_NBOUTPUT;
+    int sweep = 0;
+    int nthreads = 1;
+    int a;
+
+    for (a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "--conv1") && a + 1 < argc) {
+            n1 = atoi(argv[++a]);
+        } else if (!strcmp(argv[a], "--conv2") && a + 1 < argc) {
+            n2 = atoi(argv[++a]);
+        } else if (!strcmp(argv[a], "--sweep")) {
+            sweep = 1;
+        } else if (!strcmp(argv[a], "--threads") && a + 1 < argc) {
+            nthreads = atoi(argv[++a]);
+        } else if (!strcmp(argv[a], "--images") && a + 1 < argc) {
+            images_file = argv[++a];
+        } else if (!strcmp(argv[a], "--labels") && a + 1 < argc) {
+            labels_file = argv[++a];
+        } else if (!strcmp(argv[a], "-o") && a + 1 < argc) {
+            out = argv[++a];
+        } else {
+            printf("usage: %s [--conv1 N] [--conv2 M] [--sweep] [--threads N] [--images idx3] [--labels idx1] [-o Weights_pruned.h]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (n1 < 1 || n1 > CONV1_NBOUTPUT || n2 < 1 || n2 > CONV2_NBOUTPUT) {
+        printf("ERROR: --conv1 in [1, %d], --conv2 in [1, %d]\n", CONV1_NBOUTPUT, CONV2_NBOUTPUT);
+        return -1;
+    }
+
+    lenet_idx_t label_idx, image_idx;
+
+    if (lenet_idx_open(&label_idx, labels_file) != 0 || lenet_idx_open(&image_idx, images_file) != 0)
+        return -1;
+    if (image_idx.rows != IMG_HEIGHT || image_idx.cols != IMG_WIDTH) {
+        printf("ERROR: %s : images %dx%d, expected %dx%d\n", images_file,
+               image_idx.rows, image_idx.cols, IMG_HEIGHT, IMG_WIDTH);
+        return -1;
+    }
+    int n = (image_idx.n < label_idx.n) ? image_idx.n : label_idx.n;
+
+    prune_cfg_t cfg;
+    long macs_ref, bytes_ref, macs, bytes;
+
+    prune_select(CONV1_NBOUTPUT, CONV2_NBOUTPUT, &cfg);
+    prune_cost(CONV1_NBOUTPUT, CONV2_NBOUTPUT, &macs_ref, &bytes_ref);
+    double acc_ref = accuracy(&cfg, &image_idx, label_idx.data, n, nthreads);
+
+    printf("Reference: Conv1 %d, Conv2 %d channels, %ld MACs, %ld weight bytes, accuracy %.2f%% (%d images)\n\n",
+           CONV1_NBOUTPUT, CONV2_NBOUTPUT, macs_ref, bytes_ref, acc_ref, n);
+
+    if (sweep) {
+        int s1, s2;
+
+        printf("%6s %6s %10s %7s %11s %7s %9s %8s\n",
+               "conv1", "conv2", "MACs", "(%)", "bytes", "(%)", "accuracy", "delta");
+        for (s1 = CONV1_NBOUTPUT; s1 >= CONV1_NBOUTPUT / 4; s1 -= (CONV1_NBOUTPUT + 4) / 5)
+            for (s2 = CONV2_NBOUTPUT; s2 >= CONV2_NBOUTPUT / 4; s2 -= (CONV2_NBOUTPUT + 4) / 5) {
+                prune_select(s1, s2, &cfg);
+                prune_cost(s1, s2, &macs, &bytes);
+                double acc = accuracy(&cfg, &image_idx, label_idx.data, n, nthreads);
+                printf("%6d %6d %10ld %6.1f%% %11ld %6.1f%% %8.2f%% %+8.2f\n",
+                       s1, s2, macs, 100.0 * macs / macs_ref, bytes, 100.0 * bytes / bytes_ref,
+                       acc, acc - acc_ref);
+            }
+        printf("\n");
+    }
+
+    /* configuration retenue */
+    unsigned short k;
+
+    prune_select(n1, n2, &cfg);
+    prune_cost(n1, n2, &macs, &bytes);
+    double acc = accuracy(&cfg, &image_idx, label_idx.data, n, nthreads);
+
+    printf("Pruned model: Conv1 %d -> %d, Conv2 %d -> %d\n", CONV1_NBOUTPUT, n1, CONV2_NBOUTPUT, n2);
+    printf("  Conv1 kept :");
+    for (k = 0; k < CONV1_NBOUTPUT; k++)
+        if (cfg.keep1[k]) printf(" %d", k);
+    printf("\n  Conv2 kept :");
+    for (k = 0; k < CONV2_NBOUTPUT; k++)
+        if (cfg.keep2[k]) printf(" %d", k);
+    printf("\n");
+    printf("  MACs/image : %ld -> %ld (%.1f%%)\n", macs_ref, macs, 100.0 * macs / macs_ref);
+    printf("  weights    : %ld -> %ld bytes (%.1f%%)\n", bytes_ref, bytes, 100.0 * bytes / bytes_ref);
+    printf("  accuracy   : %.2f%% -> %.2f%% (delta %+.2f)\n", acc_ref, acc, acc - acc_ref);
+
+    if (write_header(out, &cfg) != 0)
+        return -1;
+    printf("\n%s written, build with:\n  -DCONV1_NBOUTPUT=%d -DCONV2_NBOUTPUT=%d -DLENET_WEIGHTS_FILE='\"%s\"'\n",
+           out, n1, n2, out);
+
+    lenet_idx_close(&image_idx);
+    lenet_idx_close(&label_idx);
+    return 0;
+}
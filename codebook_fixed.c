@@ -0,0 +1,349 @@
+/**
+  ******************************************************************************
+  * @file    codebook_fixed.c
+  * @brief   Weight-clustered model (shared Q8 codebook + 4/5-bit indices) :
+  *          versioned file (writer + read-only mmap loader) and FC1 kernel
+  *          that pre-sums activations per centroid
+  * @note    CPU only. Le fichier est produit par codebook_tool.c.
+  ******************************************************************************
+  */
+
+#ifndef __SYNTHESIS__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "lenet_cnn_fixed_point.h"
+
+
+/*
+ *  Format (version 1) :
+ *
+ *    lenet_cb_header_t        (magic, version, FIXED_POINT, table des couches)
+ *    par couche               dictionnaire int16, index bit-packés, biais int16,
+ *                             chacun aligné sur LENET_WEIGHTS_ALIGN
+ *
+ *  Index : ligne r à idx_off + r * row_bytes, index i aux bits
+ *  [i * bits, (i + 1) * bits) (LSB d'abord). L'octet de garde en fin de
+ *  ligne permet de toujours lire l'index par une fenêtre de 16 bits.
+ */
+
+static const unsigned int cb_dims[LENET_CB_LAYERS][2] = {
+    { CONV1_NBOUTPUT, IMG_DEPTH * CONV1_DIM * CONV1_DIM      },
+    { CONV2_NBOUTPUT, POOL1_NBOUTPUT * CONV2_DIM * CONV2_DIM },
+    { FC1_NBOUTPUT,   FC1_NBINPUT                            },
+    { FC2_NBOUTPUT,   FC1_NBOUTPUT                           },
+};
+
+static inline short relu_fixed(short x)
+{
+    return (x > 0) ? x : 0;
+}
+
+static unsigned int cb_align(unsigned int off)
+{
+    return (off + LENET_WEIGHTS_ALIGN - 1) & ~(LENET_WEIGHTS_ALIGN - 1);
+}
+
+static unsigned int cb_row_bytes(unsigned int cols, unsigned int bits)
+{
+    return (cols * bits + 7) / 8 + 1;
+}
+
+static inline unsigned int cb_index(const unsigned char *row, unsigned int i, unsigned int bits)
+{
+    unsigned int pos = i * bits;
+    unsigned int v   = row[pos >> 3] | (row[(pos >> 3) + 1] << 8);
+
+    return (v >> (pos & 7)) & ((1u << bits) - 1);
+}
+
+
+/**************************************
+ *  ECRITURE
+ **************************************/
+int lenet_cb_save(const char *filename, const lenet_cb_src_t src[LENET_CB_LAYERS])
+{
+    static const char pad[LENET_WEIGHTS_ALIGN];
+    lenet_cb_header_t h;
+    unsigned int off;
+    int l, r, i;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, LENET_CB_MAGIC, sizeof(h.magic));
+    h.version     = LENET_CB_VERSION;
+    h.endian      = 0x01020304;
+    h.fixed_point = FIXED_POINT;
+
+    off = cb_align(sizeof(h));
+    for (l = 0; l < LENET_CB_LAYERS; l++) {
+        lenet_cb_layer_t *t = &h.layer[l];
+
+        if ((src[l].bits != 4 && src[l].bits != 5) ||
+            (src[l].nbooks != 1 && src[l].nbooks != src[l].rows)) {
+            printf("ERROR: layer %d : %d-bit indices, %d codebooks not supported\n",
+                   l, src[l].bits, src[l].nbooks);
+            return -1;
+        }
+        t->bits      = src[l].bits;
+        t->nbooks    = src[l].nbooks;
+        t->rows      = src[l].rows;
+        t->cols      = src[l].cols;
+        t->row_bytes = cb_row_bytes(t->cols, t->bits);
+        t->book_off  = off;
+        t->idx_off   = off = cb_align(off + (t->nbooks << t->bits) * sizeof(short));
+        t->bias_off  = off = cb_align(off + t->rows * t->row_bytes);
+        off = cb_align(off + t->rows * sizeof(short));
+    }
+    h.file_size = off;
+
+    FILE *f = fopen(filename, "wb");
+    if (!f) {
+        printf("ERROR: Cannot create %s\n", filename);
+        return -1;
+    }
+
+    long pos = (long)fwrite(&h, 1, sizeof(h), f);
+    for (l = 0; l < LENET_CB_LAYERS; l++) {
+        const lenet_cb_layer_t *t = &h.layer[l];
+        unsigned char *row = calloc(t->row_bytes, 1);
+
+        if (!row) {
+            printf("ERROR: out of memory\n");
+            fclose(f);
+            return -1;
+        }
+
+        pos += (long)fwrite(pad, 1, t->book_off - pos, f);
+        pos += (long)fwrite(src[l].book, 1, (t->nbooks << t->bits) * sizeof(short), f);
+        pos += (long)fwrite(pad, 1, t->idx_off - pos, f);
+        for (r = 0; r < (int)t->rows; r++) {
+            memset(row, 0, t->row_bytes);
+            for (i = 0; i < (int)t->cols; i++) {
+                unsigned int v = src[l].idx[r * t->cols + i] & ((1u << t->bits) - 1);
+                unsigned int p = i * t->bits;
+                row[p >> 3]       |= (unsigned char)(v << (p & 7));
+                row[(p >> 3) + 1] |= (unsigned char)((v << (p & 7)) >> 8);
+            }
+            pos += (long)fwrite(row, 1, t->row_bytes, f);
+        }
+        pos += (long)fwrite(pad, 1, t->bias_off - pos, f);
+        pos += (long)fwrite(src[l].bias, 1, t->rows * sizeof(short), f);
+        free(row);
+    }
+    pos += (long)fwrite(pad, 1, h.file_size - pos, f);
+
+    if (fclose(f) != 0 || pos != (long)h.file_size) {
+        printf("ERROR: Write error on %s\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+
+/**************************************
+ *  DÉCODAGE d'une couche : w = book[idx], dst[rows][cols]
+ **************************************/
+void lenet_cb_decode(const lenet_cb_t *cb, int l, short *dst)
+{
+    const lenet_cb_layer_t *t = &cb->layer[l];
+    const short *books = (const short*)(cb->base + t->book_off);
+    unsigned int r, i;
+
+    for (r = 0; r < t->rows; r++) {
+        const unsigned char *row  = cb->base + t->idx_off + r * t->row_bytes;
+        const short         *book = books + ((t->nbooks > 1) ? (r << t->bits) : 0);
+
+        for (i = 0; i < t->cols; i++)
+            dst[r * t->cols + i] = book[cb_index(row, i, t->bits)];
+    }
+}
+
+
+/**************************************
+ *  CHARGEMENT (mmap lecture seule)
+ *  FC1 s'exécute sur les index (w->fc1_cb) et n'est pas décodé :
+ *  w->fc1_k reste NULL. Conv1, Conv2 et FC2 sont décodés en mémoire.
+ **************************************/
+int lenet_cb_map(const char *filename, lenet_cb_t *cb, lenet_weights_t *w)
+{
+    struct stat st;
+    const lenet_cb_header_t *h;
+    short *dense[LENET_CB_LAYERS];
+    short *bias[LENET_CB_LAYERS];
+    size_t total = 0;
+    int l;
+
+    memset(cb, 0, sizeof(*cb));
+    cb->fd = open(filename, O_RDONLY);
+    if (cb->fd < 0) {
+        printf("ERROR: Cannot open %s\n", filename);
+        return -1;
+    }
+
+    if (fstat(cb->fd, &st) != 0 || (size_t)st.st_size < sizeof(*h)) {
+        printf("ERROR: %s is not a codebook weight file\n", filename);
+        lenet_cb_unmap(cb);
+        return -1;
+    }
+
+    cb->size = (size_t)st.st_size;
+    cb->map  = mmap(NULL, cb->size, PROT_READ, MAP_SHARED, cb->fd, 0);
+    if (cb->map == MAP_FAILED) {
+        cb->map = NULL;
+        printf("ERROR: Cannot mmap %s\n", filename);
+        lenet_cb_unmap(cb);
+        return -1;
+    }
+
+    cb->base = (const unsigned char*)cb->map;
+    h        = (const lenet_cb_header_t*)cb->base;
+
+    if (memcmp(h->magic, LENET_CB_MAGIC, sizeof(h->magic)) != 0) {
+        printf("ERROR: %s is not a codebook weight file\n", filename);
+        lenet_cb_unmap(cb);
+        return -1;
+    }
+    if (h->version != LENET_CB_VERSION || h->endian != 0x01020304 ||
+        h->fixed_point != FIXED_POINT || h->file_size > cb->size) {
+        printf("ERROR: %s : bad header (version %u, Q%u)\n",
+               filename, h->version, h->fixed_point);
+        lenet_cb_unmap(cb);
+        return -1;
+    }
+
+    for (l = 0; l < LENET_CB_LAYERS; l++) {
+        const lenet_cb_layer_t *t = &h->layer[l];
+
+        if ((t->bits != 4 && t->bits != 5) ||
+            t->rows != cb_dims[l][0] || t->cols != cb_dims[l][1] ||
+            (t->nbooks != 1 && t->nbooks != t->rows) ||
+            t->row_bytes < cb_row_bytes(t->cols, t->bits) ||
+            ((t->book_off | t->idx_off | t->bias_off) & (LENET_WEIGHTS_ALIGN - 1)) != 0 ||
+            /* en 64 bits : size_t fait 32 bits sur le Zynq PS */
+            t->book_off + ((unsigned long long)t->nbooks << t->bits) * sizeof(short) > h->file_size ||
+            t->idx_off + (unsigned long long)t->rows * t->row_bytes > h->file_size ||
+            t->bias_off + (unsigned long long)t->rows * sizeof(short) > h->file_size) {
+            printf("ERROR: %s : layer %d does not match this build\n", filename, l);
+            lenet_cb_unmap(cb);
+            return -1;
+        }
+        if (l != LENET_CB_FC1)
+            total += (size_t)t->rows * t->cols;
+    }
+    cb->layer = h->layer;
+
+    cb->dense = malloc(total * sizeof(short));
+    if (!cb->dense) {
+        printf("ERROR: out of memory\n");
+        lenet_cb_unmap(cb);
+        return -1;
+    }
+
+    /* décodage de Conv1, Conv2, FC2 */
+    total = 0;
+    for (l = 0; l < LENET_CB_LAYERS; l++) {
+        bias[l] = (short*)(cb->base + h->layer[l].bias_off);
+        if (l == LENET_CB_FC1)
+            continue;
+        dense[l] = cb->dense + total;
+        lenet_cb_decode(cb, l, dense[l]);
+        total += (size_t)h->layer[l].rows * h->layer[l].cols;
+    }
+
+    lenet_weights_init(w);
+    w->conv1_k = (short (*)[IMG_DEPTH][CONV1_DIM][CONV1_DIM])dense[LENET_CB_CONV1];
+    w->conv1_b = bias[LENET_CB_CONV1];
+    w->conv2_k = (short (*)[POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM])dense[LENET_CB_CONV2];
+    w->conv2_b = bias[LENET_CB_CONV2];
+    w->fc1_b   = bias[LENET_CB_FC1];
+    w->fc2_k   = (short (*)[FC1_NBOUTPUT])dense[LENET_CB_FC2];
+    w->fc2_b   = bias[LENET_CB_FC2];
+    w->fc1_cb = cb;
+
+    return 0;
+}
+
+
+void lenet_cb_unmap(lenet_cb_t *cb)
+{
+    if (cb->map)
+        munmap(cb->map, cb->size);
+    if (cb->fd >= 0)
+        close(cb->fd);
+    free(cb->dense);
+
+    memset(cb, 0, sizeof(*cb));
+    cb->fd = -1;
+}
+
+
+/**************************************
+ *  FC1 PAR DICTIONNAIRE
+ *  Les activations sont d'abord sommées par centroïde (additions seules),
+ *  puis 16 / 32 MACs par sortie : sum_i book[idx_i] * x_i
+ *                               = sum_c book[c] * (sum_{idx_i = c} x_i).
+ *  Lit 4 / 5 bits par poids au lieu de 16. Bit-exact avec le FC1 décodé.
+ **************************************/
+void Fc1_40_400_fixed_cb(
+        short input [POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        const lenet_cb_t *cb,
+        short bias  [FC1_NBOUTPUT],
+        short output[FC1_NBOUTPUT])
+{
+    const lenet_cb_layer_t *t = &cb->layer[LENET_CB_FC1];
+    const short *books = (const short*)(cb->base + t->book_off);
+    const short *in = &input[0][0][0];
+    const unsigned int bits = t->bits, ncent = 1u << bits;
+    unsigned int k, i, c;
+
+    for (k = 0; k < FC1_NBOUTPUT; k++) {
+        const unsigned char *row  = cb->base + t->idx_off + k * t->row_bytes;
+        const short         *book = books + ((t->nbooks > 1) ? (k << bits) : 0);
+        int sum[LENET_CB_MAX];
+
+        for (c = 0; c < ncent; c++)
+            sum[c] = 0;
+
+        if (bits == 4) {
+            for (i = 0; i + 1 < FC1_NBINPUT; i += 2) {
+                unsigned char b = row[i >> 1];
+                sum[b & 15] += in[i];
+                sum[b >> 4] += in[i + 1];
+            }
+            for (; i < FC1_NBINPUT; i++)
+                sum[cb_index(row, i, 4)] += in[i];
+        } else {
+            /* 8 index de 5 bits = 5 octets */
+            for (i = 0; i + 7 < FC1_NBINPUT; i += 8) {
+                const unsigned char *p = row + (i >> 3) * 5;
+                unsigned long long b = (unsigned long long)p[0]         | ((unsigned long long)p[1] << 8) |
+                                      ((unsigned long long)p[2] << 16) | ((unsigned long long)p[3] << 24) |
+                                      ((unsigned long long)p[4] << 32);
+                sum[(b      ) & 31] += in[i];
+                sum[(b >>  5) & 31] += in[i + 1];
+                sum[(b >> 10) & 31] += in[i + 2];
+                sum[(b >> 15) & 31] += in[i + 3];
+                sum[(b >> 20) & 31] += in[i + 4];
+                sum[(b >> 25) & 31] += in[i + 5];
+                sum[(b >> 30) & 31] += in[i + 6];
+                sum[(b >> 35) & 31] += in[i + 7];
+            }
+            for (; i < FC1_NBINPUT; i++)
+                sum[cb_index(row, i, bits)] += in[i];
+        }
+
+        int acc = ((int)bias[k]) << FIXED_POINT;
+        for (c = 0; c < ncent; c++)
+            acc += (int)book[c] * sum[c];
+
+        output[k] = relu_fixed((short)(acc >> FIXED_POINT));
+    }
+}
+
+#endif
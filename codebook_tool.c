@@ -0,0 +1,246 @@
+/**
+  ******************************************************************************
+  * @file    codebook_tool.c
+  * @brief   Offline weight clustering : 1-D k-means of each layer's Q8
+  *          weights (per layer or per output channel) into 16 / 32 shared
+  *          values, written as a codebook model file
+  * @note    gcc -O2 -o codebook_tool codebook_tool.c lenet_ctx.c codebook_fixed.c
+  *              lowrank_fixed.c csr_fixed.c sparse_fixed.c packed_fixed.c
+  *              conv_fixed.c conv_simd.c conv_gemm.c conv_int8.c pool_fixed.c
+  *              pool_int8.c fc_fixed.c fc_int8.c quant_int8.c utils_fixed.c
+  *              tiled_fixed.c mnist_idx.c -lm -lpthread
+  *          ./codebook_tool --bits 4 [--per-channel] -o lenet_cb.bin
+  *          ./lenet --codebook lenet_cb.bin
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lenet_cnn_fixed_point.h"
+#include LENET_WEIGHTS_FILE
+
+
+static const char *layer_name[LENET_CB_LAYERS] = { "conv1", "conv2", "fc1", "fc2" };
+
+
+/* k-means 1-D sur l'histogramme des valeurs Q8 de v[0..n-1].
+   Centroïdes arrondis en Q8, idx[i] = centroïde le plus proche de v[i]. */
+static void kmeans_1d(const short *v, int n, int k, short *book, unsigned char *idx)
+{
+    static int hist[65536];
+    double c[LENET_CB_MAX];
+    int lo = 32767, hi = -32768;
+    int i, j, x, it;
+
+    if (n <= 0)
+        return;
+    for (i = 0; i < n; i++) {
+        if (v[i] < lo) lo = v[i];
+        if (v[i] > hi) hi = v[i];
+    }
+    memset(hist, 0, (hi - lo + 1) * sizeof(int));
+    for (i = 0; i < n; i++)
+        hist[v[i] - lo]++;
+
+    /* initialisation aux quantiles (milieu de chaque tranche de n/k poids) */
+    for (j = 0, x = lo, i = 0; j < k; j++) {
+        long target = ((long)(2 * j + 1) * n) / (2 * k);
+        while (x < hi && i + hist[x - lo] <= target)
+            i += hist[x++ - lo];
+        c[j] = x;
+    }
+
+    for (it = 0; it < 100; it++) {
+        double s[LENET_CB_MAX], w[LENET_CB_MAX];
+        int changed = 0;
+
+        for (j = 0; j < k; j++)
+            s[j] = w[j] = 0.0;
+        for (x = lo; x <= hi; x++) {
+            int best = 0;
+            if (!hist[x - lo]) continue;
+            for (j = 1; j < k; j++)
+                if ((x - c[j]) * (x - c[j]) < (x - c[best]) * (x - c[best]))
+                    best = j;
+            s[best] += (double)x * hist[x - lo];
+            w[best] += hist[x - lo];
+        }
+        for (j = 0; j < k; j++)
+            if (w[j] > 0.0 && s[j] / w[j] != c[j]) {
+                c[j] = s[j] / w[j];
+                changed = 1;
+            }
+        if (!changed)
+            break;
+    }
+
+    for (j = 0; j < k; j++)
+        book[j] = (short)(c[j] < 0 ? c[j] - 0.5 : c[j] + 0.5);
+
+    for (i = 0; i < n; i++) {
+        int best = 0;
+        for (j = 1; j < k; j++)
+            if (abs(v[i] - book[j]) < abs(v[i] - book[best]))
+                best = j;
+        idx[i] = (unsigned char)best;
+    }
+}
+
+
+static double accuracy(const lenet_weights_t *w, lenet_idx_t *images, const unsigned char *labels,
+                       int n, int nthreads)
+{
+    lenet_ctx_t proto;
+    lenet_eval_result_t res;
+
+    lenet_ctx_init(&proto, w);
+    proto.int_output = 1;
+    lenet_eval(&proto, lenet_load_idx, images, labels, n, nthreads, &res);
+
+    return 100.0 * (1.0 - (double)res.errors / res.n);
+}
+
+
+int main(int argc, char **argv)
+{
+    const char *images_file = "mnist/t10k-images-idx3-ubyte";
+    const char *labels_file = "mnist/t10k-labels-idx1-ubyte";
+    const char *out = "lenet_cb.bin";
+    int bits = 4;
+    int per_channel = 0;
+    int nthreads = 1;
+    int a, l, r;
+
+    for (a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "--bits") && a + 1 < argc) {
+            bits = atoi(argv[++a]);
+        } else if (!strcmp(argv[a], "--per-channel")) {
+            per_channel = 1;
+        } else if (!strcmp(argv[a], "--threads") && a + 1 < argc) {
+            nthreads = atoi(argv[++a]);
+        } else if (!strcmp(argv[a], "--images") && a + 1 < argc) {
+            images_file = argv[++a];
+        } else if (!strcmp(argv[a], "--labels") && a + 1 < argc) {
+            labels_file = argv[++a];
+        } else if (!strcmp(argv[a], "-o") && a + 1 < argc) {
+            out = argv[++a];
+        } else {
+            printf("usage: %s [--bits 4|5] [--per-channel] [--threads N] [--images idx3] [--labels idx1] [-o lenet_cb.bin]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (bits != 4 && bits != 5) {
+        printf("ERROR: --bits must be 4 (16 centroids) or 5 (32 centroids)\n");
+        return -1;
+    }
+
+    lenet_idx_t label_idx, image_idx;
+
+    if (lenet_idx_open(&label_idx, labels_file) != 0 || lenet_idx_open(&image_idx, images_file) != 0)
+        return -1;
+    if (image_idx.rows != IMG_HEIGHT || image_idx.cols != IMG_WIDTH) {
+        printf("ERROR: %s : images %dx%d, expected %dx%d\n", images_file,
+               image_idx.rows, image_idx.cols, IMG_HEIGHT, IMG_WIDTH);
+        return -1;
+    }
+    int n = (image_idx.n < label_idx.n) ? image_idx.n : label_idx.n;
+
+    /* couches de Weights.h, en lignes (canal de sortie) x poids */
+    const short *kern[LENET_CB_LAYERS] = {
+        &CONV1_KERNEL[0][0][0][0], &CONV2_KERNEL[0][0][0][0],
+        &FC1_KERNEL[0][0][0][0],   &FC2_KERNEL[0][0]
+    };
+    const short *bias[LENET_CB_LAYERS] = { CONV1_BIAS, CONV2_BIAS, FC1_BIAS, FC2_BIAS };
+    const int rows[LENET_CB_LAYERS] = { CONV1_NBOUTPUT, CONV2_NBOUTPUT, FC1_NBOUTPUT, FC2_NBOUTPUT };
+    const int cols[LENET_CB_LAYERS] = {
+        IMG_DEPTH * CONV1_DIM * CONV1_DIM, POOL1_NBOUTPUT * CONV2_DIM * CONV2_DIM,
+        FC1_NBINPUT, FC1_NBOUTPUT
+    };
+
+    lenet_cb_src_t src[LENET_CB_LAYERS];
+    long dense_bytes = 0, cb_bytes = 0;
+
+    printf("%-6s %8s %7s %11s %11s\n", "layer", "weights", "books", "dense (B)", "codebook (B)");
+    for (l = 0; l < LENET_CB_LAYERS; l++) {
+        int nbooks = per_channel ? rows[l] : 1;
+        int seg    = rows[l] * cols[l] / nbooks;
+        short         *book = malloc((size_t)nbooks * (1 << bits) * sizeof(short));
+        unsigned char *idx  = malloc((size_t)rows[l] * cols[l]);
+
+        if (!book || !idx) {
+            printf("ERROR: out of memory\n");
+            return -1;
+        }
+        for (r = 0; r < nbooks; r++)
+            kmeans_1d(kern[l] + r * seg, seg, 1 << bits, book + (r << bits), idx + r * seg);
+
+        src[l].bits   = bits;
+        src[l].nbooks = nbooks;
+        src[l].rows   = rows[l];
+        src[l].cols   = cols[l];
+        src[l].book   = book;
+        src[l].idx    = idx;
+        src[l].bias   = bias[l];
+
+        long d = (long)(rows[l] * cols[l] + rows[l]) * sizeof(short);
+        long c = (long)rows[l] * ((cols[l] * bits + 7) / 8)
+               + (long)(nbooks << bits) * sizeof(short) + rows[l] * sizeof(short);
+        printf("%-6s %8d %7d %11ld %11ld\n", layer_name[l], rows[l] * cols[l], nbooks, d, c);
+        dense_bytes += d;
+        cb_bytes    += c;
+    }
+    printf("%-6s %8s %7s %11ld %11ld (%.2fx smaller)\n\n", "total", "", "", dense_bytes, cb_bytes,
+           (double)dense_bytes / cb_bytes);
+
+    if (lenet_cb_save(out, src) != 0)
+        return -1;
+    for (l = 0; l < LENET_CB_LAYERS; l++) {
+        free((void*)src[l].book);
+        free((void*)src[l].idx);
+    }
+
+    /* relecture du fichier : précision du modèle décodé, puis FC1 sur les index */
+    lenet_weights_t w;
+    lenet_cb_t cb;
+
+    lenet_weights_init(&w);
+    w.conv1_k = CONV1_KERNEL;  w.conv1_b = CONV1_BIAS;
+    w.conv2_k = CONV2_KERNEL;  w.conv2_b = CONV2_BIAS;
+    w.fc1_k   = FC1_KERNEL;    w.fc1_b   = FC1_BIAS;
+    w.fc2_k   = FC2_KERNEL;    w.fc2_b   = FC2_BIAS;
+    double acc_ref = accuracy(&w, &image_idx, label_idx.data, n, nthreads);
+
+    if (lenet_cb_map(out, &cb, &w) != 0)
+        return -1;
+    double acc_lut = accuracy(&w, &image_idx, label_idx.data, n, nthreads);
+    /* FC1 décodé à part : le chargeur ne garde que les index */
+    short *fc1_dec = malloc((size_t)FC1_NBOUTPUT * FC1_NBINPUT * sizeof(short));
+
+    if (!fc1_dec) {
+        printf("ERROR: out of memory\n");
+        return -1;
+    }
+    lenet_cb_decode(&cb, LENET_CB_FC1, fc1_dec);
+    w.fc1_k  = (short (*)[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH])fc1_dec;
+    w.fc1_cb = NULL;
+    double acc_dec = accuracy(&w, &image_idx, label_idx.data, n, nthreads);
+
+    printf("%d-bit indices (%d centroids %s)\n", bits, 1 << bits,
+           per_channel ? "per output channel" : "per layer");
+    printf("  accuracy : %.2f%% -> %.2f%% (delta %+.2f), FC1 LUT kernel %.2f%% (%d images)\n",
+           acc_ref, acc_dec, acc_dec - acc_ref, acc_lut, n);
+
+    if (acc_lut != acc_dec) {
+        printf("ERROR: codebook FC1 kernel does not match the decoded FC1\n");
+        return -1;
+    }
+    printf("\nCodebook model written to %s (use ./lenet --codebook %s)\n", out, out);
+
+    free(fc1_dec);
+    lenet_cb_unmap(&cb);
+    lenet_idx_close(&image_idx);
+    lenet_idx_close(&label_idx);
+    return 0;
+}
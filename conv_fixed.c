@@ -64,6 +64,44 @@ void Conv1_28x28x1_5x5x20_1_0_fixed(
 
 
 
+/* ============================================================================
+ *  CONV1 SUR PIXELS uint8  (28×28×1 octets  →  24×24×20)
+ *  Noyau et biais repliés (cf. CONV1_U8_SHIFT) : u8 × s16 → int32
+ * ============================================================================
+ */
+void Conv1_28x28x1_5x5x20_1_0_fixed_u8(
+        unsigned char input[IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],               // IN
+        short kernel[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],       // IN (replié)
+        int   bias[CONV1_NBOUTPUT],                                          // IN (replié)
+        short output[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH])             // OUT
+{
+    unsigned short k, z, y, x, ky, kx;
+
+    for (k = 0; k < CONV1_NBOUTPUT; k++) {
+        for (y = 0; y < CONV1_HEIGHT; y++) {
+            for (x = 0; x < CONV1_WIDTH; x++) {
+
+                int acc = bias[k];
+
+                for (z = 0; z < IMG_DEPTH; z++) {
+                    for (ky = 0; ky < CONV1_DIM; ky++) {
+                        for (kx = 0; kx < CONV1_DIM; kx++) {
+                            acc += ( (int)input[z][y + ky][x + kx] *
+                                     (int)kernel[k][z][ky][kx] );
+                        }
+                    }
+                }
+
+                acc >>= FIXED_POINT + CONV1_U8_SHIFT;
+
+                output[k][y][x] = relu_fixed((short)acc);
+            }
+        }
+    }
+}
+
+
+
 /* ============================================================================
  *  CONV2  (12×12×20  →  8×8×40)
  * ============================================================================
@@ -104,3 +142,102 @@ void Conv2_12x12x20_5x5x40_1_0_fixed(
         }
     }
 }
+
+
+
+/* ============================================================================
+ *  CONV + ReLU + MAXPOOL 2x2 FUSIONNES
+ * ============================================================================
+ *
+ *  Chaque bloc 2x2 de sorties de convolution est calculé, passé par
+ *  relu_fixed, puis seul le max est écrit : la sortie complète de la
+ *  convolution n'est jamais stockée (conv1_out / conv2_out supprimés).
+ *
+ *  max(relu(a), relu(b), ...) == relu(max(a, b, ...)) → bit-exact avec
+ *  Conv + Pool séparés.
+ */
+
+/* Une sortie de convolution en (y, x) pour le filtre k */
+#define CONV_POINT(acc, input, kernel, k, NZ, DIM, y, x)                    \
+    do {                                                                    \
+        unsigned short z_, ky_, kx_;                                        \
+        for (z_ = 0; z_ < (NZ); z_++)                                       \
+            for (ky_ = 0; ky_ < (DIM); ky_++)                               \
+                for (kx_ = 0; kx_ < (DIM); kx_++)                           \
+                    (acc) += ( (int)(input)[z_][(y) + ky_][(x) + kx_] *     \
+                               (int)(kernel)[k][z_][ky_][kx_] );            \
+    } while (0)
+
+
+/* CONV1 + POOL1  (28×28×1  →  12×12×20) */
+void Conv1Pool1_28x28x1_5x5x20_2x2_fixed(
+        short input[IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],                       // IN
+        short kernel[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],       // IN
+        short bias[CONV1_NBOUTPUT],                                          // IN
+        short output[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH])             // OUT
+{
+    unsigned short k, py, px, dy, dx;
+
+    for (k = 0; k < CONV1_NBOUTPUT; k++) {
+        for (py = 0; py < POOL1_HEIGHT; py++) {
+            for (px = 0; px < POOL1_WIDTH; px++) {
+
+                short max_val = 0;   // sorties ReLU >= 0
+
+                for (dy = 0; dy < POOL1_DIM; dy++) {
+                    for (dx = 0; dx < POOL1_DIM; dx++) {
+
+                        unsigned short y = (unsigned short)(py * POOL1_STRIDE + dy);
+                        unsigned short x = (unsigned short)(px * POOL1_STRIDE + dx);
+
+                        int acc = ((int)bias[k]) << FIXED_POINT;
+                        CONV_POINT(acc, input, kernel, k, IMG_DEPTH, CONV1_DIM, y, x);
+                        acc >>= FIXED_POINT;
+
+                        short v = relu_fixed((short)acc);
+                        if (v > max_val) max_val = v;
+                    }
+                }
+
+                output[k][py][px] = max_val;
+            }
+        }
+    }
+}
+
+
+/* CONV2 + POOL2  (12×12×20  →  4×4×40) */
+void Conv2Pool2_12x12x20_5x5x40_2x2_fixed(
+        short input[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH],              // IN
+        short kernel[CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],  // IN
+        short bias[CONV2_NBOUTPUT],                                          // IN
+        short output[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH])             // OUT
+{
+    unsigned short k, py, px, dy, dx;
+
+    for (k = 0; k < CONV2_NBOUTPUT; k++) {
+        for (py = 0; py < POOL2_HEIGHT; py++) {
+            for (px = 0; px < POOL2_WIDTH; px++) {
+
+                short max_val = 0;
+
+                for (dy = 0; dy < POOL2_DIM; dy++) {
+                    for (dx = 0; dx < POOL2_DIM; dx++) {
+
+                        unsigned short y = (unsigned short)(py * POOL2_STRIDE + dy);
+                        unsigned short x = (unsigned short)(px * POOL2_STRIDE + dx);
+
+                        int acc = ((int)bias[k]) << FIXED_POINT;
+                        CONV_POINT(acc, input, kernel, k, POOL1_NBOUTPUT, CONV2_DIM, y, x);
+                        acc >>= FIXED_POINT;
+
+                        short v = relu_fixed((short)acc);
+                        if (v > max_val) max_val = v;
+                    }
+                }
+
+                output[k][py][px] = max_val;
+            }
+        }
+    }
+}
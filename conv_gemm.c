@@ -0,0 +1,162 @@
+/**
+  ******************************************************************************
+  * @file    conv_gemm.c
+  * @brief   Convolutions by im2col + cache-blocked int16 GEMM (FIXED POINT)
+  * @note    CPU only. Bit-exact avec conv_fixed.c.
+  ******************************************************************************
+  */
+
+#ifndef __SYNTHESIS__
+
+#include "lenet_cnn_fixed_point.h"
+
+
+/* ============================================================================
+ *  GEMM int16 x int16 -> int32, bloqué
+ * ============================================================================
+ *
+ *  C[M][N] += A[M][K] * B[K][N]      (C initialisé par l'appelant)
+ *
+ *  Blocs GEMM_KC x GEMM_NC de B (tiennent en L1/L2), micro-noyau de
+ *  4 lignes de A : chaque ligne de B chargée sert 4 fois. La boucle
+ *  interne (sur j) est contiguë et vectorisée par le compilateur.
+ *  Sommes entières → même résultat quel que soit l'ordre.
+ */
+#define GEMM_KC  128
+#define GEMM_NC  256
+
+void Gemm_s16_fixed(int M, int N, int K,
+                    const short *A, int lda,
+                    const short *B, int ldb,
+                    int *C, int ldc)
+{
+    int m4 = M & ~3;
+    int i0, j0, k0, i, j, k;
+
+    for (k0 = 0; k0 < K; k0 += GEMM_KC) {
+        int kc = (K - k0 < GEMM_KC) ? K - k0 : GEMM_KC;
+
+        for (j0 = 0; j0 < N; j0 += GEMM_NC) {
+            int nc = (N - j0 < GEMM_NC) ? N - j0 : GEMM_NC;
+
+            for (i0 = 0; i0 < m4; i0 += 4) {
+                int *c0 = C + (i0 + 0) * ldc + j0;
+                int *c1 = C + (i0 + 1) * ldc + j0;
+                int *c2 = C + (i0 + 2) * ldc + j0;
+                int *c3 = C + (i0 + 3) * ldc + j0;
+
+                for (k = k0; k < k0 + kc; k++) {
+                    const short *b = B + k * ldb + j0;
+                    int a0 = A[(i0 + 0) * lda + k];
+                    int a1 = A[(i0 + 1) * lda + k];
+                    int a2 = A[(i0 + 2) * lda + k];
+                    int a3 = A[(i0 + 3) * lda + k];
+
+                    for (j = 0; j < nc; j++) {
+                        int bj = b[j];
+                        c0[j] += a0 * bj;
+                        c1[j] += a1 * bj;
+                        c2[j] += a2 * bj;
+                        c3[j] += a3 * bj;
+                    }
+                }
+            }
+
+            /* lignes restantes (M non multiple de 4) */
+            for (i = m4; i < M; i++) {
+                int *c = C + i * ldc + j0;
+                for (k = k0; k < k0 + kc; k++) {
+                    const short *b = B + k * ldb + j0;
+                    int a = A[i * lda + k];
+                    for (j = 0; j < nc; j++)
+                        c[j] += a * b[j];
+                }
+            }
+        }
+    }
+}
+
+
+/* ============================================================================
+ *  im2col : col[z][ky][kx][y][x] = input[z][y+ky][x+kx]
+ *  (une ligne de col par coefficient du noyau, une colonne par sortie)
+ * ============================================================================
+ */
+static void im2col(const short *input, int nz, int ih, int iw, int kdim,
+                   int oh, int ow, short *col)
+{
+    int z, ky, kx, y, x;
+
+    for (z = 0; z < nz; z++)
+        for (ky = 0; ky < kdim; ky++)
+            for (kx = 0; kx < kdim; kx++)
+                for (y = 0; y < oh; y++) {
+                    const short *src = input + (z * ih + y + ky) * iw + kx;
+                    for (x = 0; x < ow; x++)
+                        *col++ = src[x];
+                }
+}
+
+/* bias << FIXED_POINT, GEMM, >> FIXED_POINT, (short), ReLU */
+static void conv_gemm(const short *input, int nz, int ih, int iw, int kdim,
+                      const short *kernel, const short *bias, int nk,
+                      short *output, int oh, int ow,
+                      short *col, int *acc)
+{
+    int K = nz * kdim * kdim;
+    int N = oh * ow;
+    int k, j;
+
+    im2col(input, nz, ih, iw, kdim, oh, ow, col);
+
+    for (k = 0; k < nk; k++)
+        for (j = 0; j < N; j++)
+            acc[k * N + j] = ((int)bias[k]) << FIXED_POINT;
+
+    /* noyau [nk][z][ky][kx] = matrice nk x K déjà contiguë */
+    Gemm_s16_fixed(nk, N, K, kernel, K, col, N, acc, N);
+
+    for (j = 0; j < nk * N; j++) {
+        short v = (short)(acc[j] >> FIXED_POINT);
+        output[j] = (v > 0) ? v : 0;
+    }
+}
+
+
+/* ============================================================================
+ *  CONV1 / CONV2 : même signature que conv_fixed.c
+ * ============================================================================
+ */
+void Conv1_28x28x1_5x5x20_1_0_fixed_gemm(
+        short input[IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short kernel[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        short bias[CONV1_NBOUTPUT],
+        short output[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH])
+{
+    short col[IMG_DEPTH * CONV1_DIM * CONV1_DIM][CONV1_HEIGHT * CONV1_WIDTH];
+    int   acc[CONV1_NBOUTPUT][CONV1_HEIGHT * CONV1_WIDTH];
+
+    conv_gemm(&input[0][0][0], IMG_DEPTH, IMG_HEIGHT, IMG_WIDTH, CONV1_DIM,
+              &kernel[0][0][0][0], bias, CONV1_NBOUTPUT,
+              &output[0][0][0], CONV1_HEIGHT, CONV1_WIDTH,
+              &col[0][0], &acc[0][0]);
+}
+
+
+/* 12x12x20 → col 500 x 64, noyau 40 x 500 */
+void Conv2_12x12x20_5x5x40_1_0_fixed_gemm(
+        short input[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH],
+        short kernel[CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short bias[CONV2_NBOUTPUT],
+        short output[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH])
+{
+    short col[POOL1_NBOUTPUT * CONV2_DIM * CONV2_DIM][CONV2_HEIGHT * CONV2_WIDTH];
+    int   acc[CONV2_NBOUTPUT][CONV2_HEIGHT * CONV2_WIDTH];
+
+    conv_gemm(&input[0][0][0], POOL1_NBOUTPUT, POOL1_HEIGHT, POOL1_WIDTH, CONV2_DIM,
+              &kernel[0][0][0][0], bias, CONV2_NBOUTPUT,
+              &output[0][0][0], CONV2_HEIGHT, CONV2_WIDTH,
+              &col[0][0], &acc[0][0]);
+}
+
+#endif
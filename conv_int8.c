@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+  * @file    conv_int8.c
+  * @brief   Convolution layers for LeNet (INT8 weights / UINT8 activations)
+  * @note    Même structure de boucles que conv_fixed.c
+  ******************************************************************************
+  */
+
+#include "lenet_cnn_fixed_point.h"
+
+
+/* ============================================================================
+ *  CONV1  (28×28×1  →  24×24×20)
+ * ============================================================================
+ *
+ *  acc  = bias_q[k] + Σ in_u8 * k_i8          (int32)
+ *  out  = sat_u8( ReLU( requant(acc, mult[k]) ) )
+ */
+void Conv1_28x28x1_5x5x20_1_0_int8(
+        unsigned char  input [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],             // IN
+        signed char    kernel[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM], // IN
+        int            bias  [CONV1_NBOUTPUT],                               // IN
+        lenet_q_mult_t mult  [CONV1_NBOUTPUT],                               // IN
+        unsigned char  output[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH])    // OUT
+{
+    unsigned short k, z, y, x, ky, kx;
+
+    for (k = 0; k < CONV1_NBOUTPUT; k++) {
+        for (y = 0; y < CONV1_HEIGHT; y++) {
+            for (x = 0; x < CONV1_WIDTH; x++) {
+
+                int acc = bias[k];
+
+                for (z = 0; z < IMG_DEPTH; z++) {
+                    for (ky = 0; ky < CONV1_DIM; ky++) {
+                        for (kx = 0; kx < CONV1_DIM; kx++) {
+                            acc += (int)input[z][y + ky][x + kx] *
+                                   (int)kernel[k][z][ky][kx];
+                        }
+                    }
+                }
+
+                output[k][y][x] = lenet_requant_u8(acc, mult[k]);
+            }
+        }
+    }
+}
+
+
+/* ============================================================================
+ *  CONV2  (12×12×20  →  8×8×40)
+ * ============================================================================
+ */
+void Conv2_12x12x20_5x5x40_1_0_int8(
+        unsigned char  input [POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH],            // IN
+        signed char    kernel[CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM], // IN
+        int            bias  [CONV2_NBOUTPUT],                                       // IN
+        lenet_q_mult_t mult  [CONV2_NBOUTPUT],                                       // IN
+        unsigned char  output[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH])            // OUT
+{
+    unsigned short k, z, y, x, ky, kx;
+
+    for (k = 0; k < CONV2_NBOUTPUT; k++) {
+        for (y = 0; y < CONV2_HEIGHT; y++) {
+            for (x = 0; x < CONV2_WIDTH; x++) {
+
+                int acc = bias[k];
+
+                for (z = 0; z < POOL1_NBOUTPUT; z++) {
+                    for (ky = 0; ky < CONV2_DIM; ky++) {
+                        for (kx = 0; kx < CONV2_DIM; kx++) {
+                            acc += (int)input[z][y + ky][x + kx] *
+                                   (int)kernel[k][z][ky][kx];
+                        }
+                    }
+                }
+
+                output[k][y][x] = lenet_requant_u8(acc, mult[k]);
+            }
+        }
+    }
+}
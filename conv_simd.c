@@ -0,0 +1,485 @@
+/**
+  ******************************************************************************
+  * @file    conv_simd.c
+  * @brief   Vectorized Conv1 / Conv2 (FIXED POINT) : SSE2, AVX2, NEON
+  * @note    CPU only. Les versions scalaires de conv_fixed.c restent la
+  *          référence (et la version synthétisée par HLS).
+  ******************************************************************************
+  */
+
+#ifndef __SYNTHESIS__
+
+#include "lenet_cnn_fixed_point.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LENET_X86
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LENET_NEON
+#endif
+
+
+/* ============================================================================
+ *  Principe commun
+ * ============================================================================
+ *
+ *  Une ligne de 8 sorties x0..x0+7 est calculée d'un coup :
+ *     acc[x] += in[z][y+ky][x+kx] * k[z][ky][kx]
+ *
+ *  x86 : pmaddwd sur des paires (kx, kx+1) entrelacées
+ *        (in[x+kx], in[x+kx+1]) . (w[kx], w[kx+1])  → int32
+ *  NEON: vmlal_n_s16, 16x16 → 32 bits.
+ *
+ *  Les sommes entières sont exactes : résultat bit-exact avec la version
+ *  scalaire (y compris la troncature (short)acc, pas de saturation).
+ *
+ *  Les lectures restent dans la ligne : x0 + 4 + 8 <= largeur d'entrée.
+ */
+
+#define KDIM 5      // CONV1_DIM == CONV2_DIM
+
+#if (CONV1_DIM != KDIM) || (CONV2_DIM != KDIM)
+#error "conv_simd.c : noyaux 5x5 uniquement"
+#endif
+#if (CONV1_WIDTH % 8) || (CONV2_WIDTH % 8) || (CONV1_HEIGHT % 2) || (CONV2_HEIGHT % 2)
+#error "conv_simd.c : largeurs de sortie multiples de 8, hauteurs paires"
+#endif
+
+
+#ifdef LENET_X86
+
+/* paires de poids (w[kx], w[kx+1]) pour pmaddwd ; la 3e paire est (w[4], 0) */
+static inline int pair16(short lo, short hi)
+{
+    return (int)(((unsigned int)(unsigned short)hi << 16) | (unsigned short)lo);
+}
+
+static void make_pairs(const short *w, int nz, int wp[][KDIM][3])
+{
+    int z, ky;
+    for (z = 0; z < nz; z++)
+        for (ky = 0; ky < KDIM; ky++) {
+            const short *r = &w[(z * KDIM + ky) * KDIM];
+            wp[z][ky][0] = pair16(r[0], r[1]);
+            wp[z][ky][1] = pair16(r[2], r[3]);
+            wp[z][ky][2] = pair16(r[4], 0);
+        }
+}
+
+
+/* ---------- SSE2 : 8 sorties (une ligne) ---------- */
+
+static inline void row8_sse2(const short *in, int iw, int plane, int nz,
+                             int wp[][KDIM][3], __m128i *lo, __m128i *hi)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int z, ky;
+
+    for (z = 0; z < nz; z++) {
+        for (ky = 0; ky < KDIM; ky++) {
+            const short *r = in + z * plane + ky * iw;
+
+            __m128i v0 = _mm_loadu_si128((const __m128i*)(r + 0));
+            __m128i v1 = _mm_loadu_si128((const __m128i*)(r + 1));
+            __m128i v2 = _mm_loadu_si128((const __m128i*)(r + 2));
+            __m128i v3 = _mm_loadu_si128((const __m128i*)(r + 3));
+            __m128i v4 = _mm_loadu_si128((const __m128i*)(r + 4));
+
+            __m128i w01 = _mm_set1_epi32(wp[z][ky][0]);
+            __m128i w23 = _mm_set1_epi32(wp[z][ky][1]);
+            __m128i w4  = _mm_set1_epi32(wp[z][ky][2]);
+
+            *lo = _mm_add_epi32(*lo, _mm_madd_epi16(_mm_unpacklo_epi16(v0, v1), w01));
+            *hi = _mm_add_epi32(*hi, _mm_madd_epi16(_mm_unpackhi_epi16(v0, v1), w01));
+            *lo = _mm_add_epi32(*lo, _mm_madd_epi16(_mm_unpacklo_epi16(v2, v3), w23));
+            *hi = _mm_add_epi32(*hi, _mm_madd_epi16(_mm_unpackhi_epi16(v2, v3), w23));
+            *lo = _mm_add_epi32(*lo, _mm_madd_epi16(_mm_unpacklo_epi16(v4, zero), w4));
+            *hi = _mm_add_epi32(*hi, _mm_madd_epi16(_mm_unpackhi_epi16(v4, zero), w4));
+        }
+    }
+}
+
+/* >> FIXED_POINT, troncature sur 16 bits (comme (short)acc), ReLU */
+static inline __m128i finish_sse2(__m128i lo, __m128i hi)
+{
+    lo = _mm_srai_epi32(_mm_slli_epi32(_mm_srai_epi32(lo, FIXED_POINT), 16), 16);
+    hi = _mm_srai_epi32(_mm_slli_epi32(_mm_srai_epi32(hi, FIXED_POINT), 16), 16);
+    return _mm_max_epi16(_mm_packs_epi32(lo, hi), _mm_setzero_si128());
+}
+
+static void conv_sse2(const short *input, int iw, int ih, int nz,
+                      const short *kernel, const short *bias, int nk,
+                      short *output, int ow, int oh)
+{
+    int wp[POOL1_NBOUTPUT][KDIM][3];   // nz <= POOL1_NBOUTPUT
+    int k, y, x;
+
+    for (k = 0; k < nk; k++) {
+        make_pairs(kernel + k * nz * KDIM * KDIM, nz, wp);
+        __m128i b = _mm_set1_epi32(((int)bias[k]) << FIXED_POINT);
+
+        for (y = 0; y < oh; y++) {
+            for (x = 0; x < ow; x += 8) {
+                __m128i lo = b, hi = b;
+                row8_sse2(input + y * iw + x, iw, iw * ih, nz, wp, &lo, &hi);
+                _mm_storeu_si128((__m128i*)(output + (k * oh + y) * ow + x),
+                                 finish_sse2(lo, hi));
+            }
+        }
+    }
+}
+
+
+/* ---------- AVX2 : 2 lignes de 8 sorties (y, y+1) ---------- */
+
+__attribute__((target("avx2")))
+static inline __m256i load2rows(const short *r, int iw)
+{
+    return _mm256_inserti128_si256(
+               _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)r)),
+               _mm_loadu_si128((const __m128i*)(r + iw)), 1);
+}
+
+__attribute__((target("avx2")))
+static void conv_avx2(const short *input, int iw, int ih, int nz,
+                      const short *kernel, const short *bias, int nk,
+                      short *output, int ow, int oh)
+{
+    int wp[POOL1_NBOUTPUT][KDIM][3];   // nz <= POOL1_NBOUTPUT
+    const __m256i zero = _mm256_setzero_si256();
+    int k, y, x, z, ky;
+
+    for (k = 0; k < nk; k++) {
+        make_pairs(kernel + k * nz * KDIM * KDIM, nz, wp);
+        __m256i b = _mm256_set1_epi32(((int)bias[k]) << FIXED_POINT);
+
+        for (y = 0; y < oh; y += 2) {
+            for (x = 0; x < ow; x += 8) {
+                __m256i lo = b, hi = b;
+
+                for (z = 0; z < nz; z++) {
+                    for (ky = 0; ky < KDIM; ky++) {
+                        const short *r = input + (z * ih + y + ky) * iw + x;
+
+                        __m256i v0 = load2rows(r + 0, iw);
+                        __m256i v1 = load2rows(r + 1, iw);
+                        __m256i v2 = load2rows(r + 2, iw);
+                        __m256i v3 = load2rows(r + 3, iw);
+                        __m256i v4 = load2rows(r + 4, iw);
+
+                        __m256i w01 = _mm256_set1_epi32(wp[z][ky][0]);
+                        __m256i w23 = _mm256_set1_epi32(wp[z][ky][1]);
+                        __m256i w4  = _mm256_set1_epi32(wp[z][ky][2]);
+
+                        lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(v0, v1), w01));
+                        hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(v0, v1), w01));
+                        lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(v2, v3), w23));
+                        hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(v2, v3), w23));
+                        lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(v4, zero), w4));
+                        hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(v4, zero), w4));
+                    }
+                }
+
+                lo = _mm256_srai_epi32(_mm256_slli_epi32(_mm256_srai_epi32(lo, FIXED_POINT), 16), 16);
+                hi = _mm256_srai_epi32(_mm256_slli_epi32(_mm256_srai_epi32(hi, FIXED_POINT), 16), 16);
+                __m256i o = _mm256_max_epi16(_mm256_packs_epi32(lo, hi), zero);
+
+                short *dst = output + (k * oh + y) * ow + x;
+                _mm_storeu_si128((__m128i*)dst,        _mm256_castsi256_si128(o));
+                _mm_storeu_si128((__m128i*)(dst + ow), _mm256_extracti128_si256(o, 1));
+            }
+        }
+    }
+}
+
+
+/* ---------- Conv1 sur pixels uint8 : zéro-extension vers 16 bits, même schéma ---------- */
+
+#define U8_SHIFT (FIXED_POINT + CONV1_U8_SHIFT)
+
+static inline __m128i load8_u8(const unsigned char *p)
+{
+    return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), _mm_setzero_si128());
+}
+
+static void conv1_u8_sse2(const unsigned char *input, const short *kernel,
+                          const int *bias, short *output)
+{
+    int wp[IMG_DEPTH][KDIM][3];
+    const __m128i zero = _mm_setzero_si128();
+    int k, y, x, z, ky;
+
+    for (k = 0; k < CONV1_NBOUTPUT; k++) {
+        make_pairs(kernel + k * IMG_DEPTH * KDIM * KDIM, IMG_DEPTH, wp);
+        __m128i b = _mm_set1_epi32(bias[k]);
+
+        for (y = 0; y < CONV1_HEIGHT; y++) {
+            for (x = 0; x < CONV1_WIDTH; x += 8) {
+                __m128i lo = b, hi = b;
+
+                for (z = 0; z < IMG_DEPTH; z++) {
+                    for (ky = 0; ky < KDIM; ky++) {
+                        const unsigned char *r = input + (z * IMG_HEIGHT + y + ky) * IMG_WIDTH + x;
+
+                        __m128i v0 = load8_u8(r + 0);
+                        __m128i v1 = load8_u8(r + 1);
+                        __m128i v2 = load8_u8(r + 2);
+                        __m128i v3 = load8_u8(r + 3);
+                        __m128i v4 = load8_u8(r + 4);
+
+                        __m128i w01 = _mm_set1_epi32(wp[z][ky][0]);
+                        __m128i w23 = _mm_set1_epi32(wp[z][ky][1]);
+                        __m128i w4  = _mm_set1_epi32(wp[z][ky][2]);
+
+                        lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(v0, v1), w01));
+                        hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(v0, v1), w01));
+                        lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(v2, v3), w23));
+                        hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(v2, v3), w23));
+                        lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(v4, zero), w4));
+                        hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(v4, zero), w4));
+                    }
+                }
+
+                lo = _mm_srai_epi32(_mm_slli_epi32(_mm_srai_epi32(lo, U8_SHIFT), 16), 16);
+                hi = _mm_srai_epi32(_mm_slli_epi32(_mm_srai_epi32(hi, U8_SHIFT), 16), 16);
+                _mm_storeu_si128((__m128i*)(output + (k * CONV1_HEIGHT + y) * CONV1_WIDTH + x),
+                                 _mm_max_epi16(_mm_packs_epi32(lo, hi), zero));
+            }
+        }
+    }
+}
+
+/* AVX2 : 2 lignes (y, y+1) de 8 pixels → un __m256i de 16 x int16 */
+__attribute__((target("avx2")))
+static inline __m256i load2rows_u8(const unsigned char *r)
+{
+    return _mm256_cvtepu8_epi16(_mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)r),
+                                                   _mm_loadl_epi64((const __m128i*)(r + IMG_WIDTH))));
+}
+
+__attribute__((target("avx2")))
+static void conv1_u8_avx2(const unsigned char *input, const short *kernel,
+                          const int *bias, short *output)
+{
+    int wp[IMG_DEPTH][KDIM][3];
+    const __m256i zero = _mm256_setzero_si256();
+    int k, y, x, z, ky;
+
+    for (k = 0; k < CONV1_NBOUTPUT; k++) {
+        make_pairs(kernel + k * IMG_DEPTH * KDIM * KDIM, IMG_DEPTH, wp);
+        __m256i b = _mm256_set1_epi32(bias[k]);
+
+        for (y = 0; y < CONV1_HEIGHT; y += 2) {
+            for (x = 0; x < CONV1_WIDTH; x += 8) {
+                __m256i lo = b, hi = b;
+
+                for (z = 0; z < IMG_DEPTH; z++) {
+                    for (ky = 0; ky < KDIM; ky++) {
+                        const unsigned char *r = input + (z * IMG_HEIGHT + y + ky) * IMG_WIDTH + x;
+
+                        __m256i v0 = load2rows_u8(r + 0);
+                        __m256i v1 = load2rows_u8(r + 1);
+                        __m256i v2 = load2rows_u8(r + 2);
+                        __m256i v3 = load2rows_u8(r + 3);
+                        __m256i v4 = load2rows_u8(r + 4);
+
+                        __m256i w01 = _mm256_set1_epi32(wp[z][ky][0]);
+                        __m256i w23 = _mm256_set1_epi32(wp[z][ky][1]);
+                        __m256i w4  = _mm256_set1_epi32(wp[z][ky][2]);
+
+                        lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(v0, v1), w01));
+                        hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(v0, v1), w01));
+                        lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(v2, v3), w23));
+                        hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(v2, v3), w23));
+                        lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(v4, zero), w4));
+                        hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(v4, zero), w4));
+                    }
+                }
+
+                lo = _mm256_srai_epi32(_mm256_slli_epi32(_mm256_srai_epi32(lo, U8_SHIFT), 16), 16);
+                hi = _mm256_srai_epi32(_mm256_slli_epi32(_mm256_srai_epi32(hi, U8_SHIFT), 16), 16);
+                __m256i o = _mm256_max_epi16(_mm256_packs_epi32(lo, hi), zero);
+
+                short *dst = output + (k * CONV1_HEIGHT + y) * CONV1_WIDTH + x;
+                _mm_storeu_si128((__m128i*)dst,                 _mm256_castsi256_si128(o));
+                _mm_storeu_si128((__m128i*)(dst + CONV1_WIDTH), _mm256_extracti128_si256(o, 1));
+            }
+        }
+    }
+}
+
+#endif /* LENET_X86 */
+
+
+#ifdef LENET_NEON
+
+/* ---------- NEON : 8 sorties (une ligne), vmlal_s16 ---------- */
+
+static void conv_neon(const short *input, int iw, int ih, int nz,
+                      const short *kernel, const short *bias, int nk,
+                      short *output, int ow, int oh)
+{
+    int k, y, x, z, ky, kx;
+
+    for (k = 0; k < nk; k++) {
+        const short *wk = kernel + k * nz * KDIM * KDIM;
+        int32x4_t b = vdupq_n_s32(((int)bias[k]) << FIXED_POINT);
+
+        for (y = 0; y < oh; y++) {
+            for (x = 0; x < ow; x += 8) {
+                int32x4_t lo = b, hi = b;
+
+                for (z = 0; z < nz; z++) {
+                    for (ky = 0; ky < KDIM; ky++) {
+                        const short *r = input + (z * ih + y + ky) * iw + x;
+                        const short *w = wk + (z * KDIM + ky) * KDIM;
+
+                        for (kx = 0; kx < KDIM; kx++) {
+                            int16x8_t v = vld1q_s16(r + kx);
+                            lo = vmlal_n_s16(lo, vget_low_s16(v),  w[kx]);
+                            hi = vmlal_n_s16(hi, vget_high_s16(v), w[kx]);
+                        }
+                    }
+                }
+
+                /* vmovn : troncature sur 16 bits, comme (short)acc */
+                int16x8_t o = vcombine_s16(vmovn_s32(vshrq_n_s32(lo, FIXED_POINT)),
+                                           vmovn_s32(vshrq_n_s32(hi, FIXED_POINT)));
+                vst1q_s16(output + (k * oh + y) * ow + x, vmaxq_s16(o, vdupq_n_s16(0)));
+            }
+        }
+    }
+}
+
+
+static void conv1_u8_neon(const unsigned char *input, const short *kernel,
+                          const int *bias, short *output)
+{
+    int k, y, x, z, ky, kx;
+
+    for (k = 0; k < CONV1_NBOUTPUT; k++) {
+        const short *wk = kernel + k * IMG_DEPTH * KDIM * KDIM;
+        int32x4_t b = vdupq_n_s32(bias[k]);
+
+        for (y = 0; y < CONV1_HEIGHT; y++) {
+            for (x = 0; x < CONV1_WIDTH; x += 8) {
+                int32x4_t lo = b, hi = b;
+
+                for (z = 0; z < IMG_DEPTH; z++) {
+                    for (ky = 0; ky < KDIM; ky++) {
+                        const unsigned char *r = input + (z * IMG_HEIGHT + y + ky) * IMG_WIDTH + x;
+                        const short *w = wk + (z * KDIM + ky) * KDIM;
+
+                        for (kx = 0; kx < KDIM; kx++) {
+                            int16x8_t v = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(r + kx)));
+                            lo = vmlal_n_s16(lo, vget_low_s16(v),  w[kx]);
+                            hi = vmlal_n_s16(hi, vget_high_s16(v), w[kx]);
+                        }
+                    }
+                }
+
+                int16x8_t o = vcombine_s16(vmovn_s32(vshrq_n_s32(lo, FIXED_POINT + CONV1_U8_SHIFT)),
+                                           vmovn_s32(vshrq_n_s32(hi, FIXED_POINT + CONV1_U8_SHIFT)));
+                vst1q_s16(output + (k * CONV1_HEIGHT + y) * CONV1_WIDTH + x,
+                          vmaxq_s16(o, vdupq_n_s16(0)));
+            }
+        }
+    }
+}
+
+#endif /* LENET_NEON */
+
+
+/* ============================================================================
+ *  DISPATCH
+ * ============================================================================
+ */
+typedef void (*conv_impl_fn)(const short *input, int iw, int ih, int nz,
+                             const short *kernel, const short *bias, int nk,
+                             short *output, int ow, int oh);
+
+static conv_impl_fn conv_impl(void)
+{
+#if defined(LENET_X86)
+    if (__builtin_cpu_supports("avx2"))
+        return conv_avx2;
+    return conv_sse2;
+#elif defined(LENET_NEON)
+    return conv_neon;
+#else
+    return 0;
+#endif
+}
+
+const char *lenet_simd_isa(void)
+{
+#if defined(LENET_X86)
+    return __builtin_cpu_supports("avx2") ? "avx2" : "sse2";
+#elif defined(LENET_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+
+/* ============================================================================
+ *  CONV1 / CONV2 : même signature que les versions scalaires
+ * ============================================================================
+ */
+void Conv1_28x28x1_5x5x20_1_0_fixed_simd(
+        short input[IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short kernel[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        short bias[CONV1_NBOUTPUT],
+        short output[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH])
+{
+    conv_impl_fn f = conv_impl();
+
+    if (!f) {
+        Conv1_28x28x1_5x5x20_1_0_fixed(input, kernel, bias, output);
+        return;
+    }
+    f(&input[0][0][0], IMG_WIDTH, IMG_HEIGHT, IMG_DEPTH,
+      &kernel[0][0][0][0], bias, CONV1_NBOUTPUT,
+      &output[0][0][0], CONV1_WIDTH, CONV1_HEIGHT);
+}
+
+
+void Conv2_12x12x20_5x5x40_1_0_fixed_simd(
+        short input[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH],
+        short kernel[CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short bias[CONV2_NBOUTPUT],
+        short output[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH])
+{
+    conv_impl_fn f = conv_impl();
+
+    if (!f) {
+        Conv2_12x12x20_5x5x40_1_0_fixed(input, kernel, bias, output);
+        return;
+    }
+    f(&input[0][0][0], POOL1_WIDTH, POOL1_HEIGHT, POOL1_NBOUTPUT,
+      &kernel[0][0][0][0], bias, CONV2_NBOUTPUT,
+      &output[0][0][0], CONV2_WIDTH, CONV2_HEIGHT);
+}
+
+
+void Conv1_28x28x1_5x5x20_1_0_fixed_u8_simd(
+        unsigned char input[IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short kernel[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        int   bias[CONV1_NBOUTPUT],
+        short output[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH])
+{
+#if defined(LENET_X86)
+    if (__builtin_cpu_supports("avx2"))
+        conv1_u8_avx2(&input[0][0][0], &kernel[0][0][0][0], bias, &output[0][0][0]);
+    else
+        conv1_u8_sse2(&input[0][0][0], &kernel[0][0][0][0], bias, &output[0][0][0]);
+#elif defined(LENET_NEON)
+    conv1_u8_neon(&input[0][0][0], &kernel[0][0][0][0], bias, &output[0][0][0]);
+#else
+    Conv1_28x28x1_5x5x20_1_0_fixed_u8(input, kernel, bias, output);
+#endif
+}
+
+#endif
@@ -0,0 +1,249 @@
+/**
+  ******************************************************************************
+  * @file    csr_fixed.c
+  * @brief   Pruned FC1 in compressed sparse row (CSR) format : conversion,
+  *          versioned file (writer + read-only mmap loader) and kernel
+  * @note    CPU only. Le fichier est produit par prune_tool.c.
+  ******************************************************************************
+  */
+
+#ifndef __SYNTHESIS__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "lenet_cnn_fixed_point.h"
+
+
+static inline short relu_fixed(short x)
+{
+    return (x > 0) ? x : 0;
+}
+
+static unsigned int csr_align(unsigned int off)
+{
+    return (off + LENET_WEIGHTS_ALIGN - 1) & ~(LENET_WEIGHTS_ALIGN - 1);
+}
+
+
+/**************************************
+ *  CONVERSION DENSE -> CSR
+ *  Tableaux alloués ensemble (un seul bloc), libérés par lenet_csr_free.
+ **************************************/
+int lenet_csr_from_dense(const short *dense, int rows, int cols, lenet_csr_t *c)
+{
+    int r, i, nnz = 0;
+
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+
+    for (i = 0; i < rows * cols; i++)
+        nnz += (dense[i] != 0);
+
+    size_t sz = (rows + 1) * sizeof(unsigned int) + nnz * (sizeof(unsigned short) + sizeof(short));
+    unsigned char *mem = malloc(sz ? sz : 1);
+    if (!mem) {
+        printf("ERROR: out of memory\n");
+        return -1;
+    }
+
+    unsigned int   *row_ptr = (unsigned int*)mem;
+    short          *val     = (short*)(row_ptr + rows + 1);
+    unsigned short *col     = (unsigned short*)(val + nnz);
+
+    nnz = 0;
+    for (r = 0; r < rows; r++) {
+        row_ptr[r] = nnz;
+        for (i = 0; i < cols; i++) {
+            short v = dense[r * cols + i];
+            if (v) {
+                col[nnz] = (unsigned short)i;
+                val[nnz] = v;
+                nnz++;
+            }
+        }
+    }
+    row_ptr[rows] = nnz;
+
+    c->rows    = rows;
+    c->cols    = cols;
+    c->nnz     = nnz;
+    c->row_ptr = row_ptr;
+    c->col     = col;
+    c->val     = val;
+    c->mem     = mem;
+    return 0;
+}
+
+
+/**************************************
+ *  FICHIER CSR
+ *
+ *    lenet_csr_header_t
+ *    row_ptr  uint32 [rows + 1]     aligné sur LENET_WEIGHTS_ALIGN
+ *    col      uint16 [nnz]          aligné
+ *    val      int16  [nnz]          aligné
+ **************************************/
+int lenet_csr_save(const char *filename, const lenet_csr_t *c)
+{
+    static const char pad[LENET_WEIGHTS_ALIGN];
+    lenet_csr_header_t h;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, LENET_CSR_MAGIC, sizeof(h.magic));
+    h.version     = LENET_CSR_VERSION;
+    h.endian      = 0x01020304;
+    h.fixed_point = FIXED_POINT;
+    h.rows        = c->rows;
+    h.cols        = c->cols;
+    h.nnz         = c->nnz;
+    h.row_ptr_off = csr_align(sizeof(h));
+    h.col_off     = csr_align(h.row_ptr_off + (c->rows + 1) * sizeof(unsigned int));
+    h.val_off     = csr_align(h.col_off + c->nnz * sizeof(unsigned short));
+    h.file_size   = csr_align(h.val_off + c->nnz * sizeof(short));
+
+    FILE *f = fopen(filename, "wb");
+    if (!f) {
+        printf("ERROR: Cannot create %s\n", filename);
+        return -1;
+    }
+
+    long pos = (long)fwrite(&h, 1, sizeof(h), f);
+    pos += (long)fwrite(pad, 1, h.row_ptr_off - pos, f);
+    pos += (long)fwrite(c->row_ptr, 1, (c->rows + 1) * sizeof(unsigned int), f);
+    pos += (long)fwrite(pad, 1, h.col_off - pos, f);
+    pos += (long)fwrite(c->col, 1, c->nnz * sizeof(unsigned short), f);
+    pos += (long)fwrite(pad, 1, h.val_off - pos, f);
+    pos += (long)fwrite(c->val, 1, c->nnz * sizeof(short), f);
+    pos += (long)fwrite(pad, 1, h.file_size - pos, f);
+
+    if (fclose(f) != 0 || pos != (long)h.file_size) {
+        printf("ERROR: Write error on %s\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+
+int lenet_csr_map(const char *filename, int rows, int cols, lenet_csr_t *c)
+{
+    struct stat st;
+    const lenet_csr_header_t *h;
+    const unsigned char *base;
+    unsigned int r;
+
+    memset(c, 0, sizeof(*c));
+    c->fd = open(filename, O_RDONLY);
+    if (c->fd < 0) {
+        printf("ERROR: Cannot open %s\n", filename);
+        return -1;
+    }
+
+    if (fstat(c->fd, &st) != 0 || (size_t)st.st_size < sizeof(*h)) {
+        printf("ERROR: %s is not a CSR file\n", filename);
+        lenet_csr_free(c);
+        return -1;
+    }
+
+    c->size = (size_t)st.st_size;
+    c->map  = mmap(NULL, c->size, PROT_READ, MAP_SHARED, c->fd, 0);
+    if (c->map == MAP_FAILED) {
+        c->map = NULL;
+        printf("ERROR: Cannot mmap %s\n", filename);
+        lenet_csr_free(c);
+        return -1;
+    }
+
+    base = (const unsigned char*)c->map;
+    h    = (const lenet_csr_header_t*)base;
+
+    if (memcmp(h->magic, LENET_CSR_MAGIC, sizeof(h->magic)) != 0) {
+        printf("ERROR: %s is not a CSR file\n", filename);
+        lenet_csr_free(c);
+        return -1;
+    }
+    if (h->version != LENET_CSR_VERSION || h->endian != 0x01020304 ||
+        h->fixed_point != FIXED_POINT ||
+        h->rows != (unsigned int)rows || h->cols != (unsigned int)cols ||
+        h->file_size > c->size ||
+        ((h->row_ptr_off | h->col_off | h->val_off) & (LENET_WEIGHTS_ALIGN - 1)) != 0 ||
+        /* en 64 bits : size_t fait 32 bits sur le Zynq PS */
+        h->row_ptr_off + (h->rows + 1ULL) * sizeof(unsigned int) > h->file_size ||
+        h->col_off + (unsigned long long)h->nnz * sizeof(unsigned short) > h->file_size ||
+        h->val_off + (unsigned long long)h->nnz * sizeof(short) > h->file_size) {
+        printf("ERROR: %s : bad header or shape (%ux%u, expected %dx%d)\n",
+               filename, h->rows, h->cols, rows, cols);
+        lenet_csr_free(c);
+        return -1;
+    }
+
+    c->rows    = rows;
+    c->cols    = cols;
+    c->nnz     = h->nnz;
+    c->row_ptr = (const unsigned int*)(base + h->row_ptr_off);
+    c->col     = (const unsigned short*)(base + h->col_off);
+    c->val     = (const short*)(base + h->val_off);
+
+    /* les indices servent d'adresses dans le noyau : on les vérifie une fois */
+    for (r = 0; r < h->rows; r++)
+        if (c->row_ptr[r] > c->row_ptr[r + 1]) break;
+    if (r < h->rows || c->row_ptr[0] != 0 || c->row_ptr[h->rows] != h->nnz) {
+        printf("ERROR: %s : corrupted row pointers\n", filename);
+        lenet_csr_free(c);
+        return -1;
+    }
+    for (r = 0; r < h->nnz; r++)
+        if (c->col[r] >= (unsigned int)cols) {
+            printf("ERROR: %s : column index out of range\n", filename);
+            lenet_csr_free(c);
+            return -1;
+        }
+
+    return 0;
+}
+
+
+void lenet_csr_free(lenet_csr_t *c)
+{
+    if (c->map)
+        munmap(c->map, c->size);
+    if (c->fd >= 0)
+        close(c->fd);
+    free(c->mem);
+
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+}
+
+
+/**************************************
+ *  FC1 CSR
+ *  Seuls les poids conservés sont lus : MACs et octets de poids
+ *  proportionnels au nombre de non nuls. Bit-exact avec Fc1_40_400_fixed
+ *  sur le noyau élagué.
+ **************************************/
+void Fc1_40_400_fixed_csr(
+        short input [POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        const lenet_csr_t *c,
+        short bias  [FC1_NBOUTPUT],
+        short output[FC1_NBOUTPUT])
+{
+    const short *in = &input[0][0][0];
+    unsigned int k, j;
+
+    for (k = 0; k < FC1_NBOUTPUT; k++) {
+        int acc = ((int)bias[k]) << FIXED_POINT;
+
+        for (j = c->row_ptr[k]; j < c->row_ptr[k + 1]; j++)
+            acc += (int)c->val[j] * (int)in[c->col[j]];
+
+        output[k] = relu_fixed((short)(acc >> FIXED_POINT));
+    }
+}
+
+#endif
@@ -100,6 +100,86 @@ void Fc2_400_10_fixed(
 
 
 
+// ------------------------------
+//  FC1 / FC2 en mode batch (GEMM)
+// ------------------------------
+//
+// n images (n <= LENET_BATCH_MAX) traitées ensemble :
+//   output[n][K] = ReLU( bias[K] + input[n][I] x kernel[K][I]^T )
+//
+// Les activations sont d'abord transposées en act[I][n] : chaque poids
+// kernel[k][i] est lu UNE fois pour tout le batch et la boucle interne
+// (sur les images) est contiguë, donc vectorisable par le compilateur.
+// Même ordre d'accumulation que Fc1_40_400_fixed → résultat bit-exact.
+//
+void Fc1_40_400_fixed_batch(
+        unsigned short n,
+        short input [][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short kernel[FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short bias  [FC1_NBOUTPUT],
+        short output[][FC1_NBOUTPUT])
+{
+    short act[FC1_NBINPUT][LENET_BATCH_MAX];
+    int acc[LENET_BATCH_MAX];
+    unsigned short k, i, b;
+
+    for (b = 0; b < n; b++) {
+        short *in = &input[b][0][0][0];
+        for (i = 0; i < FC1_NBINPUT; i++)
+            act[i][b] = in[i];
+    }
+
+    for (k = 0; k < FC1_NBOUTPUT; k++) {
+
+        short *w = &kernel[k][0][0][0];
+
+        for (b = 0; b < n; b++)
+            acc[b] = ((int)bias[k]) << FIXED_POINT;
+
+        for (i = 0; i < FC1_NBINPUT; i++) {
+            int wi = (int)w[i];
+            for (b = 0; b < n; b++)
+                acc[b] += (int)act[i][b] * wi;
+        }
+
+        for (b = 0; b < n; b++)
+            output[b][k] = relu_fixed((short)(acc[b] >> FIXED_POINT));
+    }
+}
+
+
+void Fc2_400_10_fixed_batch(
+        unsigned short n,
+        short input [][FC1_NBOUTPUT],
+        short kernel[FC2_NBOUTPUT][FC1_NBOUTPUT],
+        short bias  [FC2_NBOUTPUT],
+        short output[][FC2_NBOUTPUT])
+{
+    short act[FC1_NBOUTPUT][LENET_BATCH_MAX];
+    int acc[LENET_BATCH_MAX];
+    unsigned short k, i, b;
+
+    for (b = 0; b < n; b++)
+        for (i = 0; i < FC1_NBOUTPUT; i++)
+            act[i][b] = input[b][i];
+
+    for (k = 0; k < FC2_NBOUTPUT; k++) {
+
+        for (b = 0; b < n; b++)
+            acc[b] = ((int)bias[k]) << FIXED_POINT;
+
+        for (i = 0; i < FC1_NBOUTPUT; i++) {
+            int wi = (int)kernel[k][i];
+            for (b = 0; b < n; b++)
+                acc[b] += (int)act[i][b] * wi;
+        }
+
+        for (b = 0; b < n; b++)
+            output[b][k] = (short)(acc[b] >> FIXED_POINT);   // logits
+    }
+}
+
+
 // ------------------------------
 //  Softmax FIXED POINT
 //  (version du prof, améliorée + stabilisée)
@@ -144,3 +224,106 @@ void Softmax_fixed(short vector_in[FC2_NBOUTPUT], float vector_out[FC2_NBOUTPUT]
         vector_out[k] = f[k] / sum;
     }
 }
+
+
+
+// ------------------------------
+//  Sortie entière : softmax LUT + argmax (sans FPU)
+// ------------------------------
+//
+// exp(-d), d = max - x >= 0 en Q8, est découpé en partie entière et
+// fractionnaire :  exp(-d) = EXP_INT[d >> 8] * EXP_FRAC[d & 0xFF]
+// (deux tables Q15, 1.0 = 32768). Au-delà de d = 12, exp(-d) < 1 LSB.
+// Une seule division par appel (inverse de la somme). Synthétisable.
+//
+#define EXP_INT_SIZE 12
+
+static const unsigned short EXP_INT[EXP_INT_SIZE] = {
+    32768, 12055, 4435, 1631, 600, 221, 81, 30, 11, 4, 1, 1,
+};
+
+static const unsigned short EXP_FRAC[1 << FIXED_POINT] = {
+    32768, 32640, 32513, 32386, 32260, 32134, 32009, 31884, 31760, 31636, 31513, 31390, 31267, 31146, 31024, 30903,
+    30783, 30663, 30543, 30424, 30305, 30187, 30070, 29952, 29836, 29719, 29603, 29488, 29373, 29259, 29144, 29031,
+    28918, 28805, 28693, 28581, 28469, 28358, 28248, 28138, 28028, 27919, 27810, 27701, 27593, 27486, 27379, 27272,
+    27166, 27060, 26954, 26849, 26744, 26640, 26536, 26433, 26330, 26227, 26125, 26023, 25922, 25821, 25720, 25620,
+    25520, 25420, 25321, 25222, 25124, 25026, 24929, 24831, 24735, 24638, 24542, 24446, 24351, 24256, 24162, 24067,
+    23974, 23880, 23787, 23694, 23602, 23510, 23418, 23327, 23236, 23145, 23055, 22965, 22876, 22787, 22698, 22609,
+    22521, 22433, 22346, 22259, 22172, 22085, 21999, 21914, 21828, 21743, 21658, 21574, 21490, 21406, 21323, 21239,
+    21157, 21074, 20992, 20910, 20829, 20747, 20667, 20586, 20506, 20426, 20346, 20267, 20188, 20109, 20031, 19953,
+    19875, 19797, 19720, 19643, 19567, 19490, 19414, 19339, 19263, 19188, 19113, 19039, 18965, 18891, 18817, 18744,
+    18671, 18598, 18525, 18453, 18381, 18310, 18238, 18167, 18096, 18026, 17955, 17885, 17816, 17746, 17677, 17608,
+    17539, 17471, 17403, 17335, 17268, 17200, 17133, 17066, 17000, 16934, 16868, 16802, 16736, 16671, 16606, 16541,
+    16477, 16413, 16349, 16285, 16221, 16158, 16095, 16032, 15970, 15908, 15846, 15784, 15722, 15661, 15600, 15539,
+    15479, 15418, 15358, 15298, 15239, 15179, 15120, 15061, 15002, 14944, 14886, 14828, 14770, 14712, 14655, 14598,
+    14541, 14484, 14428, 14371, 14315, 14259, 14204, 14149, 14093, 14038, 13984, 13929, 13875, 13821, 13767, 13713,
+    13660, 13606, 13553, 13501, 13448, 13396, 13343, 13291, 13239, 13188, 13136, 13085, 13034, 12983, 12933, 12882,
+    12832, 12782, 12732, 12683, 12633, 12584, 12535, 12486, 12437, 12389, 12341, 12292, 12245, 12197, 12149, 12102,
+};
+
+// exp(-(max - x)) en Q15
+static int exp_neg_q15(int d)
+{
+    if (d >= (EXP_INT_SIZE << FIXED_POINT))
+        return 0;
+    return ((int)EXP_INT[d >> FIXED_POINT] *
+            (int)EXP_FRAC[d & ((1 << FIXED_POINT) - 1)]) >> SOFTMAX_Q;
+}
+
+
+//
+// vector_in  : [10] short (logits Q8)
+// vector_out : [10] short (probabilités Q15, 32767 ~ 1.0)
+//
+void Softmax_fixed_lut(short vector_in[FC2_NBOUTPUT], short vector_out[FC2_NBOUTPUT])
+{
+    unsigned short k;
+    int e[FC2_NBOUTPUT];
+
+    short maxval = vector_in[0];
+    for (k = 1; k < FC2_NBOUTPUT; k++) {
+        if (vector_in[k] > maxval) maxval = vector_in[k];
+    }
+
+    int sum = 0;   // >= 32768 (terme du max)
+    for (k = 0; k < FC2_NBOUTPUT; k++) {
+        e[k] = exp_neg_q15((int)maxval - (int)vector_in[k]);
+        sum += e[k];
+    }
+
+    int inv = (1 << 30) / sum;   // Q15 : 1 / sum
+    for (k = 0; k < FC2_NBOUTPUT; k++) {
+        int p = (e[k] * inv) >> SOFTMAX_Q;
+        vector_out[k] = (short)((p > 32767) ? 32767 : p);
+    }
+}
+
+
+//
+// Classe prédite directement sur les logits (softmax monotone : même
+// argmax). confidence (optionnel) : probabilité softmax Q15 de la classe.
+//
+int Argmax_fixed(short vector_in[FC2_NBOUTPUT], short *confidence)
+{
+    unsigned short k;
+    short maxval = vector_in[0];
+    int pred = 0;
+
+    for (k = 1; k < FC2_NBOUTPUT; k++) {
+        if (vector_in[k] > maxval) {
+            maxval = vector_in[k];
+            pred = k;
+        }
+    }
+
+    if (confidence) {
+        int sum = 0;
+        for (k = 0; k < FC2_NBOUTPUT; k++)
+            sum += exp_neg_q15((int)maxval - (int)vector_in[k]);
+
+        int p = (1 << 30) / sum;   // exp(0) = 1.0 → 32768 / sum en Q15
+        *confidence = (short)((p > 32767) ? 32767 : p);
+    }
+
+    return pred;
+}
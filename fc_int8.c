@@ -0,0 +1,71 @@
+/**
+  ******************************************************************************
+  * @file    fc_int8.c
+  * @brief   Fully connected layers (FC1, FC2) for INT8 LeNet
+  * @note    FC1 : 256 000 poids int8 (250 Ko) au lieu de 500 Ko en Q8/short
+  ******************************************************************************
+  */
+
+#include "lenet_cnn_fixed_point.h"
+
+
+// ------------------------------
+//  Fully Connected Layer FC1
+// ------------------------------
+//
+// acc = bias_q[k] + Σ in_u8 * w_i8   →   out_u8 = sat(ReLU(requant(acc)))
+//
+void Fc1_40_400_int8(
+        unsigned char  input [POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        signed char    kernel[FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        int            bias  [FC1_NBOUTPUT],
+        lenet_q_mult_t mult  [FC1_NBOUTPUT],
+        unsigned char  output[FC1_NBOUTPUT])
+{
+    unsigned short k, z, y, x;
+
+    for (k = 0; k < FC1_NBOUTPUT; k++) {
+
+        int acc = bias[k];
+
+        for (z = 0; z < POOL2_NBOUTPUT; z++) {
+            for (y = 0; y < POOL2_HEIGHT; y++) {
+                for (x = 0; x < POOL2_WIDTH; x++) {
+                    acc += (int)input[z][y][x] * (int)kernel[k][z][y][x];
+                }
+            }
+        }
+
+        output[k] = lenet_requant_u8(acc, mult[k]);
+    }
+}
+
+
+// ------------------------------
+//  Fully Connected Layer FC2
+// ------------------------------
+//
+// Sortie : logits en Q8 (short), comme Fc2_400_10_fixed, pour réutiliser
+// Softmax_fixed / Argmax_fixed.
+//
+void Fc2_400_10_int8(
+        unsigned char  input [FC1_NBOUTPUT],
+        signed char    kernel[FC2_NBOUTPUT][FC1_NBOUTPUT],
+        int            bias  [FC2_NBOUTPUT],
+        lenet_q_mult_t mult  [FC2_NBOUTPUT],
+        short          output[FC2_NBOUTPUT])
+{
+    unsigned short k, i;
+
+    for (k = 0; k < FC2_NBOUTPUT; k++) {
+
+        int acc = bias[k];
+
+        for (i = 0; i < FC1_NBOUTPUT; i++) {
+            acc += (int)input[i] * (int)kernel[k][i];
+        }
+
+        int v = lenet_requant(acc, mult[k]);
+        output[k] = (short)((v < -32768) ? -32768 : (v > 32767) ? 32767 : v);
+    }
+}
@@ -0,0 +1,568 @@
+/**
+  ******************************************************************************
+  * @file    hls_cost_tool.c
+  * @brief   Analytical cycle / DSP / BRAM model of the HLS layers
+  *          (conv_fixed.c, pool_fixed.c, fc_fixed.c) for a pipeline II,
+  *          unroll factor and kernel / input partition factor per layer,
+  *          calibrated on the two HLS reports of the README, + design space
+  *          sweep with its Pareto front
+  * @note    gcc -O2 -o hls_cost_tool hls_cost_tool.c -lm
+  *          ./hls_cost_tool                                 (calibration, HW_PAR)
+  *          ./hls_cost_tool --cfg conv2:ii=1,u=25,pk=5,pin=5 --cfg fc1:ii=1,u=8,pk=4,pin=4
+  *          ./hls_cost_tool --sweep [--dsp 220] [--bram 280] [--top 25]
+  *          Estimation : à confirmer par une synthèse HLS avant intégration.
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+#include "lenet_cnn_fixed_point.h"
+
+
+/* ============================================================================
+ *  Modèle
+ * ============================================================================
+ *
+ *  Chaque couche = O sorties, chacune réduite sur R lectures de input (et
+ *  de kernel pour les MAC). La boucle de réduction (aplatie) est déroulée
+ *  d'un facteur U ; kernel et input sont partitionnés (cyclic) en pk / pin
+ *  bancs de `ports` ports de lecture chacun (constante calibrée).
+ *
+ *      lectures / itération      : U sur kernel, U sur input
+ *      II mémoire                : max(ceil(U / (ports x pk)), ceil(U / (ports x pin)))
+ *      II effectif               : max(II demandé, II mémoire)
+ *      conflits de port          : II effectif - II demandé (cycles perdus / itération)
+ *
+ *      sans pipeline (ii = 0)    : O x (R/U x seq_op x II mémoire + seq_out)
+ *      pipeline, U < R           : O x (R/U x II effectif + depth(U) + seq_out)
+ *      pipeline, U = R           : boucle des sorties pipelinée (réduction
+ *                                  entièrement déroulée) : O x II effectif + depth(U)
+ *      depth(U)                  : P_DEPTH + ceil(log2 U) (arbre d'additions)
+ *
+ *      DSP    : ceil(U / II effectif) par couche MAC (multiplieur 16x16 +
+ *               accumulateur = 1 DSP48) : HLS partage les U multiplications
+ *               d'une itération sur les II cycles dont il dispose.
+ *      BRAM18 : par tableau local, pk (pin) bancs de ceil(mots / banc / 1024)
+ *               BRAM18 en 1K x 18 ; un banc de moins de P_LUT_WORDS mots va
+ *               en registres / LUTRAM (0 BRAM). Les sorties d'une couche sont
+ *               comptées comme input de la suivante. Les noyaux et l'image
+ *               sont des arguments de lenet_cnn_fixed() : lus par
+ *               l'interface du bloc, ils ne coûtent de BRAM que partitionnés
+ *               (copie locale en pk / pin bancs).
+ *
+ *  Calibrage (deux constantes, deux mesures : ajustement, pas validation) :
+ *    - seq_op : cycles par lecture non pipelinée, fixé pour que HW_SEQ
+ *               (aucun pragma : ii = 0, U = 1, P = 1) donne 6 447 885 cycles ;
+ *    - ports  : ports de lecture effectifs par tableau non partitionné, fixé
+ *               pour que HW_PAR (PIPELINE sur la boucle des sorties, réduction
+ *               déroulée par HLS, pas de partition) donne 750 235 cycles.
+ *               Physiquement 2 (BRAM double port) ; l'écart absorbe ce que
+ *               HLS fait seul (petites ROM en LUT, partition automatique).
+ *  Le placement exact des pragmas de HW_PAR n'est pas dans le dépôt : la
+ *  configuration de référence ci-dessus est une hypothèse.
+ */
+
+#define HW_SEQ_CYCLES   6447885.0       // README, HW_SEQ (aucun pragma)
+#define HW_PAR_CYCLES   750235.0        // README, HW_PAR (#pragma HLS PIPELINE)
+
+#define P_SEQ_OUT       2               // cycles par sortie hors réduction (biais, écriture)
+#define P_DEPTH         4               // profondeur du pipeline (lecture, mult, add, écriture)
+#define P_LUT_WORDS     64              // banc <= 64 mots : registres / LUTRAM
+
+#define ZYNQ7020_DSP    220
+#define ZYNQ7020_BRAM   280             // BRAM18
+
+#define NB_LAYERS       6
+#define MAX_OPTS        32
+
+
+typedef struct {
+    const char *name;
+    const char *func;
+    const char *file;
+    long        outputs;                // O
+    long        red;                    // R
+    int         mac;                    // 1 : MAC (kernel + DSP), 0 : max (pool)
+    long        kernel_words;
+    long        input_words;
+    int         input_arg;              // 1 : input est un argument de la top-function
+} layer_t;
+
+typedef struct {
+    int ii;                             // 0 : pas de pipeline
+    int u;                              // déroulage de la réduction
+    int pk;                             // partition de kernel
+    int pin;                            // partition de input
+} cfg_t;
+
+typedef struct {
+    double seq_op;
+    double ports;
+} model_t;
+
+typedef struct {
+    double cycles;
+    int    ii_eff;
+    int    conflicts;
+    int    dsp;
+    int    bram;
+} cost_t;
+
+
+static const layer_t layers[NB_LAYERS] = {
+    { "conv1", "Conv1_28x28x1_5x5x20_1_0_fixed", "conv_fixed.c",
+      (long)CONV1_NBOUTPUT * CONV1_HEIGHT * CONV1_WIDTH, (long)IMG_DEPTH * CONV1_DIM * CONV1_DIM, 1,
+      (long)CONV1_NBOUTPUT * IMG_DEPTH * CONV1_DIM * CONV1_DIM, (long)IMG_DEPTH * IMG_HEIGHT * IMG_WIDTH, 1 },
+    { "pool1", "Pool1_24x24x20_2x2x20_2_0_fixed", "pool_fixed.c",
+      (long)POOL1_NBOUTPUT * POOL1_HEIGHT * POOL1_WIDTH, POOL1_DIM * POOL1_DIM, 0,
+      0, (long)CONV1_NBOUTPUT * CONV1_HEIGHT * CONV1_WIDTH , 0 },
+    { "conv2", "Conv2_12x12x20_5x5x40_1_0_fixed", "conv_fixed.c",
+      (long)CONV2_NBOUTPUT * CONV2_HEIGHT * CONV2_WIDTH, (long)POOL1_NBOUTPUT * CONV2_DIM * CONV2_DIM, 1,
+      (long)CONV2_NBOUTPUT * POOL1_NBOUTPUT * CONV2_DIM * CONV2_DIM, (long)POOL1_NBOUTPUT * POOL1_HEIGHT * POOL1_WIDTH , 0 },
+    { "pool2", "Pool2_8x8x40_2x2x40_2_0_fixed", "pool_fixed.c",
+      (long)POOL2_NBOUTPUT * POOL2_HEIGHT * POOL2_WIDTH, POOL2_DIM * POOL2_DIM, 0,
+      0, (long)CONV2_NBOUTPUT * CONV2_HEIGHT * CONV2_WIDTH , 0 },
+    { "fc1",   "Fc1_40_400_fixed", "fc_fixed.c",
+      FC1_NBOUTPUT, FC1_NBINPUT, 1,
+      (long)FC1_NBOUTPUT * FC1_NBINPUT, FC1_NBINPUT , 0 },
+    { "fc2",   "Fc2_400_10_fixed", "fc_fixed.c",
+      FC2_NBOUTPUT, FC1_NBOUTPUT, 1,
+      (long)FC2_NBOUTPUT * FC1_NBOUTPUT, FC1_NBOUTPUT , 0 },
+};
+
+
+static long ceil_div(long a, long b)
+{
+    return (a + b - 1) / b;
+}
+
+static int ceil_log2(long x)
+{
+    int n = 0;
+
+    while ((1L << n) < x)
+        n++;
+    return n;
+}
+
+
+/**************************************
+ *  COUT D'UNE COUCHE
+ **************************************/
+static int bram_of(long words, int p)
+{
+    long bank = ceil_div(words, p);
+
+    if (words == 0 || bank <= P_LUT_WORDS)
+        return 0;
+    return (int)(p * ceil_div(bank, 1024));
+}
+
+/* Argument de la top-function : BRAM seulement pour une copie partitionnée */
+static int bram_of_arg(long words, int p)
+{
+    return (p > 1) ? bram_of(words, p) : 0;
+}
+
+static void layer_cost(const layer_t *l, const cfg_t *c, const model_t *m, cost_t *r)
+{
+    long   u     = (c->u < l->red) ? c->u : l->red;
+    long   trips = ceil_div(l->red, u);
+    int    ii_in = (int)ceil(u / (m->ports * c->pin) - 1e-9);
+    int    ii_k  = l->mac ? (int)ceil(u / (m->ports * c->pk) - 1e-9) : 1;
+    int    ii_mem = (ii_in > ii_k) ? ii_in : ii_k;
+    double depth = P_DEPTH + ceil_log2(u);
+
+    if (ii_mem < 1)
+        ii_mem = 1;
+
+    if (c->ii == 0) {
+        r->ii_eff    = ii_mem;
+        r->conflicts = ii_mem - 1;
+        r->cycles    = (double)l->outputs * (trips * m->seq_op * ii_mem + P_SEQ_OUT);
+    } else {
+        r->ii_eff    = (ii_mem > c->ii) ? ii_mem : c->ii;
+        r->conflicts = r->ii_eff - c->ii;
+        if (u < l->red)
+            r->cycles = (double)l->outputs * ((double)trips * r->ii_eff + depth + P_SEQ_OUT);
+        else
+            r->cycles = (double)l->outputs * r->ii_eff + depth;
+    }
+
+    r->dsp  = l->mac ? (int)ceil_div(u, r->ii_eff) : 0;
+    r->bram = bram_of_arg(l->kernel_words, c->pk) +
+              (l->input_arg ? bram_of_arg(l->input_words, c->pin) : bram_of(l->input_words, c->pin));
+}
+
+static double total_cycles(const cfg_t cfg[NB_LAYERS], const model_t *m)
+{
+    double sum = 0.0;
+    cost_t r;
+    int i;
+
+    for (i = 0; i < NB_LAYERS; i++) {
+        layer_cost(&layers[i], &cfg[i], m, &r);
+        sum += r.cycles;
+    }
+    return sum;
+}
+
+
+/**************************************
+ *  CONFIGURATIONS DE REFERENCE
+ **************************************/
+static void preset_seq(cfg_t cfg[NB_LAYERS])
+{
+    int i;
+
+    for (i = 0; i < NB_LAYERS; i++) {
+        cfg[i].ii  = 0;
+        cfg[i].u   = 1;
+        cfg[i].pk  = 1;
+        cfg[i].pin = 1;
+    }
+}
+
+static void preset_par(cfg_t cfg[NB_LAYERS])
+{
+    int i;
+
+    for (i = 0; i < NB_LAYERS; i++) {
+        cfg[i].ii  = 1;
+        cfg[i].u   = (int)layers[i].red;
+        cfg[i].pk  = 1;
+        cfg[i].pin = 1;
+    }
+}
+
+
+/**************************************
+ *  CALIBRAGE
+ *  seq_op : forme close (HW_SEQ est linéaire en seq_op)
+ *  ports  : balayage, le total est une fonction en escalier de ports
+ **************************************/
+static void calibrate(model_t *m)
+{
+    cfg_t  cfg[NB_LAYERS];
+    double reads = 0.0, outs = 0.0, best = -1.0, p;
+    int i;
+
+    for (i = 0; i < NB_LAYERS; i++) {
+        reads += (double)layers[i].outputs * layers[i].red;
+        outs  += (double)layers[i].outputs;
+    }
+    m->seq_op = (HW_SEQ_CYCLES - outs * P_SEQ_OUT) / reads;
+
+    preset_par(cfg);
+    m->ports = 2.0;
+    for (p = 1.0; p <= 8.0; p += 0.001) {
+        model_t t = *m;
+        double err;
+
+        t.ports = p;
+        err = fabs(total_cycles(cfg, &t) - HW_PAR_CYCLES);
+        if (best < 0.0 || err < best) {
+            best     = err;
+            m->ports = p;
+        }
+    }
+}
+
+
+/**************************************
+ *  RAPPORT D'UNE CONFIGURATION
+ **************************************/
+static void cfg_str(const cfg_t *c, char *s, size_t n)
+{
+    if (c->ii)
+        snprintf(s, n, "ii=%d,u=%d,pk=%d,pin=%d", c->ii, c->u, c->pk, c->pin);
+    else
+        snprintf(s, n, "nopipe,u=%d,pk=%d,pin=%d", c->u, c->pk, c->pin);
+}
+
+static void report(const char *title, const cfg_t cfg[NB_LAYERS], const model_t *m)
+{
+    double sum = 0.0;
+    int dsp = 0, bram = 0, i;
+
+    printf("\n%s\n", title);
+    printf("  %-33s %-13s %-26s %12s %6s %9s %5s %6s\n",
+           "function", "file", "config", "cycles", "II", "conflicts", "DSP", "BRAM18");
+
+    for (i = 0; i < NB_LAYERS; i++) {
+        char s[64];
+        cost_t r;
+
+        layer_cost(&layers[i], &cfg[i], m, &r);
+        cfg_str(&cfg[i], s, sizeof(s));
+        printf("  %-33s %-13s %-26s %12.0f %6d %9d %5d %6d\n",
+               layers[i].func, layers[i].file, s, r.cycles, r.ii_eff, r.conflicts, r.dsp, r.bram);
+        sum  += r.cycles;
+        dsp  += r.dsp;
+        bram += r.bram;
+    }
+    printf("  %-33s %-13s %-26s %12.0f %6s %9s %5d %6d   %s Zynq-7020 (%d DSP, %d BRAM18)\n",
+           "total", "", "", sum, "", "", dsp, bram,
+           (dsp <= ZYNQ7020_DSP && bram <= ZYNQ7020_BRAM) ? "fits" : "exceeds",
+           ZYNQ7020_DSP, ZYNQ7020_BRAM);
+}
+
+
+/**************************************
+ *  BALAYAGE DE L'ESPACE DE CONCEPTION
+ *  Les couches sont des fonctions distinctes : cycles, DSP et BRAM
+ *  s'additionnent. Front de Pareto par couche, puis fusion couche par
+ *  couche en ne gardant que les points non dominés.
+ **************************************/
+typedef struct {
+    double cycles;
+    int    dsp;
+    int    bram;
+    cfg_t  cfg[NB_LAYERS];
+} point_t;
+
+static int dominates(const point_t *a, const point_t *b)
+{
+    return a->cycles <= b->cycles && a->dsp <= b->dsp && a->bram <= b->bram &&
+           (a->cycles < b->cycles || a->dsp < b->dsp || a->bram < b->bram);
+}
+
+static int cmp_cycles(const void *a, const void *b)
+{
+    const point_t *pa = (const point_t*)a, *pb = (const point_t*)b;
+
+    if (pa->cycles != pb->cycles)
+        return (pa->cycles < pb->cycles) ? -1 : 1;
+    if (pa->dsp != pb->dsp)
+        return pa->dsp - pb->dsp;
+    return pa->bram - pb->bram;
+}
+
+/* Garde les points non dominés (et dans le budget) de pts[0..n), renvoie leur nombre */
+static int prune(point_t *pts, int n, int max_dsp, int max_bram)
+{
+    int i, j, k = 0;
+
+    qsort(pts, n, sizeof(point_t), cmp_cycles);
+    for (i = 0; i < n; i++) {
+        int dom = (pts[i].dsp > max_dsp || pts[i].bram > max_bram);
+
+        /* triés par cycles : seul un point déjà gardé peut dominer pts[i] */
+        for (j = 0; j < k && !dom; j++)
+            if (dominates(&pts[j], &pts[i]) ||
+                (pts[j].cycles == pts[i].cycles && pts[j].dsp == pts[i].dsp && pts[j].bram == pts[i].bram))
+                dom = 1;
+        if (!dom)
+            pts[k++] = pts[i];
+    }
+    return k;
+}
+
+/* Diviseurs de n (facteurs de déroulage / partition sans reste) */
+static int divisors(long n, int out[MAX_OPTS])
+{
+    int d, k = 0;
+
+    for (d = 1; d <= n && k < MAX_OPTS; d++)
+        if (n % d == 0)
+            out[k++] = d;
+    return k;
+}
+
+static point_t *layer_front(int li, const model_t *m, int max_dsp, int max_bram, int *count)
+{
+    const layer_t *l = &layers[li];
+    int us[MAX_OPTS], nu = divisors(l->red, us);
+    int ps[MAX_OPTS], np;
+    point_t *pts;
+    int n = 0, a, b, c, ii;
+
+    pts = (point_t*)malloc(sizeof(point_t) * 2 * MAX_OPTS * MAX_OPTS * MAX_OPTS);
+    if (!pts) {
+        printf("ERROR: out of memory\n");
+        exit(1);
+    }
+
+    for (ii = 0; ii <= 1; ii++)
+        for (a = 0; a < nu; a++) {
+            np = divisors(us[a], ps);
+            for (b = 0; b < (l->mac ? np : 1); b++)
+                for (c = 0; c < np; c++) {
+                    point_t *p = &pts[n++];
+                    cost_t r;
+
+                    memset(p, 0, sizeof(*p));
+                    p->cfg[li].ii  = ii;
+                    p->cfg[li].u   = us[a];
+                    p->cfg[li].pk  = ps[b];
+                    p->cfg[li].pin = ps[c];
+                    layer_cost(l, &p->cfg[li], m, &r);
+                    p->cycles = r.cycles;
+                    p->dsp    = r.dsp;
+                    p->bram   = r.bram;
+                }
+        }
+
+    *count = prune(pts, n, max_dsp, max_bram);
+    return pts;
+}
+
+static void sweep(const model_t *m, int max_dsp, int max_bram, int top)
+{
+    point_t *front = NULL;
+    int nfront = 0, li, i, j;
+
+    for (li = 0; li < NB_LAYERS; li++) {
+        int nl;
+        point_t *lf = layer_front(li, m, max_dsp, max_bram, &nl);
+
+        printf("  %-6s : %4d Pareto configuration(s)\n", layers[li].name, nl);
+
+        if (!front) {
+            front  = lf;
+            nfront = nl;
+            continue;
+        } else {
+            point_t *mix = (point_t*)malloc(sizeof(point_t) * (size_t)nfront * nl);
+
+            if (!mix) {
+                printf("ERROR: out of memory\n");
+                exit(1);
+            }
+            for (i = 0; i < nfront; i++)
+                for (j = 0; j < nl; j++) {
+                    point_t *p = &mix[i * nl + j];
+
+                    *p = front[i];
+                    p->cfg[li] = lf[j].cfg[li];
+                    p->cycles += lf[j].cycles;
+                    p->dsp    += lf[j].dsp;
+                    p->bram   += lf[j].bram;
+                }
+            free(front);
+            free(lf);
+            front  = mix;
+            nfront = prune(mix, nfront * nl, max_dsp, max_bram);
+        }
+    }
+
+    printf("\nPareto front (cycles / DSP / BRAM18, DSP <= %d", max_dsp);
+    if (max_bram < INT_MAX)
+        printf(", BRAM18 <= %d", max_bram);
+    printf(") : %d point(s)", nfront);
+    if (nfront > top)
+        printf(", %d shown", top);
+    if (nfront == 0) {
+        printf("\n  no configuration fits these budgets\n");
+        free(front);
+        return;
+    }
+    printf("\n  %12s %5s %6s  %s\n", "cycles", "DSP", "BRAM18", "per-layer ii/u/pk/pin (ii 0 = no pipeline)");
+
+    for (i = 0; i < nfront && i < top; i++) {
+        /* répartis sur tout le front quand il est plus long que top */
+        const point_t *p = &front[(nfront > top) ? (long)i * (nfront - 1) / (top - 1) : i];
+
+        printf("  %12.0f %5d %6d ", p->cycles, p->dsp, p->bram);
+        for (li = 0; li < NB_LAYERS; li++)
+            printf(" %s:%d/%d/%d/%d", layers[li].name,
+                   p->cfg[li].ii, p->cfg[li].u, p->cfg[li].pk, p->cfg[li].pin);
+        printf("\n");
+    }
+    free(front);
+}
+
+
+/**************************************
+ *  LIGNE DE COMMANDE
+ **************************************/
+/* --cfg layer:ii=N,u=N,pk=N,pin=N (champs optionnels, les autres gardent le preset) */
+static int parse_cfg(const char *arg, cfg_t cfg[NB_LAYERS])
+{
+    char buf[128], *tok, *colon;
+    int i;
+
+    strncpy(buf, arg, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    colon = strchr(buf, ':');
+    if (!colon)
+        return -1;
+    *colon = '\0';
+
+    for (i = 0; i < NB_LAYERS; i++)
+        if (strcmp(buf, layers[i].name) == 0)
+            break;
+    if (i == NB_LAYERS)
+        return -1;
+
+    for (tok = strtok(colon + 1, ","); tok; tok = strtok(NULL, ",")) {
+        int v;
+
+        if      (sscanf(tok, "ii=%d",  &v) == 1 && v >= 0) cfg[i].ii  = v;
+        else if (sscanf(tok, "u=%d",   &v) == 1 && v >= 1) cfg[i].u   = v;
+        else if (sscanf(tok, "pk=%d",  &v) == 1 && v >= 1) cfg[i].pk  = v;
+        else if (sscanf(tok, "pin=%d", &v) == 1 && v >= 1) cfg[i].pin = v;
+        else
+            return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    model_t m;
+    cfg_t   ref[NB_LAYERS], cfg[NB_LAYERS];
+    int do_sweep = 0, custom = 0, max_dsp = ZYNQ7020_DSP, max_bram = INT_MAX, top = 25;
+    int i;
+
+    preset_par(cfg);
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--sweep") == 0)
+            do_sweep = 1;
+        else if (strcmp(argv[i], "--seq") == 0)
+            preset_seq(cfg);
+        else if (strcmp(argv[i], "--cfg") == 0 && i + 1 < argc) {
+            if (parse_cfg(argv[++i], cfg) != 0) {
+                printf("ERROR: bad --cfg '%s' (expected layer:ii=N,u=N,pk=N,pin=N, layer in conv1 pool1 conv2 pool2 fc1 fc2)\n", argv[i]);
+                return -1;
+            }
+            custom = 1;
+        }
+        else if (strcmp(argv[i], "--dsp") == 0 && i + 1 < argc)
+            max_dsp = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bram") == 0 && i + 1 < argc)
+            max_bram = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc)
+            top = atoi(argv[++i]);
+        else {
+            printf("Usage: %s [--seq] [--cfg layer:ii=N,u=N,pk=N,pin=N]... [--sweep] [--dsp N] [--bram N] [--top N]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (top < 2)
+        top = 2;
+
+    calibrate(&m);
+
+    printf("Calibration : seq_op %.4f cycles / read (HW_SEQ), %.3f effective read ports / array (HW_PAR)\n",
+           m.seq_op, m.ports);
+    preset_seq(ref);
+    printf("  HW_SEQ (no pragma)               : model %9.0f cycles, report %9.0f (%+.2f %%)\n",
+           total_cycles(ref, &m), HW_SEQ_CYCLES, 100.0 * (total_cycles(ref, &m) / HW_SEQ_CYCLES - 1.0));
+    preset_par(ref);
+    printf("  HW_PAR (PIPELINE on output loop) : model %9.0f cycles, report %9.0f (%+.2f %%)\n",
+           total_cycles(ref, &m), HW_PAR_CYCLES, 100.0 * (total_cycles(ref, &m) / HW_PAR_CYCLES - 1.0));
+
+    report(custom ? "Configuration" : "HW_PAR reference configuration", cfg, &m);
+
+    if (do_sweep) {
+        printf("\nDesign space sweep (ii 0/1, u | R, pk | u, pin | u)\n");
+        sweep(&m, max_dsp, max_bram, top);
+    }
+    return 0;
+}
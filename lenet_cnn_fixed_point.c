@@ -12,7 +12,11 @@
 #include <sys/time.h>
 
 #include "lenet_cnn_fixed_point.h"
-#include "Weights.h"
+
+/* -DLENET_NO_BUILTIN_WEIGHTS : poids chargés uniquement par --weights */
+#ifndef LENET_NO_BUILTIN_WEIGHTS
+#include LENET_WEIGHTS_FILE
+#endif
 
 const int labels_legend[10] = {0,1,2,3,4,5,6,7,8,9};
 
@@ -20,8 +24,12 @@ const int labels_legend[10] = {0,1,2,3,4,5,6,7,8,9};
  *  BUFFERS GLOBAUX FIXED POINT
  **************************************/
 
+/*  Les buffers d'entrée / sortie par image sont dans lenet_ctx_t
+ *  (lenet_ctx.c) : un contexte par thread.
+ *
 short INPUT_FP[IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH];
-/*
+
+
 short CONV1_KERNEL_FP[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM];
 short CONV1_BIAS_FP[CONV1_NBOUTPUT];
 
@@ -34,9 +42,6 @@ short FC1_BIAS_FP[FC1_NBOUTPUT];
 short FC2_KERNEL_FP[FC2_NBOUTPUT][FC1_NBOUTPUT];
 short FC2_BIAS_FP[FC2_NBOUTPUT];
 */
-short FC2_OUTPUT_FP[FC2_NBOUTPUT];
-
-float SOFTMAX_OUTPUT[FC2_NBOUTPUT];
 
 
 /**************************************
@@ -58,8 +63,6 @@ void ReadFc2Bias_float     (char *filename, char *dataset, float *b);
 
 void ConvertWeightsToFixed();
 #endif
-void NormalizeImg_fixed(unsigned char *input, short *output, short width, short height);
-void ReadPgmFile(char *filename, unsigned char *pix);
 
 
 /**************************************
@@ -87,21 +90,305 @@ void lenet_cnn_fixed(
     short pool2_out[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH];
     short fc1_out[FC1_NBOUTPUT];
 
+    LENET_TRACE_BEGIN(CONV1);
     Conv1_28x28x1_5x5x20_1_0_fixed(input, conv1_k, conv1_b, conv1_out);
+    LENET_TRACE_END(CONV1);
+
+    LENET_TRACE_BEGIN(POOL1);
     Pool1_24x24x20_2x2x20_2_0_fixed(conv1_out, pool1_out);
+    LENET_TRACE_END(POOL1);
+
+    LENET_TRACE_BEGIN(CONV2);
     Conv2_12x12x20_5x5x40_1_0_fixed(pool1_out, conv2_k, conv2_b, conv2_out);
+    LENET_TRACE_END(CONV2);
+
+    LENET_TRACE_BEGIN(POOL2);
     Pool2_8x8x40_2x2x40_2_0_fixed(conv2_out, pool2_out);
+    LENET_TRACE_END(POOL2);
+
+    LENET_TRACE_BEGIN(FC1);
     Fc1_40_400_fixed(pool2_out, fc1_k, fc1_b, fc1_out);
+    LENET_TRACE_END(FC1);
+
+    LENET_TRACE_BEGIN(FC2);
     Fc2_400_10_fixed(fc1_out, fc2_k, fc2_b, out);
+    LENET_TRACE_END(FC2);
 }
 
 
 /**************************************
- *  PROGRAMME PRINCIPAL
+ *  TOP LEVEL SUR PIXELS BRUTS
+ *  L'image arrive en octets (AXI 8 bits) : la normalisation est
+ *  repliée dans Conv1 (lenet_conv1_fold_u8), plus de buffer short
+ *  28x28 ni de division par 255 par pixel.
+ **************************************/
+void lenet_cnn_fixed_u8(
+        unsigned char input [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short  u8_k    [CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        int    u8_b    [CONV1_NBOUTPUT],
+        short  conv2_k [CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short  conv2_b [CONV2_NBOUTPUT],
+        short  fc1_k   [FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short  fc1_b   [FC1_NBOUTPUT],
+        short  fc2_k   [FC2_NBOUTPUT][FC1_NBOUTPUT],
+        short  fc2_b   [FC2_NBOUTPUT],
+        short  out     [FC2_NBOUTPUT])
+{
+    short conv1_out[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH];
+    short pool1_out[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH];
+    short conv2_out[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH];
+    short pool2_out[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH];
+    short fc1_out[FC1_NBOUTPUT];
+
+    Conv1_28x28x1_5x5x20_1_0_fixed_u8(input, u8_k, u8_b, conv1_out);
+    Pool1_24x24x20_2x2x20_2_0_fixed(conv1_out, pool1_out);
+    Conv2_12x12x20_5x5x40_1_0_fixed(pool1_out, conv2_k, conv2_b, conv2_out);
+    Pool2_8x8x40_2x2x40_2_0_fixed(conv2_out, pool2_out);
+    Fc1_40_400_fixed(pool2_out, fc1_k, fc1_b, fc1_out);
+    Fc2_400_10_fixed(fc1_out, fc2_k, fc2_b, out);
+}
+
+
+/**************************************
+ *  TOP LEVEL + CLASSIFICATION ENTIERE
+ *  Softmax par LUT et argmax dans l'accélérateur : ni FPU, ni retour
+ *  au PS pour finir le softmax. Renvoie la classe prédite.
+ **************************************/
+int lenet_cnn_fixed_class(
+        short  input   [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short  conv1_k [CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        short  conv1_b [CONV1_NBOUTPUT],
+        short  conv2_k [CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short  conv2_b [CONV2_NBOUTPUT],
+        short  fc1_k   [FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short  fc1_b   [FC1_NBOUTPUT],
+        short  fc2_k   [FC2_NBOUTPUT][FC1_NBOUTPUT],
+        short  fc2_b   [FC2_NBOUTPUT],
+        short  proba   [FC2_NBOUTPUT])
+{
+    short logits[FC2_NBOUTPUT];
+
+    lenet_cnn_fixed(input, conv1_k, conv1_b, conv2_k, conv2_b,
+                    fc1_k, fc1_b, fc2_k, fc2_b, logits);
+
+    Softmax_fixed_lut(logits, proba);
+
+    return Argmax_fixed(logits, 0);
+}
+
+/**************************************
+ *  TOP LEVEL FUSIONNE
+ *  Conv+ReLU+Pool en une passe : conv1_out (24x24x20) et conv2_out
+ *  (8x8x40) disparaissent, trafic d'activations / 4 et moins de BRAM.
+ **************************************/
+void lenet_cnn_fixed_fused(
+        short  input   [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short  conv1_k [CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        short  conv1_b [CONV1_NBOUTPUT],
+        short  conv2_k [CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short  conv2_b [CONV2_NBOUTPUT],
+        short  fc1_k   [FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short  fc1_b   [FC1_NBOUTPUT],
+        short  fc2_k   [FC2_NBOUTPUT][FC1_NBOUTPUT],
+        short  fc2_b   [FC2_NBOUTPUT],
+        short  out     [FC2_NBOUTPUT])
+{
+    short pool1_out[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH];
+    short pool2_out[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH];
+    short fc1_out[FC1_NBOUTPUT];
+
+    Conv1Pool1_28x28x1_5x5x20_2x2_fixed(input, conv1_k, conv1_b, pool1_out);
+    Conv2Pool2_12x12x20_5x5x40_2x2_fixed(pool1_out, conv2_k, conv2_b, pool2_out);
+    Fc1_40_400_fixed(pool2_out, fc1_k, fc1_b, fc1_out);
+    Fc2_400_10_fixed(fc1_out, fc2_k, fc2_b, out);
+}
+
+
+/**************************************
+ *  TOP LEVEL BATCH (CPU)
+ *  Conv/Pool image par image, puis FC1/FC2 en GEMM sur le batch :
+ *  FC1_KERNEL (~512 Ko) n'est relu qu'une fois par bloc de
+ *  LENET_BATCH_MAX images au lieu d'une fois par image.
+ *  Bit-exact avec lenet_cnn_fixed().
  **************************************/
 #ifndef __SYNTHESIS__
-int main() 
+void lenet_cnn_fixed_batch(
+        int    n,
+        short  inputs  [][IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short  conv1_k [CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        short  conv1_b [CONV1_NBOUTPUT],
+        short  conv2_k [CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short  conv2_b [CONV2_NBOUTPUT],
+        short  fc1_k   [FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short  fc1_b   [FC1_NBOUTPUT],
+        short  fc2_k   [FC2_NBOUTPUT][FC1_NBOUTPUT],
+        short  fc2_b   [FC2_NBOUTPUT],
+        short  outputs [][FC2_NBOUTPUT])
 {
+    short conv1_out[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH];
+    short pool1_out[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH];
+    short conv2_out[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH];
+    short pool2_out[LENET_BATCH_MAX][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH];
+    short fc1_out[LENET_BATCH_MAX][FC1_NBOUTPUT];
+
+    int base, b, nb;
+
+    for (base = 0; base < n; base += LENET_BATCH_MAX) {
+
+        nb = n - base;
+        if (nb > LENET_BATCH_MAX) nb = LENET_BATCH_MAX;
+
+        for (b = 0; b < nb; b++) {
+            Conv1_28x28x1_5x5x20_1_0_fixed(inputs[base + b], conv1_k, conv1_b, conv1_out);
+            Pool1_24x24x20_2x2x20_2_0_fixed(conv1_out, pool1_out);
+            Conv2_12x12x20_5x5x40_1_0_fixed(pool1_out, conv2_k, conv2_b, conv2_out);
+            Pool2_8x8x40_2x2x40_2_0_fixed(conv2_out, pool2_out[b]);
+        }
+
+        Fc1_40_400_fixed_batch(nb, pool2_out, fc1_k, fc1_b, fc1_out);
+        Fc2_400_10_fixed_batch(nb, fc1_out, fc2_k, fc2_b, &outputs[base]);
+    }
+}
+#endif
+
+
+/**************************************
+ *  POIDS INTEGRES (Weights.h)
+ **************************************/
+#ifndef __SYNTHESIS__
+void lenet_weights_builtin(lenet_weights_t *w)
+{
+    lenet_weights_init(w);
+#ifndef LENET_NO_BUILTIN_WEIGHTS
+    w->conv1_k = CONV1_KERNEL;  w->conv1_b = CONV1_BIAS;
+    w->conv2_k = CONV2_KERNEL;  w->conv2_b = CONV2_BIAS;
+    w->fc1_k   = FC1_KERNEL;    w->fc1_b   = FC1_BIAS;
+    w->fc2_k   = FC2_KERNEL;    w->fc2_b   = FC2_BIAS;
+#endif
+}
+#endif
+
+
+/**************************************
+ *  PROGRAMME PRINCIPAL
+ *  -DLENET_NO_MAIN : ce fichier est lié dans un autre exécutable
+ *  (bench_e2e.c) pour les top-levels et les poids intégrés.
+ **************************************/
+#if !defined(__SYNTHESIS__) && !defined(LENET_NO_MAIN)
+int main(int argc, char **argv)
+{
+    int nthreads = 1;
+    int use_pgm  = 0;
+    int nloaders = 0;       // > 0 : pipeline chargement / calcul
+    char *weights_file = NULL;
+    char *codebook_file = NULL; // modèle par dictionnaire (codebook_tool)
+    int packed = 0;         // réempaquetage des poids au chargement
+    int int_output = 0;     // argmax sur les logits, softmax LUT
+    int int8 = 0;           // moteur int8 calibré sur calib_n images
+    int calib_n = 500;
+    char *trace_file = NULL;    // -DLENET_TRACE : trace JSON par couche
+    int perf = 0;               // compteurs matériels par couche
+    int sparse = 0;             // noyaux sur activations non nulles
+    char *csr_file = NULL;      // FC1 élagué (prune_tool)
+    char *lowrank_file = NULL;  // FC1 factorisé (lowrank_tool)
+    int u8_input = 0;           // normalisation repliée dans Conv1
+    int accel = 0;              // protocole LOAD / INFER émulé (accel_fixed.c)
+    int fc1_tiled = 0;          // FC1 par tuiles ping-pong (tiled_fixed.c)
+    lenet_conv_backend_t conv = LENET_CONV_SIMD;
+
+    for (int a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "--threads") && a + 1 < argc) {
+            nthreads = atoi(argv[++a]);
+        } else if (!strcmp(argv[a], "--loaders") && a + 1 < argc) {
+            nloaders = atoi(argv[++a]);
+        } else if (!strcmp(argv[a], "--weights") && a + 1 < argc) {
+            weights_file = argv[++a];
+        } else if (!strcmp(argv[a], "--codebook") && a + 1 < argc) {
+            codebook_file = argv[++a];
+        } else if (!strcmp(argv[a], "--int-output")) {
+            int_output = 1;
+        } else if (!strcmp(argv[a], "--int8")) {
+            int8 = 1;
+        } else if (!strcmp(argv[a], "--calib") && a + 1 < argc) {
+            calib_n = atoi(argv[++a]);
+        } else if (!strcmp(argv[a], "--trace") && a + 1 < argc) {
+            trace_file = argv[++a];
+        } else if (!strcmp(argv[a], "--fc1-csr") && a + 1 < argc) {
+            csr_file = argv[++a];
+        } else if (!strcmp(argv[a], "--fc1-lowrank") && a + 1 < argc) {
+            lowrank_file = argv[++a];
+        } else if (!strcmp(argv[a], "--fc1-tiled")) {
+            fc1_tiled = 1;
+        } else if (!strcmp(argv[a], "--accel")) {
+            accel = 1;
+        } else if (!strcmp(argv[a], "--u8-input")) {
+            u8_input = 1;
+        } else if (!strcmp(argv[a], "--sparse")) {
+            sparse = 1;
+        } else if (!strcmp(argv[a], "--perf")) {
+            perf = 1;
+        } else if (!strcmp(argv[a], "--packed")) {
+            packed = 1;
+        } else if (!strcmp(argv[a], "--pgm")) {
+            use_pgm = 1;
+        } else if (!strcmp(argv[a], "--conv") && a + 1 < argc) {
+            a++;
+            if      (!strcmp(argv[a], "scalar")) conv = LENET_CONV_SCALAR;
+            else if (!strcmp(argv[a], "simd"))   conv = LENET_CONV_SIMD;
+            else if (!strcmp(argv[a], "gemm"))   conv = LENET_CONV_GEMM;
+            else if (!strcmp(argv[a], "fused"))  conv = LENET_CONV_FUSED;
+            else if (!strcmp(argv[a], "packed")) conv = LENET_CONV_PACKED;
+            else {
+                printf("ERROR: unknown conv backend %s\n", argv[a]);
+                return -1;
+            }
+        } else {
+            printf("usage: %s [--threads N] [--conv scalar|simd|gemm|fused|packed] [--pgm] [--loaders L] [--weights file.bin | --codebook model_cb.bin] [--packed] [--int-output] [--int8 [--calib N]] [--trace out.json] [--perf] [--sparse] [--fc1-csr fc1_csr.bin] [--fc1-lowrank fc1_lowrank.bin] [--u8-input] [--accel] [--fc1-tiled]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (weights_file && codebook_file) {
+        printf("ERROR: --weights and --codebook are exclusive\n");
+        return -1;
+    }
+    // un seul format de FC1 à la fois : le dispatch n'en exécuterait qu'un
+    if ((csr_file != NULL) + (lowrank_file != NULL) + (codebook_file != NULL) > 1) {
+        printf("ERROR: --fc1-csr, --fc1-lowrank and --codebook are exclusive\n");
+        return -1;
+    }
+    // le moteur int8 a ses propres noyaux : ces options ne s'y appliquent pas
+    if (int8 && (csr_file || lowrank_file || codebook_file || sparse || packed ||
+                 conv == LENET_CONV_PACKED || u8_input || fc1_tiled)) {
+        printf("ERROR: --int8 cannot be combined with --fc1-csr, --fc1-lowrank, --codebook, --sparse, --packed, --conv packed, --u8-input or --fc1-tiled\n");
+        return -1;
+    }
+    // --sparse : Conv2 / FC1 / FC2 creux, incompatibles avec la fusion conv + pool
+    // et avec un autre format de FC1
+    if (sparse && (conv == LENET_CONV_FUSED || csr_file || lowrank_file || codebook_file)) {
+        printf("ERROR: --sparse cannot be combined with --conv fused, --fc1-csr, --fc1-lowrank or --codebook\n");
+        return -1;
+    }
+    // --accel lit le FC1 dense en DDR, que le chargeur du dictionnaire ne décode pas
+    if (accel && codebook_file) {
+        printf("ERROR: --accel cannot be combined with --codebook\n");
+        return -1;
+    }
+    // --fc1-tiled remplace le FC1 dense ou réempaqueté, pas un autre format de FC1
+    if (fc1_tiled && (csr_file || lowrank_file || codebook_file || sparse)) {
+        printf("ERROR: --fc1-tiled cannot be combined with --fc1-csr, --fc1-lowrank, --codebook or --sparse\n");
+        return -1;
+    }
+
+#ifdef LENET_TRACE
+    if (trace_file)
+        lenet_trace_start();
+#else
+    if (trace_file) {
+        printf("ERROR: --trace needs a build with -DLENET_TRACE\n");
+        return -1;
+    }
+#endif
+
     /*char *hdf5_file = "lenet_weights.hdf5";
 
     // noms des datasets dans le .hdf5
@@ -118,16 +405,35 @@ int main()
     char *fc2_b   = "dense_2/dense_2/bias:0";
 */
     char *label_file_name = "mnist/t10k-labels-idx1-ubyte";
+    char *image_file_name = "mnist/t10k-images-idx3-ubyte";
 
-    FILE *label_file = fopen(label_file_name, "r");
-    if (!label_file) {
+    // étiquettes et images : fichiers IDX mappés (zéro copie)
+    lenet_idx_t label_idx, image_idx;
+
+    if (lenet_idx_open(&label_idx, label_file_name) != 0) {
         printf("ERROR: Could not open labels file\n");
         return -1;
     }
 
-    // discard header (8 bytes)
-    unsigned char tmp;
-    for (int i = 0; i < 8; i++) fscanf(label_file, "%c", &tmp);
+    const unsigned char *labels = label_idx.data;
+    int nb_labels = label_idx.n;
+
+    lenet_load_fn load     = lenet_load_pgm;     // --pgm : un fichier par image
+    void         *load_arg = image_file_name;
+
+    if (!use_pgm) {
+        if (lenet_idx_open(&image_idx, image_file_name) != 0)
+            return -1;
+        if (image_idx.rows != IMG_HEIGHT || image_idx.cols != IMG_WIDTH) {
+            printf("ERROR: %s : images %dx%d, expected %dx%d\n", image_file_name,
+                   image_idx.rows, image_idx.cols, IMG_HEIGHT, IMG_WIDTH);
+            return -1;
+        }
+        if (image_idx.n < nb_labels)
+            nb_labels = image_idx.n;
+        load     = lenet_load_idx;
+        load_arg = &image_idx;
+    }
 
 
     /********************************************
@@ -172,72 +478,196 @@ int main()
     /********************************************
      * 3. BOUCLE DE TEST SUR MNIST
      ********************************************/
-    unsigned int error = 0;
-    unsigned int n = 0;
+    lenet_weights_t weights;
+    lenet_weights_blob_t blob;
+    lenet_cb_t cb;
+    lenet_eval_result_t res;
+
+    if (weights_file) {
+        if (lenet_weights_map(weights_file, &blob, &weights) != 0)
+            return -1;
+    } else if (codebook_file) {
+        if (lenet_cb_map(codebook_file, &cb, &weights) != 0)
+            return -1;
+    } else {
+        lenet_weights_builtin(&weights);
+        if (!weights.fc1_k) {
+            printf("ERROR: built without Weights.h, use --weights\n");
+            return -1;
+        }
+    }
 
-   while(1) {
+    // --packed : FC1 (et conv si --conv packed) sur poids réempaquetés
+    lenet_packed_t packed_w;
 
-        unsigned char label_raw;
-        if (fscanf(label_file, "%c", &label_raw) == EOF) break;
+    if (packed || conv == LENET_CONV_PACKED) {
+        lenet_weights_pack(&weights, &packed_w);
+        weights.packed = &packed_w;
+    }
 
-        int label = label_raw;
+    // --fc1-csr : FC1 élagué au format CSR (remplace fc1_k)
+    lenet_csr_t fc1_csr;
 
-        // Construire nom du fichier
-        char img_file[128];
-        sprintf(img_file, "mnist/t10k-images-idx3-ubyte[%05d].pgm", n);
+    if (csr_file) {
+        if (lenet_csr_map(csr_file, FC1_NBOUTPUT, FC1_NBINPUT, &fc1_csr) != 0)
+            return -1;
+        weights.fc1_csr = &fc1_csr;
+    }
 
-        // Lire image
-        unsigned char img_px[IMG_WIDTH * IMG_HEIGHT];
-        ReadPgmFile(img_file, img_px);
+    // --fc1-lowrank : FC1 factorisé L · R (remplace fc1_k)
+    lenet_lowrank_t fc1_lowrank;
 
-        // Normalisation -> fixed-point
-        NormalizeImg_fixed(img_px, (short*)INPUT_FP, IMG_WIDTH, IMG_HEIGHT);
-    
+    if (lowrank_file) {
+        if (lenet_lowrank_map(lowrank_file, FC1_NBOUTPUT, FC1_NBINPUT, &fc1_lowrank) != 0)
+            return -1;
+        weights.fc1_lowrank = &fc1_lowrank;
+    }
 
-        // Exécution du CNN
-        lenet_cnn_fixed(INPUT_FP,
-                        CONV1_KERNEL, CONV1_BIAS,
-                        CONV2_KERNEL, CONV2_BIAS,
-                        FC1_KERNEL,  FC1_BIAS,
-                        FC2_KERNEL,  FC2_BIAS,
-                        FC2_OUTPUT_FP);
+    // --u8-input : Conv1 directement sur les pixels uint8 (pas de NormalizeImg_fixed)
+    lenet_conv1_u8_t conv1_u8;
 
+    if (u8_input) {
+        if (lenet_conv1_fold_u8(&weights, &conv1_u8) != 0) {
+            printf("ERROR: Conv1 weights too large to fold the input normalization\n");
+            return -1;
+        }
+        weights.conv1_u8 = &conv1_u8;
+    }
 
-        // Softmax
-        Softmax_fixed(FC2_OUTPUT_FP, SOFTMAX_OUTPUT);
+    lenet_ctx_t proto;
 
-        // Trouver prediction
-        float max = SOFTMAX_OUTPUT[0];
-        int pred = 0;
+    lenet_ctx_init(&proto, &weights);
+    lenet_ctx_set_conv(&proto, conv);
+    proto.int_output = int_output;
+    proto.sparse = sparse;
+    proto.fc1_tiled = fc1_tiled;
 
-        for (int k = 1; k < FC2_NBOUTPUT; k++) {
-            if (SOFTMAX_OUTPUT[k] > max) {
-                max = SOFTMAX_OUTPUT[k];
-                pred = k;
-            }
+    // --fc1-tiled : vérification bit-exacte + octets / recouvrement par taille de tuile
+    if (fc1_tiled && lenet_fc1_tiled_report(&weights) != 0)
+        return -1;
+
+    // --perf : passe mono-thread avec compteurs autour de chaque couche Q8
+    if (perf && lenet_perf_profile(&proto, load, load_arg, nb_labels) != 0)
+        return -1;
+
+    // --int8 : calibration sur les calib_n premières images, puis
+    // comparaison avec la référence Q8 sur tout le jeu de test
+    lenet_int8_model_t *int8_model = NULL;
+    lenet_int8_calib_t  calib;
+    lenet_eval_result_t res_q8;
+
+    if (int8) {
+        unsigned char buf[IMG_WIDTH * IMG_HEIGHT];
+        short in_fp[IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH];
+
+        int8_model = malloc(sizeof(*int8_model));
+        if (!int8_model) {
+            printf("ERROR: out of memory\n");
+            return -1;
+        }
+
+        lenet_int8_calib_init(&calib);
+        for (int i = 0; i < calib_n && i < nb_labels; i++) {
+            NormalizeImg_fixed(load(load_arg, i, buf), (short*)in_fp, IMG_WIDTH, IMG_HEIGHT);
+            lenet_int8_calib_observe(&calib, &weights, in_fp);
         }
-        if (n == 0) {
-                printf("\nSoftmax output:\n");
-                for (int k = 0; k < FC2_NBOUTPUT; k++) {
-                    printf("%.2f%% ", SOFTMAX_OUTPUT[k] * 100.0f);
-                }
-                printf("\n");
-
-                printf("Predicted: %d    Actual: %d\n", pred, label);
+        lenet_int8_quantize(&weights, &calib, int8_model);
+
+        lenet_eval(&proto, load, load_arg, labels, nb_labels, nthreads, &res_q8);
+        proto.int8 = int8_model;
+    }
+
+    if (nloaders > 0) {
+        lenet_pipe_stats_t st;
+
+        lenet_eval_pipelined(&proto, load, load_arg,
+                             labels, nb_labels, nloaders, nthreads, &res, &st);
+
+        printf("\nPipeline: %d loader(s), %d compute thread(s), %d slots\n",
+               nloaders, nthreads, LENET_PIPE_SLOTS);
+        printf("  queue depth  : avg %.1f  max %u\n",
+               st.pushes ? (double)st.depth_sum / st.pushes : 0.0, st.depth_max);
+        printf("  stalls       : loaders %llu (full)  compute %llu (empty)\n",
+               st.full_stalls, st.empty_stalls);
+        printf("  busy time    : load %.3f s  compute %.3f s\n",
+               st.load_s, st.compute_s);
+    } else {
+        lenet_eval(&proto,
+                   load, load_arg,
+                   labels, nb_labels, nthreads, &res);
+    }
+
+    unsigned int error = res.errors;
+    unsigned int n = res.n;
+
+    if (n > 0) {
+        printf("\nSoftmax output:\n");
+        if (int_output) {
+            short q[FC2_NBOUTPUT];
+            Softmax_fixed_lut(res.first_logits, q);
+            for (int k = 0; k < FC2_NBOUTPUT; k++) {
+                printf("%.2f%% ", q[k] * 100.0f / (1 << SOFTMAX_Q));
+            }
+        } else {
+            for (int k = 0; k < FC2_NBOUTPUT; k++) {
+                printf("%.2f%% ", res.first_proba[k] * 100.0f);
             }
+        }
+        printf("\n");
+
+        printf("Predicted: %d    Actual: %d\n", res.first_pred, labels[0]);
+    }
+
+    // --sparse : densité mesurée sur tout le jeu de test
+    if (sparse) {
+        lenet_sparsity_t sp;
+        lenet_sparsity_profile(&weights, load, load_arg, nb_labels, &sp);
+        lenet_sparsity_report(&sp);
+    }
 
-            if (pred != label)
-                error++;
+    // --accel : poids chargés une fois dans l'accélérateur, puis INFER par image
+    if (accel) {
+        lenet_accel_stats_t ast;
+        unsigned int aerr = lenet_accel_eval(&weights, load, load_arg, labels, nb_labels, &ast);
 
-            n++;
+        lenet_accel_report(&ast);
+        printf("  accuracy : %.2f%% (%u errors, Q8 reference lenet_cnn_fixed %u, logits differ on %u image(s))\n",
+               100.0f * (1.0f - (float)aerr / nb_labels), aerr, ast.ref_errors, ast.mismatches);
     }
 
-    fclose(label_file);
+    if (!use_pgm)
+        lenet_idx_close(&image_idx);
+
+    if (int8) {
+        lenet_int8_report(int8_model, &calib);
+        printf("  accuracy            : Q8/int16 %.2f%%  int8 %.2f%%  (delta %+.2f)\n",
+               100.0f * (1.0f - (float)res_q8.errors / res_q8.n),
+               100.0f * (1.0f - (float)res.errors / res.n),
+               100.0f * ((float)res_q8.errors - (float)res.errors) / res.n);
+        free(int8_model);
+    }
+
+#ifdef LENET_TRACE
+    if (trace_file)
+        lenet_trace_dump(trace_file);
+#endif
 
     printf("\nTEST FINISHED\n");
     printf("Errors: %d / %d\n", error, n);
     printf("Success rate: %.2f%%\n", 100.0f * (1.0f - (float)error/n));
 
+    lenet_idx_close(&label_idx);
+    if (weights.packed)
+        lenet_packed_free(&packed_w);
+    if (weights.fc1_csr)
+        lenet_csr_free(&fc1_csr);
+    if (weights.fc1_lowrank)
+        lenet_lowrank_free(&fc1_lowrank);
+    if (weights_file)
+        lenet_weights_unmap(&blob);
+    if (codebook_file)
+        lenet_cb_unmap(&cb);
+
     return 0;
 }
 #endif
@@ -34,7 +34,9 @@
 
 /* ---------- CONV1 ---------- */
 #define CONV1_DIM       5
-#define CONV1_NBOUTPUT  20
+#ifndef CONV1_NBOUTPUT
+#define CONV1_NBOUTPUT  20      // paramètre du modèle (élagage par canaux : -DCONV1_NBOUTPUT=n)
+#endif
 #define CONV1_STRIDE    1
 #define CONV1_PAD       0
 #define CONV1_WIDTH     ( ((IMG_WIDTH  - CONV1_DIM + 2*CONV1_PAD)  / CONV1_STRIDE) + 1 )
@@ -50,7 +52,9 @@
 
 /* ---------- CONV2 ---------- */
 #define CONV2_DIM       5
-#define CONV2_NBOUTPUT  40
+#ifndef CONV2_NBOUTPUT
+#define CONV2_NBOUTPUT  40      // idem (-DCONV2_NBOUTPUT=n)
+#endif
 #define CONV2_STRIDE    1
 #define CONV2_PAD       0
 #define CONV2_WIDTH     ( ((POOL1_WIDTH  - CONV2_DIM + 2*CONV2_PAD) / CONV2_STRIDE) + 1 )
@@ -65,9 +69,39 @@
 #define POOL2_HEIGHT    ( ((CONV2_HEIGHT - POOL2_DIM + 2*POOL2_PAD) / POOL2_STRIDE) + 1 )
 
 /* ---------- FC layers ---------- */
+#define FC1_NBINPUT     ( POOL2_NBOUTPUT * POOL2_HEIGHT * POOL2_WIDTH )
 #define FC1_NBOUTPUT    400
 #define FC2_NBOUTPUT    10
 
+/* ---------- Poids intégrés ----------
+   Fichier inclus par les .c qui embarquent les poids. Un modèle élagué par
+   channel_prune_tool se compile avec ses dimensions :
+     -DCONV1_NBOUTPUT=12 -DCONV2_NBOUTPUT=24 -DLENET_WEIGHTS_FILE='"Weights_pruned.h"'
+*/
+#ifndef LENET_WEIGHTS_FILE
+#define LENET_WEIGHTS_FILE "Weights.h"
+#endif
+
+/* ---------- #pragma HLS dans une macro ----------
+   Arguments développés (profondeurs, facteurs) ; rien hors synthèse,
+   donc pas d'avertissement -Wunknown-pragmas sous gcc. */
+#ifdef __SYNTHESIS__
+#define LENET_PRAGMA(x)     LENET_PRAGMA_(x)
+#define LENET_PRAGMA_(x)    _Pragma(#x)
+#else
+#define LENET_PRAGMA(x)
+#endif
+
+/* ---------- MACs par image (profilage, benchmarks) ---------- */
+#define CONV1_MACS  ( CONV1_NBOUTPUT * CONV1_HEIGHT * CONV1_WIDTH * IMG_DEPTH * CONV1_DIM * CONV1_DIM )
+#define CONV2_MACS  ( CONV2_NBOUTPUT * CONV2_HEIGHT * CONV2_WIDTH * POOL1_NBOUTPUT * CONV2_DIM * CONV2_DIM )
+#define FC1_MACS    ( FC1_NBOUTPUT * FC1_NBINPUT )
+#define FC2_MACS    ( FC2_NBOUTPUT * FC1_NBOUTPUT )
+
+
+/* ---------- Batch ---------- */
+#define LENET_BATCH_MAX 32   // images traitées ensemble par lenet_cnn_fixed_batch
+
 
 /**************************************
  *  PROTOTYPES DES FONCTIONS FIXED POINT
@@ -87,6 +121,80 @@ void Conv2_12x12x20_5x5x40_1_0_fixed(
         short output[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH]);
 
 
+/* ---------- Conv + ReLU + MaxPool fusionnés (conv_fixed.c) ---------- */
+void Conv1Pool1_28x28x1_5x5x20_2x2_fixed(
+        short input [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short kernel[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        short bias  [CONV1_NBOUTPUT],
+        short output[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH]);
+
+void Conv2Pool2_12x12x20_5x5x40_2x2_fixed(
+        short input [POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH],
+        short kernel[CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short bias  [CONV2_NBOUTPUT],
+        short output[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH]);
+
+
+/* ---------- Conv1 sur pixels uint8 (conv_fixed.c) ----------
+   La normalisation pixel * 2^Q / 255 est repliée dans le noyau :
+       kernel = round(w * 2^(Q + CONV1_U8_SHIFT) / 255)
+       bias   = b << (Q + CONV1_U8_SHIFT)
+   Ni passe NormalizeImg_fixed ni buffer short : l'entrée reste en octets. */
+#define CONV1_U8_SHIFT  7       // noyau replié sur 16 bits tant que |w| <= 254 (Q8)
+
+void Conv1_28x28x1_5x5x20_1_0_fixed_u8(
+        unsigned char input [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short         kernel[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        int           bias  [CONV1_NBOUTPUT],
+        short         output[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH]);
+
+
+/* ---------- Convolution layers, SIMD (conv_simd.c, CPU) ---------- */
+#ifndef __SYNTHESIS__
+void Conv1_28x28x1_5x5x20_1_0_fixed_simd(
+        short input [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short kernel[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        short bias  [CONV1_NBOUTPUT],
+        short output[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH]);
+
+void Conv2_12x12x20_5x5x40_1_0_fixed_simd(
+        short input [POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH],
+        short kernel[CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short bias  [CONV2_NBOUTPUT],
+        short output[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH]);
+
+void Conv1_28x28x1_5x5x20_1_0_fixed_u8_simd(
+        unsigned char input [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short         kernel[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        int           bias  [CONV1_NBOUTPUT],
+        short         output[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH]);
+
+const char *lenet_simd_isa(void);     // "avx2", "sse2", "neon" ou "scalar"
+#endif
+
+
+/* ---------- Convolution layers, im2col + GEMM (conv_gemm.c, CPU) ---------- */
+#ifndef __SYNTHESIS__
+/* C[M][N] += A[M][K] * B[K][N], int16 x int16 -> int32, bloqué cache */
+void Gemm_s16_fixed(int M, int N, int K,
+                    const short *A, int lda,
+                    const short *B, int ldb,
+                    int *C, int ldc);
+
+void Conv1_28x28x1_5x5x20_1_0_fixed_gemm(
+        short input [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short kernel[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        short bias  [CONV1_NBOUTPUT],
+        short output[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH]);
+
+void Conv2_12x12x20_5x5x40_1_0_fixed_gemm(
+        short input [POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH],
+        short kernel[CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short bias  [CONV2_NBOUTPUT],
+        short output[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH]);
+#endif
+
+
 /* ---------- Pooling layers ---------- */
 void Pool1_24x24x20_2x2x20_2_0_fixed(
         short input [CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH],
@@ -111,10 +219,858 @@ void Fc2_400_10_fixed(
         short output[FC2_NBOUTPUT]);
 
 
+/* ---------- FC1 par tuiles, poids en DDR (tiled_fixed.c) ----------
+   FC1_TILE sorties par tuile ; la tuile t+1 est lue en burst dans un
+   buffer local pendant le calcul de la tuile t (ping-pong). Seuls
+   2 x FC1_TILE x FC1_NBINPUT poids résident sur puce. */
+#ifndef FC1_TILE
+#define FC1_TILE        16
+#endif
+#if (FC1_NBOUTPUT % FC1_TILE)
+#error "FC1_TILE must divide FC1_NBOUTPUT"
+#endif
+#define FC1_NTILES      ( FC1_NBOUTPUT / FC1_TILE )
+#define FC1_TILE_MACS   4       // MACs par cycle (déroulage du calcul d'une tuile)
+
+/* modèle de transfert de lenet_fc1_tiled_report() */
+#define FC1_AXI_BYTES   2       // octets par cycle : fc1_tile_load lit un short par itération (II=1)
+#define FC1_AXI_LATENCY 40      // cycles avant la première donnée d'un burst
+
+void Fc1_40_400_fixed_tiled(
+        short input [POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short kernel[FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short bias  [FC1_NBOUTPUT],
+        short output[FC1_NBOUTPUT]);
+
+/* ---------- Fully Connected layers, batch version (GEMM) ---------- */
+void Fc1_40_400_fixed_batch(
+        unsigned short n,
+        short input [][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short kernel[FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short bias  [FC1_NBOUTPUT],
+        short output[][FC1_NBOUTPUT]);
+
+void Fc2_400_10_fixed_batch(
+        unsigned short n,
+        short input [][FC1_NBOUTPUT],
+        short kernel[FC2_NBOUTPUT][FC1_NBOUTPUT],
+        short bias  [FC2_NBOUTPUT],
+        short output[][FC2_NBOUTPUT]);
+
+
+/* ---------- Top level ---------- */
+void lenet_cnn_fixed(
+        short  input   [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short  conv1_k [CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        short  conv1_b [CONV1_NBOUTPUT],
+        short  conv2_k [CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short  conv2_b [CONV2_NBOUTPUT],
+        short  fc1_k   [FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short  fc1_b   [FC1_NBOUTPUT],
+        short  fc2_k   [FC2_NBOUTPUT][FC1_NBOUTPUT],
+        short  fc2_b   [FC2_NBOUTPUT],
+        short  out     [FC2_NBOUTPUT]);
+
+/* Top level sur pixels bruts : Conv1 replié (u8_k / u8_b, cf. CONV1_U8_SHIFT) */
+void lenet_cnn_fixed_u8(
+        unsigned char input [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short  u8_k    [CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        int    u8_b    [CONV1_NBOUTPUT],
+        short  conv2_k [CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short  conv2_b [CONV2_NBOUTPUT],
+        short  fc1_k   [FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short  fc1_b   [FC1_NBOUTPUT],
+        short  fc2_k   [FC2_NBOUTPUT][FC1_NBOUTPUT],
+        short  fc2_b   [FC2_NBOUTPUT],
+        short  out     [FC2_NBOUTPUT]);
+
+/* Top level + softmax LUT + argmax : renvoie la classe, proba en Q15 */
+int lenet_cnn_fixed_class(
+        short  input   [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short  conv1_k [CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        short  conv1_b [CONV1_NBOUTPUT],
+        short  conv2_k [CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short  conv2_b [CONV2_NBOUTPUT],
+        short  fc1_k   [FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short  fc1_b   [FC1_NBOUTPUT],
+        short  fc2_k   [FC2_NBOUTPUT][FC1_NBOUTPUT],
+        short  fc2_b   [FC2_NBOUTPUT],
+        short  proba   [FC2_NBOUTPUT]);
+
+/* Variante fusionnée Conv+Pool : sans conv1_out / conv2_out */
+void lenet_cnn_fixed_fused(
+        short  input   [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short  conv1_k [CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        short  conv1_b [CONV1_NBOUTPUT],
+        short  conv2_k [CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short  conv2_b [CONV2_NBOUTPUT],
+        short  fc1_k   [FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short  fc1_b   [FC1_NBOUTPUT],
+        short  fc2_k   [FC2_NBOUTPUT][FC1_NBOUTPUT],
+        short  fc2_b   [FC2_NBOUTPUT],
+        short  out     [FC2_NBOUTPUT]);
+
+/* Couches reliées par des FIFOs, région DATAFLOW (stream_fixed.c, lenet_stream.h) */
+void lenet_cnn_fixed_stream(
+        short  input   [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short  conv1_k [CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        short  conv1_b [CONV1_NBOUTPUT],
+        short  conv2_k [CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short  conv2_b [CONV2_NBOUTPUT],
+        short  fc1_k   [FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short  fc1_b   [FC1_NBOUTPUT],
+        short  fc2_k   [FC2_NBOUTPUT][FC1_NBOUTPUT],
+        short  fc2_b   [FC2_NBOUTPUT],
+        short  out     [FC2_NBOUTPUT]);
+
+/* n images d'un coup : FC1/FC2 deviennent des produits matrice-matrice */
+void lenet_cnn_fixed_batch(
+        int    n,
+        short  inputs  [][IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short  conv1_k [CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        short  conv1_b [CONV1_NBOUTPUT],
+        short  conv2_k [CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short  conv2_b [CONV2_NBOUTPUT],
+        short  fc1_k   [FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short  fc1_b   [FC1_NBOUTPUT],
+        short  fc2_k   [FC2_NBOUTPUT][FC1_NBOUTPUT],
+        short  fc2_b   [FC2_NBOUTPUT],
+        short  outputs [][FC2_NBOUTPUT]);
+
+
+/* ---------- Accélérateur à poids résidents (accel_fixed.c) ----------
+   Une seule fonction top, deux commandes :
+     LENET_ACCEL_LOAD  : params[0..LENET_PARAM_WORDS) → mémoire locale (BRAM)
+     LENET_ACCEL_INFER : input → out avec les poids déjà chargés
+   Les petits poids ne traversent le bus qu'une fois ; FC1 (500 Ko) ne
+   tient pas en BRAM et reste en DDR, lu par tuiles à chaque INFER.
+   params est un tableau plat :
+   conv1_k, conv1_b, conv2_k, conv2_b, fc1_b, fc2_k, fc2_b. */
+#define LENET_ACCEL_LOAD    0
+#define LENET_ACCEL_INFER   1
+
+#define LENET_PW_CONV1_K    ( CONV1_NBOUTPUT * IMG_DEPTH * CONV1_DIM * CONV1_DIM )
+#define LENET_PW_CONV2_K    ( CONV2_NBOUTPUT * POOL1_NBOUTPUT * CONV2_DIM * CONV2_DIM )
+#define LENET_PW_FC1_K      ( FC1_NBOUTPUT * FC1_NBINPUT )
+#define LENET_PW_FC2_K      ( FC2_NBOUTPUT * FC1_NBOUTPUT )
+#define LENET_PARAM_WORDS   ( LENET_PW_CONV1_K + CONV1_NBOUTPUT + LENET_PW_CONV2_K + CONV2_NBOUTPUT + \
+                              FC1_NBOUTPUT + LENET_PW_FC2_K + FC2_NBOUTPUT )
+
+/* sdscc : params n'est copié que sur LOAD (nparams = 0 sur INFER),
+   fc1_k est lu en place par le m_axi de l'accélérateur. input et out
+   restent en accès aléatoire (copie en BRAM) : Conv1 relit des fenêtres
+   qui se recouvrent, et une commande LOAD ne consomme ni ne produit de
+   flux. Les deux commandes passent des buffers valides pour tous les
+   arguments (voir lenet_accel_emu_load / _infer). */
+#ifdef __SDSCC__
+#pragma SDS data copy(params[0:nparams])
+#pragma SDS data zero_copy(fc1_k)
+#pragma SDS data access_pattern(params:SEQUENTIAL)
+#endif
+void lenet_accel(
+        int    cmd,
+        short *params,
+        int    nparams,
+        short  fc1_k   [FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short  input   [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short  out     [FC2_NBOUTPUT]);
+
+
 /* ---------- Softmax fixed point ---------- */
 void Softmax_fixed(short vector_in[FC2_NBOUTPUT],
                    float vector_out[FC2_NBOUTPUT]);
 
+/* Sortie entière (sans FPU) : probabilités en Q15 */
+#define SOFTMAX_Q 15
+
+void Softmax_fixed_lut(short vector_in[FC2_NBOUTPUT],
+                       short vector_out[FC2_NBOUTPUT]);
+
+int  Argmax_fixed(short vector_in[FC2_NBOUTPUT], short *confidence);
+
+
+/* ---------- Utils (utils_fixed.c) ---------- */
+void NormalizeImg_fixed(const unsigned char *input, short *output, short width, short height);
+void ReadPgmFile(char *filename, unsigned char *pix);
+
+
+
+/**************************************
+ *  MOTEUR INT8 (conv_int8.c, pool_int8.c, fc_int8.c, quant_int8.c)
+ *
+ *  Poids int8 avec une échelle par canal de sortie, activations uint8
+ *  (sorties de ReLU >= 0) avec une échelle par couche, accumulateurs
+ *  int32. Echelles exprimées en unités Q8 par pas entier :
+ *      activation Q8 ~= a_u8 * s_a        poids Q8 ~= w_i8 * s_w[k]
+ *  Requantification entière : out = (acc * mult) >> shift (arrondi).
+ **************************************/
+
+typedef struct {
+    int mult;       // [2^30, 2^31)
+    int shift;      // décalage à droite total
+} lenet_q_mult_t;
+
+static inline int lenet_requant(int acc, lenet_q_mult_t m)
+{
+    return (int)(((long long)acc * m.mult + (1LL << (m.shift - 1))) >> m.shift);
+}
+
+static inline unsigned char lenet_requant_u8(int acc, lenet_q_mult_t m)
+{
+    int v = lenet_requant(acc, m);
+    return (unsigned char)((v < 0) ? 0 : (v > 255) ? 255 : v);    // ReLU + saturation
+}
+
+typedef struct {
+    /* échelles (unités Q8 par pas) : entrée, sorties conv1, conv2, fc1 */
+    float in_scale, conv1_scale, conv2_scale, fc1_scale;
+
+    signed char    conv1_k[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM];
+    int            conv1_b[CONV1_NBOUTPUT];     // dans le domaine de l'accumulateur
+    lenet_q_mult_t conv1_m[CONV1_NBOUTPUT];
+
+    signed char    conv2_k[CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM];
+    int            conv2_b[CONV2_NBOUTPUT];
+    lenet_q_mult_t conv2_m[CONV2_NBOUTPUT];
+
+    signed char    fc1_k[FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH];
+    int            fc1_b[FC1_NBOUTPUT];
+    lenet_q_mult_t fc1_m[FC1_NBOUTPUT];
+
+    signed char    fc2_k[FC2_NBOUTPUT][FC1_NBOUTPUT];
+    int            fc2_b[FC2_NBOUTPUT];
+    lenet_q_mult_t fc2_m[FC2_NBOUTPUT];        // sortie : logits Q8 (short)
+} lenet_int8_model_t;
+
+void Conv1_28x28x1_5x5x20_1_0_int8(
+        unsigned char  input [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        signed char    kernel[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        int            bias  [CONV1_NBOUTPUT],
+        lenet_q_mult_t mult  [CONV1_NBOUTPUT],
+        unsigned char  output[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH]);
+
+void Conv2_12x12x20_5x5x40_1_0_int8(
+        unsigned char  input [POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH],
+        signed char    kernel[CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        int            bias  [CONV2_NBOUTPUT],
+        lenet_q_mult_t mult  [CONV2_NBOUTPUT],
+        unsigned char  output[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH]);
+
+void Pool1_24x24x20_2x2x20_2_0_int8(
+        unsigned char input [CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH],
+        unsigned char output[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH]);
+
+void Pool2_8x8x40_2x2x40_2_0_int8(
+        unsigned char input [CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH],
+        unsigned char output[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH]);
+
+void Fc1_40_400_int8(
+        unsigned char  input [POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        signed char    kernel[FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        int            bias  [FC1_NBOUTPUT],
+        lenet_q_mult_t mult  [FC1_NBOUTPUT],
+        unsigned char  output[FC1_NBOUTPUT]);
+
+void Fc2_400_10_int8(
+        unsigned char  input [FC1_NBOUTPUT],
+        signed char    kernel[FC2_NBOUTPUT][FC1_NBOUTPUT],
+        int            bias  [FC2_NBOUTPUT],
+        lenet_q_mult_t mult  [FC2_NBOUTPUT],
+        short          output[FC2_NBOUTPUT]);
+
+/* Entrée Q8 normalisée -> logits Q8, tout en int8/int32 */
+void lenet_int8_forward(lenet_int8_model_t *m,
+                        short input [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+                        short logits[FC2_NBOUTPUT]);
+
+
+/**************************************
+ *  CONTEXTE D'INFERENCE (CPU, réentrant)
+ *  Un contexte possède tous les buffers d'une inférence : un contexte
+ *  par thread, les poids (lecture seule) sont partagés.
+ **************************************/
+#ifndef __SYNTHESIS__
+
+#include <stddef.h>
+#include <string.h>
+
+typedef struct {
+    short (*conv1_k)[IMG_DEPTH][CONV1_DIM][CONV1_DIM];
+    short  *conv1_b;
+    short (*conv2_k)[POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM];
+    short  *conv2_b;
+    short (*fc1_k)[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH];
+    short  *fc1_b;
+    short (*fc2_k)[FC1_NBOUTPUT];
+    short  *fc2_b;
+    const struct lenet_packed_s *packed;    // couches réempaquetées, ou NULL
+    const struct lenet_csr_s    *fc1_csr;   // FC1 élagué (CSR), ou NULL
+    const struct lenet_lowrank_s *fc1_lowrank;  // FC1 factorisé (rang r), ou NULL
+    const struct lenet_cb_s      *fc1_cb;       // FC1 par dictionnaire (index), ou NULL
+    const struct lenet_conv1_u8_s *conv1_u8;    // Conv1 replié (pixels uint8), ou NULL
+} lenet_weights_t;
+
+/* Tous les pointeurs à NULL : à appeler avant de remplir un lenet_weights_t,
+   les formats optionnels ajoutés plus tard restent ainsi absents par défaut */
+static inline void lenet_weights_init(lenet_weights_t *w)
+{
+    memset(w, 0, sizeof(*w));
+}
+
+/* Conv1 replié pour pixels uint8 (utils_fixed.c), calculé au chargement du modèle */
+typedef struct lenet_conv1_u8_s {
+    short k[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM];
+    int   b[CONV1_NBOUTPUT];
+} lenet_conv1_u8_t;
+
+int lenet_conv1_fold_u8(const lenet_weights_t *w, lenet_conv1_u8_t *f);  // -1 : poids hors plage
+
+/* Poids réempaquetés (packed_fixed.c) : blocs de KB sorties contigus,
+   bourrés de zéros, alignés sur 64 octets */
+#define LENET_CONV_KB       8
+#define LENET_FC1_KB        16
+#define LENET_CONV1_KBLOCKS ( (CONV1_NBOUTPUT + LENET_CONV_KB - 1) / LENET_CONV_KB )
+#define LENET_CONV2_KBLOCKS ( (CONV2_NBOUTPUT + LENET_CONV_KB - 1) / LENET_CONV_KB )
+#define LENET_FC1_KBLOCKS   ( (FC1_NBOUTPUT + LENET_FC1_KB - 1) / LENET_FC1_KB )
+
+typedef struct lenet_packed_s {
+    short *conv1_k;     // [CONV1_KBLOCKS][IMG_DEPTH][5][5][CONV_KB]
+    short *conv2_k;     // [CONV2_KBLOCKS][POOL1_NBOUTPUT][5][5][CONV_KB]
+    short *fc1_k;       // [FC1_KBLOCKS][FC1_NBINPUT][FC1_KB]
+} lenet_packed_t;
+
+/* Calibration / quantification int8 (quant_int8.c) */
+typedef struct {
+    short conv1_max, conv2_max, fc1_max;    // max des activations Q8 observées
+    int   nb_images;
+} lenet_int8_calib_t;
+
+void lenet_int8_calib_init   (lenet_int8_calib_t *c);
+void lenet_int8_calib_observe(lenet_int8_calib_t *c, const lenet_weights_t *w,
+                              short input[IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH]);
+void lenet_int8_quantize     (const lenet_weights_t *w, const lenet_int8_calib_t *c,
+                              lenet_int8_model_t *m);
+void lenet_int8_report       (const lenet_int8_model_t *m, const lenet_int8_calib_t *c);
+
+
+void lenet_weights_pack(const lenet_weights_t *w, lenet_packed_t *p);
+void lenet_packed_free (lenet_packed_t *p);
+
+void Conv1_28x28x1_5x5x20_1_0_fixed_packed(
+        short input [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        const lenet_packed_t *p,
+        short bias  [CONV1_NBOUTPUT],
+        short output[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH]);
+
+void Conv2_12x12x20_5x5x40_1_0_fixed_packed(
+        short input [POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH],
+        const lenet_packed_t *p,
+        short bias  [CONV2_NBOUTPUT],
+        short output[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH]);
+
+void Fc1_40_400_fixed_packed(
+        short input [POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        const lenet_packed_t *p,
+        short bias  [FC1_NBOUTPUT],
+        short output[FC1_NBOUTPUT]);
+
+
+typedef void (*lenet_conv1_fn)(
+        short input [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short kernel[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        short bias  [CONV1_NBOUTPUT],
+        short output[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH]);
+
+typedef void (*lenet_conv2_fn)(
+        short input [POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH],
+        short kernel[CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short bias  [CONV2_NBOUTPUT],
+        short output[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH]);
+
+/* Implémentation des convolutions utilisée par lenet_ctx_classify */
+typedef void (*lenet_conv1_pool_fn)(
+        short input [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short kernel[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        short bias  [CONV1_NBOUTPUT],
+        short output[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH]);
+
+typedef void (*lenet_conv2_pool_fn)(
+        short input [POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH],
+        short kernel[CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short bias  [CONV2_NBOUTPUT],
+        short output[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH]);
+
+typedef enum {
+    LENET_CONV_SCALAR = 0,      // conv_fixed.c (référence)
+    LENET_CONV_SIMD,            // conv_simd.c (dispatch CPU)
+    LENET_CONV_GEMM,            // conv_gemm.c (im2col + GEMM)
+    LENET_CONV_FUSED,           // Conv+ReLU+Pool fusionnés (conv_fixed.c)
+    LENET_CONV_PACKED,          // noyaux réempaquetés (packed_fixed.c)
+} lenet_conv_backend_t;
+
+typedef struct {
+    const lenet_weights_t *w;
+    lenet_conv_backend_t backend;
+    lenet_conv1_fn conv1;
+    lenet_conv2_fn conv2;
+    lenet_conv1_pool_fn conv1_pool;     // si non NULL : remplace conv1 + Pool1
+    lenet_conv2_pool_fn conv2_pool;     // si non NULL : remplace conv2 + Pool2
+    int   int_output;                   // 1 : argmax entier, pas de softmax float
+    lenet_int8_model_t *int8;           // si non NULL : moteur int8
+    int   sparse;                       // 1 : Conv2 / FC1 / FC2 sur non nuls
+    int   fc1_tiled;                    // 1 : FC1 dense par tuiles ping-pong
+    const unsigned char *pix;           // w->conv1_u8 : pixels bruts de l'image en cours
+    short input [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH];
+    short logits[FC2_NBOUTPUT];
+    float proba [FC2_NBOUTPUT];
+} lenet_ctx_t;
+
+/* Image idx (IMG_WIDTH*IMG_HEIGHT pixels) : renvoie buf une fois rempli,
+   ou directement une vue sur les pixels (zéro copie) */
+typedef const unsigned char *(*lenet_load_fn)(void *arg, int idx, unsigned char *buf);
+
+/* Fichier IDX MNIST mappé en mémoire (mnist_idx.c) */
+#define LENET_IDX1_MAGIC 0x00000801     // t10k-labels-idx1-ubyte
+#define LENET_IDX3_MAGIC 0x00000803     // t10k-images-idx3-ubyte
+
+typedef struct {
+    int    fd;
+    void  *map;
+    size_t size;
+    int    n;                           // nombre d'éléments
+    int    rows, cols;                  // 1 x 1 pour les étiquettes
+    const unsigned char *data;          // premier élément
+} lenet_idx_t;
+
+typedef struct {
+    unsigned int n;                     // images évaluées
+    unsigned int errors;
+    int   first_pred;                   // prédiction / sorties de l'image 0
+    short first_logits[FC2_NBOUTPUT];
+    float first_proba[FC2_NBOUTPUT];    // vide en mode int_output
+} lenet_eval_result_t;
+
+void lenet_weights_builtin(lenet_weights_t *w);     // poids de Weights.h
+
+
+/* ---------- Fichier de poids binaire (weights_blob.c) ---------- */
+#define LENET_WEIGHTS_MAGIC    "LENETWB"    // 8 octets avec le '\0'
+#define LENET_WEIGHTS_VERSION  1
+#define LENET_WEIGHTS_TENSORS  8
+#define LENET_WEIGHTS_ALIGN    64
+
+typedef struct {
+    char         magic[8];
+    unsigned int version;
+    unsigned int endian;                // 0x01020304 à l'écriture
+    unsigned int fixed_point;           // FIXED_POINT du modèle
+    unsigned int nb_tensors;
+    unsigned int file_size;
+    unsigned int reserved;
+    struct {
+        unsigned int dims[4];
+        unsigned int offset;            // octets depuis le début du fichier
+        unsigned int count;             // nombre de short
+    } tensor[LENET_WEIGHTS_TENSORS];
+} lenet_weights_header_t;
+
+typedef struct {
+    int    fd;
+    void  *map;
+    size_t size;
+} lenet_weights_blob_t;
+
+int  lenet_weights_save (const char *filename, const lenet_weights_t *w);
+int  lenet_weights_map  (const char *filename, lenet_weights_blob_t *blob,
+                         lenet_weights_t *w);
+void lenet_weights_unmap(lenet_weights_blob_t *blob);
+
+
+/* ---------- FC1 élagué, format CSR (csr_fixed.c, prune_tool.c) ---------- */
+#define LENET_CSR_MAGIC    "LENETCS"        // 8 octets avec le '\0'
+#define LENET_CSR_VERSION  1
+
+typedef struct {
+    char         magic[8];
+    unsigned int version;
+    unsigned int endian;                // 0x01020304 à l'écriture
+    unsigned int fixed_point;
+    unsigned int rows, cols, nnz;
+    unsigned int row_ptr_off;           // uint32 [rows + 1]
+    unsigned int col_off;               // uint16 [nnz]
+    unsigned int val_off;               // int16  [nnz]
+    unsigned int file_size;
+} lenet_csr_header_t;
+
+typedef struct lenet_csr_s {
+    int   rows, cols, nnz;
+    const unsigned int   *row_ptr;      // ligne r : [row_ptr[r], row_ptr[r+1])
+    const unsigned short *col;
+    const short          *val;
+    /* stockage : fichier mappé ou bloc alloué */
+    int    fd;
+    void  *map;
+    size_t size;
+    void  *mem;
+} lenet_csr_t;
+
+int  lenet_csr_from_dense(const short *dense, int rows, int cols, lenet_csr_t *c);
+int  lenet_csr_save      (const char *filename, const lenet_csr_t *c);
+int  lenet_csr_map       (const char *filename, int rows, int cols, lenet_csr_t *c);
+void lenet_csr_free      (lenet_csr_t *c);
+
+void Fc1_40_400_fixed_csr(
+        short input [POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        const lenet_csr_t *c,
+        short bias  [FC1_NBOUTPUT],
+        short output[FC1_NBOUTPUT]);
+
+
+/* ---------- FC1 factorisé de rang r (lowrank_fixed.c, lowrank_tool.c) ----------
+   FC1_KERNEL ≈ L · R, R [rank][cols] puis L [rows][rank], tous deux en Q8 :
+   rank * (rows + cols) MACs et poids au lieu de rows * cols. */
+#define LENET_LOWRANK_MAGIC    "LENETLR"    // 8 octets avec le '\0'
+#define LENET_LOWRANK_VERSION  1
+
+typedef struct {
+    char         magic[8];
+    unsigned int version;
+    unsigned int endian;                // 0x01020304 à l'écriture
+    unsigned int fixed_point;
+    unsigned int rows, cols, rank;
+    unsigned int r_off;                 // int16 [rank][cols]
+    unsigned int l_off;                 // int16 [rows][rank]
+    unsigned int file_size;
+} lenet_lowrank_header_t;
+
+typedef struct lenet_lowrank_s {
+    int   rows, cols, rank;
+    const short *r;                     // projection : t = R · x
+    const short *l;                     // expansion  : y = L · t + b
+    /* stockage : fichier mappé ou bloc alloué */
+    int    fd;
+    void  *map;
+    size_t size;
+    void  *mem;
+} lenet_lowrank_t;
+
+int  lenet_lowrank_save(const char *filename, const lenet_lowrank_t *f);
+int  lenet_lowrank_map (const char *filename, int rows, int cols, lenet_lowrank_t *f);
+void lenet_lowrank_free(lenet_lowrank_t *f);
+
+void Fc1_40_400_fixed_lowrank(
+        short input [POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        const lenet_lowrank_t *f,
+        short bias  [FC1_NBOUTPUT],
+        short output[FC1_NBOUTPUT]);
+
+
+/* ---------- Poids par dictionnaire (codebook_fixed.c, codebook_tool.c) ----------
+   Chaque couche : 16 ou 32 valeurs Q8 partagées (par couche ou par canal de
+   sortie) et un index de 4 / 5 bits par poids. Modèle complet (noyaux + biais). */
+#define LENET_CB_MAGIC    "LENETCB"         // 8 octets avec le '\0'
+#define LENET_CB_VERSION  1
+#define LENET_CB_MAX      32                // centroïdes max (index 5 bits)
+
+enum { LENET_CB_CONV1, LENET_CB_CONV2, LENET_CB_FC1, LENET_CB_FC2, LENET_CB_LAYERS };
+
+typedef struct {
+    unsigned int bits;                  // 4 (16 centroïdes) ou 5 (32)
+    unsigned int nbooks;                // 1 (par couche) ou rows (par canal)
+    unsigned int rows, cols;            // canaux de sortie x poids par canal
+    unsigned int row_bytes;             // index d'une ligne + 1 octet de garde
+    unsigned int book_off;              // int16 [nbooks][1 << bits]
+    unsigned int idx_off;               // uint8 [rows][row_bytes], bits LSB d'abord
+    unsigned int bias_off;              // int16 [rows]
+} lenet_cb_layer_t;
+
+typedef struct {
+    char         magic[8];
+    unsigned int version;
+    unsigned int endian;                // 0x01020304 à l'écriture
+    unsigned int fixed_point;
+    lenet_cb_layer_t layer[LENET_CB_LAYERS];
+    unsigned int file_size;
+} lenet_cb_header_t;
+
+/* Couche à écrire : un index (octet) par poids, lignes contiguës */
+typedef struct {
+    int bits, nbooks, rows, cols;
+    const short         *book;          // [nbooks][1 << bits]
+    const unsigned char *idx;           // [rows][cols]
+    const short         *bias;          // [rows]
+} lenet_cb_src_t;
+
+typedef struct lenet_cb_s {
+    const lenet_cb_layer_t *layer;      // table du fichier mappé
+    const unsigned char    *base;
+    short *dense;                       // Conv1, Conv2, FC2 décodés (FC1 reste indexé)
+    int    fd;
+    void  *map;
+    size_t size;
+} lenet_cb_t;
+
+int  lenet_cb_save (const char *filename, const lenet_cb_src_t src[LENET_CB_LAYERS]);
+int  lenet_cb_map  (const char *filename, lenet_cb_t *cb, lenet_weights_t *w);
+void lenet_cb_decode(const lenet_cb_t *cb, int layer, short *dst);   // dst[rows][cols]
+void lenet_cb_unmap(lenet_cb_t *cb);
+
+void Fc1_40_400_fixed_cb(
+        short input [POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        const lenet_cb_t *cb,
+        short bias  [FC1_NBOUTPUT],
+        short output[FC1_NBOUTPUT]);
+
+void lenet_ctx_init    (lenet_ctx_t *ctx, const lenet_weights_t *w);
+void lenet_ctx_set_conv(lenet_ctx_t *ctx, lenet_conv_backend_t backend);
+int  lenet_ctx_classify(lenet_ctx_t *ctx, const unsigned char *pix);
+int  lenet_ctx_run     (lenet_ctx_t *ctx);        // ctx->input déjà normalisé
+
+/* Une couche avec le noyau choisi par le contexte (ctx_forward, --perf) */
+void lenet_ctx_conv1(lenet_ctx_t *ctx,
+                     short output[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH]);
+void lenet_ctx_conv2(lenet_ctx_t *ctx,
+                     short input [POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH],
+                     short output[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH]);
+void lenet_ctx_fc1  (lenet_ctx_t *ctx,
+                     short input [POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+                     short output[FC1_NBOUTPUT]);
+void lenet_ctx_fc2  (lenet_ctx_t *ctx,
+                     short input [FC1_NBOUTPUT],
+                     short output[FC2_NBOUTPUT]);
+
+const unsigned char *lenet_load_pgm(void *arg, int idx, unsigned char *buf);  // arg : préfixe
+const unsigned char *lenet_load_idx(void *arg, int idx, unsigned char *buf);  // arg : lenet_idx_t*
+
+int  lenet_idx_open (lenet_idx_t *idx, const char *filename);
+void lenet_idx_close(lenet_idx_t *idx);
+
+
+/* ---------- Activations creuses après ReLU (sparse_fixed.c) ---------- */
+/* Liste (indice, valeur) des in[i] != 0, renvoie leur nombre */
+int  lenet_compress_nz(const short *in, int len, unsigned short *idx, short *val);
+
+void Conv2_12x12x20_5x5x40_1_0_fixed_sparse(
+        short input [POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH],
+        short kernel[CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short bias  [CONV2_NBOUTPUT],
+        short output[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH]);
+
+void Fc1_40_400_fixed_sparse(
+        short input [POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short kernel[FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short bias  [FC1_NBOUTPUT],
+        short output[FC1_NBOUTPUT]);
+
+void Fc1_40_400_fixed_packed_sparse(
+        short input [POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        const lenet_packed_t *p,
+        short bias  [FC1_NBOUTPUT],
+        short output[FC1_NBOUTPUT]);
+
+void Fc2_400_10_fixed_sparse(
+        short input [FC1_NBOUTPUT],
+        short kernel[FC2_NBOUTPUT][FC1_NBOUTPUT],
+        short bias  [FC2_NBOUTPUT],
+        short output[FC2_NBOUTPUT]);
+
+enum { LENET_SP_POOL1, LENET_SP_POOL2, LENET_SP_FC1, LENET_SP_COUNT };
+
+typedef struct {
+    unsigned long long nz  [LENET_SP_COUNT];    // activations non nulles
+    unsigned long long macs[LENET_SP_COUNT];    // MACs restants de la couche suivante
+    int                nb_images;
+} lenet_sparsity_t;
+
+void lenet_sparsity_profile(const lenet_weights_t *w, lenet_load_fn load, void *load_arg,
+                            int n, lenet_sparsity_t *s);
+void lenet_sparsity_report (const lenet_sparsity_t *s);
+
+
+/* ---------- Pipeline chargement / inférence (lenet_pipeline.c) ---------- */
+#define LENET_PIPE_SLOTS 64     // capacité de la file (puissance de 2)
+
+typedef struct {
+    unsigned long long pushes;          // images mises en file
+    unsigned long long full_stalls;     // attentes des chargeurs (file pleine)
+    unsigned long long empty_stalls;    // attentes du calcul (file vide)
+    unsigned long long depth_sum;       // profondeur vue à chaque retrait
+    unsigned int       depth_max;
+    double             load_s;          // temps cumulé lecture + normalisation
+    double             compute_s;       // temps cumulé inférence
+} lenet_pipe_stats_t;
+
+/* Chaque thread de calcul travaille sur une copie du contexte proto */
+void lenet_eval_pipelined(const lenet_ctx_t *proto,
+                          lenet_load_fn load, void *load_arg,
+                          const unsigned char *labels, int n,
+                          int nloaders, int nworkers,
+                          lenet_eval_result_t *res, lenet_pipe_stats_t *stats);
+
+void lenet_eval(const lenet_ctx_t *proto,
+                lenet_load_fn load, void *load_arg,
+                const unsigned char *labels, int n, int nthreads,
+                lenet_eval_result_t *res);
+
+#endif
+
+
+/**************************************
+ *  FC1 PAR TUILES : MODELE DE TRANSFERT (tiled_fixed.c)
+ *  Pour chaque taille de tuile divisant FC1_NBOUTPUT : octets lus,
+ *  buffers sur puce, cycles de burst / de calcul par tuile et part
+ *  du temps de chargement masquée par le ping-pong. Vérifie d'abord
+ *  que le noyau compilé (FC1_TILE) est bit-exact avec Fc1_40_400_fixed.
+ **************************************/
+#ifndef __SYNTHESIS__
+
+int lenet_fc1_tiled_report(const lenet_weights_t *w);     // -1 : pas bit-exact
+
+#endif
+
+/**************************************
+ *  PROTOCOLE DE L'ACCELERATEUR, EMULE SUR CPU (accel_fixed.c)
+ *  lenet_accel() appelée directement, octets comptés par commande :
+ *  ce que le data mover PS↔PL transférerait pour chaque argument.
+ *  Une seule instance (mémoire locale statique) : pas réentrant.
+ **************************************/
+#ifndef __SYNTHESIS__
+
+typedef struct {
+    unsigned long long load_bytes;      // poids (+ image et logits factices) envoyés (LOAD)
+    unsigned long long in_bytes;        // images envoyées (INFER)
+    unsigned long long out_bytes;       // logits rapatriés (INFER)
+    unsigned long long fc1_bytes;       // FC1 lu en DDR par l'accélérateur (INFER)
+    unsigned int       loads;
+    unsigned int       infers;
+    unsigned int       ref_errors;      // erreurs de lenet_cnn_fixed() (Q8, CPU)
+    unsigned int       mismatches;      // images aux logits différents de la référence
+} lenet_accel_stats_t;
+
+void lenet_accel_pack_params(const lenet_weights_t *w, short params[LENET_PARAM_WORDS]);
+void lenet_accel_emu_load (lenet_accel_stats_t *st, short params[LENET_PARAM_WORDS],
+                           short fc1_k[FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH]);
+void lenet_accel_emu_infer(lenet_accel_stats_t *st,
+                           short fc1_k[FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+                           short input[IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+                           short out[FC2_NBOUTPUT]);
+
+/* Charge w une fois puis classe n images ; renvoie le nombre d'erreurs.
+   Chaque image passe aussi par lenet_cnn_fixed() (référence Q8). */
+unsigned int lenet_accel_eval(const lenet_weights_t *w, lenet_load_fn load, void *load_arg,
+                              const unsigned char *labels, int n, lenet_accel_stats_t *st);
+void lenet_accel_report(const lenet_accel_stats_t *st);
+
+#endif
+
+/**************************************
+ *  COMPTEURS MATERIELS (lenet_perf.c, Linux perf_event_open)
+ *  Un groupe de compteurs lu avant / après chaque couche ; un compteur
+ *  non disponible (VM, PMU absente, perf_event_paranoid) est marqué
+ *  absent (fd < 0) et affiché "n/a".
+ **************************************/
+#ifndef __SYNTHESIS__
+
+typedef enum {
+    LENET_PERF_CYCLES,
+    LENET_PERF_INSTR,
+    LENET_PERF_L1D_MISS,        // lectures L1D manquées
+    LENET_PERF_LLC_MISS,        // lectures LLC manquées
+    LENET_PERF_BR_MISS,
+    LENET_PERF_TASK_NS,         // task-clock (logiciel, toujours présent)
+    LENET_PERF_NCOUNTERS
+} lenet_perf_counter_t;
+
+typedef struct {
+    int fd [LENET_PERF_NCOUNTERS];      // -1 : compteur indisponible
+    int pos[LENET_PERF_NCOUNTERS];      // rang dans la lecture groupée
+    int leader;
+    int nopen;
+} lenet_perf_t;
+
+int  lenet_perf_open (lenet_perf_t *p);     // 0 si au moins un compteur
+void lenet_perf_close(lenet_perf_t *p);
+void lenet_perf_read (const lenet_perf_t *p, unsigned long long v[LENET_PERF_NCOUNTERS]);
+
+/* Passe mono-thread sur n images avec les noyaux du contexte, lecture
+ * des compteurs autour de chaque couche, puis tableau par couche
+ * (IPC, MACs/cycle). */
+int lenet_perf_profile(const lenet_ctx_t *proto, lenet_load_fn load, void *load_arg, int n);
+
+#endif
+
+/**************************************
+ *  TRACE PAR COUCHE (lenet_trace.c)
+ *  Compilée uniquement avec -DLENET_TRACE : sinon les macros sont vides
+ *  et aucun code n'est généré (ni en HLS, ni sur CPU).
+ *  Chaque thread enregistre ses événements (début / fin en cycles TSC)
+ *  dans son propre buffer ; lenet_trace_dump() écrit un fichier JSON au
+ *  format "trace event" (chrome://tracing, ui.perfetto.dev).
+ *
+ *      LENET_TRACE_BEGIN(CONV1);
+ *      Conv1_28x28x1_5x5x20_1_0_fixed(...);
+ *      LENET_TRACE_END(CONV1);
+ **************************************/
+#if defined(LENET_TRACE) && !defined(__SYNTHESIS__)
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+#ifndef LENET_TRACE_MAX_EVENTS
+#define LENET_TRACE_MAX_EVENTS (1 << 17)   // par thread, au-delà : ignorés
+#endif
+
+typedef enum {
+    LENET_EV_LOAD,
+    LENET_EV_NORMALIZE,
+    LENET_EV_CONV1,
+    LENET_EV_POOL1,
+    LENET_EV_CONV1_POOL1,       // backend fused
+    LENET_EV_CONV2,
+    LENET_EV_POOL2,
+    LENET_EV_CONV2_POOL2,
+    LENET_EV_FC1,
+    LENET_EV_FC2,
+    LENET_EV_SOFTMAX,
+    LENET_EV_COUNT
+} lenet_trace_ev_t;
+
+/* Compteur de cycles : TSC (x86), compteur virtuel (ARMv8), sinon ns */
+static inline unsigned long long lenet_trace_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    unsigned long long t;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(t));
+    return t;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+void lenet_trace_start (void);                  // active l'enregistrement
+void lenet_trace_thread(const char *name);      // nom du thread courant
+void lenet_trace_record(lenet_trace_ev_t ev,
+                        unsigned long long t0, unsigned long long t1);
+int  lenet_trace_dump  (const char *filename);  // JSON + résumé par couche
+
+#define LENET_TRACE_BEGIN(ev)   unsigned long long lenet_t0_##ev = lenet_trace_now()
+#define LENET_TRACE_END(ev)     lenet_trace_record(LENET_EV_##ev, lenet_t0_##ev, lenet_trace_now())
+#define LENET_TRACE_THREAD(nm)  lenet_trace_thread(nm)
+
+#else
+
+#define LENET_TRACE_BEGIN(ev)
+#define LENET_TRACE_END(ev)
+#define LENET_TRACE_THREAD(nm)
+
+#endif
 
 
 /**************************************
@@ -0,0 +1,360 @@
+/**
+  ******************************************************************************
+  * @file    lenet_ctx.c
+  * @brief   Reentrant inference contexts + multi-threaded MNIST evaluation
+  * @note    CPU only (not synthesized)
+  ******************************************************************************
+  */
+
+#ifndef __SYNTHESIS__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "lenet_cnn_fixed_point.h"
+
+
+/**************************************
+ *  CONTEXTE
+ **************************************/
+
+void lenet_ctx_init(lenet_ctx_t *ctx, const lenet_weights_t *w)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->w = w;
+    lenet_ctx_set_conv(ctx, LENET_CONV_SIMD);
+}
+
+
+void lenet_ctx_set_conv(lenet_ctx_t *ctx, lenet_conv_backend_t backend)
+{
+    ctx->conv1_pool = 0;
+    ctx->conv2_pool = 0;
+
+    if (backend == LENET_CONV_PACKED && !ctx->w->packed) {
+        printf("ERROR: packed conv requested but weights are not packed\n");
+        backend = LENET_CONV_SCALAR;
+    }
+    ctx->backend = backend;
+
+    switch (backend) {
+    case LENET_CONV_SIMD:
+        ctx->conv1 = Conv1_28x28x1_5x5x20_1_0_fixed_simd;
+        ctx->conv2 = Conv2_12x12x20_5x5x40_1_0_fixed_simd;
+        break;
+    case LENET_CONV_GEMM:
+        ctx->conv1 = Conv1_28x28x1_5x5x20_1_0_fixed_gemm;
+        ctx->conv2 = Conv2_12x12x20_5x5x40_1_0_fixed_gemm;
+        break;
+    case LENET_CONV_FUSED:
+        ctx->conv1      = Conv1_28x28x1_5x5x20_1_0_fixed;
+        ctx->conv2      = Conv2_12x12x20_5x5x40_1_0_fixed;
+        ctx->conv1_pool = Conv1Pool1_28x28x1_5x5x20_2x2_fixed;
+        ctx->conv2_pool = Conv2Pool2_12x12x20_5x5x40_2x2_fixed;
+        break;
+    case LENET_CONV_PACKED:     // ctx_forward passe par w->packed
+    case LENET_CONV_SCALAR:
+    default:
+        ctx->conv1 = Conv1_28x28x1_5x5x20_1_0_fixed;
+        ctx->conv2 = Conv2_12x12x20_5x5x40_1_0_fixed;
+        break;
+    }
+}
+
+
+/**************************************
+ *  COUCHES : choix du noyau selon le contexte
+ *  Seul endroit qui aiguille entre formats de poids et variantes ;
+ *  ctx_forward() et lenet_perf_profile() passent tous deux par ici.
+ **************************************/
+void lenet_ctx_conv1(lenet_ctx_t *ctx,
+                     short output[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH])
+{
+    const lenet_weights_t *w = ctx->w;
+
+    if (ctx->pix) {
+        /* pixels bruts, normalisation repliée dans le noyau (poids en lecture seule) */
+        unsigned char (*pix)[IMG_HEIGHT][IMG_WIDTH] = (unsigned char (*)[IMG_HEIGHT][IMG_WIDTH])ctx->pix;
+        lenet_conv1_u8_t *f = (lenet_conv1_u8_t*)w->conv1_u8;
+
+        if (ctx->backend == LENET_CONV_SIMD)
+            Conv1_28x28x1_5x5x20_1_0_fixed_u8_simd(pix, f->k, f->b, output);
+        else
+            Conv1_28x28x1_5x5x20_1_0_fixed_u8(pix, f->k, f->b, output);
+    } else if (ctx->backend == LENET_CONV_PACKED)
+        Conv1_28x28x1_5x5x20_1_0_fixed_packed(ctx->input, w->packed, w->conv1_b, output);
+    else
+        ctx->conv1(ctx->input, w->conv1_k, w->conv1_b, output);
+}
+
+
+void lenet_ctx_conv2(lenet_ctx_t *ctx,
+                     short input [POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH],
+                     short output[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH])
+{
+    const lenet_weights_t *w = ctx->w;
+
+    if (ctx->sparse)
+        Conv2_12x12x20_5x5x40_1_0_fixed_sparse(input, w->conv2_k, w->conv2_b, output);
+    else if (ctx->backend == LENET_CONV_PACKED)
+        Conv2_12x12x20_5x5x40_1_0_fixed_packed(input, w->packed, w->conv2_b, output);
+    else
+        ctx->conv2(input, w->conv2_k, w->conv2_b, output);
+}
+
+
+void lenet_ctx_fc1(lenet_ctx_t *ctx,
+                   short input [POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+                   short output[FC1_NBOUTPUT])
+{
+    const lenet_weights_t *w = ctx->w;
+
+    if (w->fc1_csr)
+        Fc1_40_400_fixed_csr(input, w->fc1_csr, w->fc1_b, output);
+    else if (w->fc1_lowrank)
+        Fc1_40_400_fixed_lowrank(input, w->fc1_lowrank, w->fc1_b, output);
+    else if (w->fc1_cb)
+        Fc1_40_400_fixed_cb(input, w->fc1_cb, w->fc1_b, output);
+    else if (ctx->sparse && w->packed)
+        Fc1_40_400_fixed_packed_sparse(input, w->packed, w->fc1_b, output);
+    else if (ctx->sparse)
+        Fc1_40_400_fixed_sparse(input, w->fc1_k, w->fc1_b, output);
+    else if (ctx->fc1_tiled)
+        Fc1_40_400_fixed_tiled(input, w->fc1_k, w->fc1_b, output);
+    else if (w->packed)
+        Fc1_40_400_fixed_packed(input, w->packed, w->fc1_b, output);
+    else
+        Fc1_40_400_fixed(input, w->fc1_k, w->fc1_b, output);
+}
+
+
+void lenet_ctx_fc2(lenet_ctx_t *ctx,
+                   short input [FC1_NBOUTPUT],
+                   short output[FC2_NBOUTPUT])
+{
+    const lenet_weights_t *w = ctx->w;
+
+    if (ctx->sparse)
+        Fc2_400_10_fixed_sparse(input, w->fc2_k, w->fc2_b, output);
+    else
+        Fc2_400_10_fixed(input, w->fc2_k, w->fc2_b, output);
+}
+
+
+/* Même enchaînement que lenet_cnn_fixed(), noyaux au choix */
+static void ctx_forward(lenet_ctx_t *ctx)
+{
+    const lenet_weights_t *w = ctx->w;
+
+    short conv1_out[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH];
+    short pool1_out[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH];
+    short conv2_out[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH];
+    short pool2_out[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH];
+    short fc1_out[FC1_NBOUTPUT];
+
+    if (ctx->int8) {
+        lenet_int8_forward(ctx->int8, ctx->input, ctx->logits);
+        return;
+    }
+
+    if (ctx->conv1_pool && !ctx->pix) {
+        LENET_TRACE_BEGIN(CONV1_POOL1);
+        ctx->conv1_pool(ctx->input, w->conv1_k, w->conv1_b, pool1_out);
+        LENET_TRACE_END(CONV1_POOL1);
+    } else {
+        LENET_TRACE_BEGIN(CONV1);
+        lenet_ctx_conv1(ctx, conv1_out);
+        LENET_TRACE_END(CONV1);
+
+        LENET_TRACE_BEGIN(POOL1);
+        Pool1_24x24x20_2x2x20_2_0_fixed(conv1_out, pool1_out);
+        LENET_TRACE_END(POOL1);
+    }
+
+    if (ctx->conv2_pool) {
+        LENET_TRACE_BEGIN(CONV2_POOL2);
+        ctx->conv2_pool(pool1_out, w->conv2_k, w->conv2_b, pool2_out);
+        LENET_TRACE_END(CONV2_POOL2);
+    } else {
+        LENET_TRACE_BEGIN(CONV2);
+        lenet_ctx_conv2(ctx, pool1_out, conv2_out);
+        LENET_TRACE_END(CONV2);
+
+        LENET_TRACE_BEGIN(POOL2);
+        Pool2_8x8x40_2x2x40_2_0_fixed(conv2_out, pool2_out);
+        LENET_TRACE_END(POOL2);
+    }
+
+    LENET_TRACE_BEGIN(FC1);
+    lenet_ctx_fc1(ctx, pool2_out, fc1_out);
+    LENET_TRACE_END(FC1);
+
+    LENET_TRACE_BEGIN(FC2);
+    lenet_ctx_fc2(ctx, fc1_out, ctx->logits);
+    LENET_TRACE_END(FC2);
+}
+
+
+/* Normalisation -> CNN -> Softmax -> argmax, sans aucun état global */
+int lenet_ctx_classify(lenet_ctx_t *ctx, const unsigned char *pix)
+{
+    if (ctx->w->conv1_u8 && !ctx->int8) {
+        int pred;
+
+        ctx->pix = pix;
+        pred = lenet_ctx_run(ctx);
+        ctx->pix = NULL;
+        return pred;
+    }
+
+    LENET_TRACE_BEGIN(NORMALIZE);
+    NormalizeImg_fixed(pix, (short*)ctx->input, IMG_WIDTH, IMG_HEIGHT);
+    LENET_TRACE_END(NORMALIZE);
+
+    return lenet_ctx_run(ctx);
+}
+
+
+/* CNN -> Softmax -> argmax sur ctx->input déjà normalisé */
+int lenet_ctx_run(lenet_ctx_t *ctx)
+{
+    ctx_forward(ctx);
+
+    if (ctx->int_output)
+        return Argmax_fixed(ctx->logits, 0);
+
+    LENET_TRACE_BEGIN(SOFTMAX);
+    Softmax_fixed(ctx->logits, ctx->proba);
+    LENET_TRACE_END(SOFTMAX);
+
+    float max = ctx->proba[0];
+    int pred = 0;
+
+    for (int k = 1; k < FC2_NBOUTPUT; k++) {
+        if (ctx->proba[k] > max) {
+            max = ctx->proba[k];
+            pred = k;
+        }
+    }
+
+    return pred;
+}
+
+
+/**************************************
+ *  CHARGEUR PGM (une image par fichier)
+ **************************************/
+
+const unsigned char *lenet_load_pgm(void *arg, int idx, unsigned char *buf)
+{
+    char img_file[128];
+    snprintf(img_file, sizeof(img_file), "%s[%05d].pgm", (char*)arg, idx);
+    ReadPgmFile(img_file, buf);
+    return buf;
+}
+
+
+/**************************************
+ *  EVALUATION MULTI-THREAD
+ *  Les images sont distribuées dynamiquement (compteur atomique) ;
+ *  chaque thread a son contexte et son compteur d'erreurs, fusionnés
+ *  à la fin.
+ **************************************/
+
+typedef struct {
+    const lenet_ctx_t     *proto;
+    lenet_load_fn          load;
+    void                  *load_arg;
+    const unsigned char   *labels;
+    int                    n;
+    int                   *next;        // prochaine image à traiter
+    lenet_eval_result_t   *res;         // image 0 uniquement
+    unsigned int           errors;      // local au thread
+} eval_worker_t;
+
+
+static void *eval_worker(void *p)
+{
+    eval_worker_t *wk = (eval_worker_t*)p;
+    lenet_ctx_t ctx;
+    unsigned char img_px[IMG_WIDTH * IMG_HEIGHT];
+
+    ctx = *wk->proto;
+    LENET_TRACE_THREAD("worker");
+
+    while (1) {
+        int i = __sync_fetch_and_add(wk->next, 1);
+        if (i >= wk->n) break;
+
+        LENET_TRACE_BEGIN(LOAD);
+        const unsigned char *pix = wk->load(wk->load_arg, i, img_px);
+        LENET_TRACE_END(LOAD);
+
+        int pred = lenet_ctx_classify(&ctx, pix);
+
+        if (i == 0) {
+            wk->res->first_pred = pred;
+            memcpy(wk->res->first_logits, ctx.logits, sizeof(ctx.logits));
+            memcpy(wk->res->first_proba, ctx.proba, sizeof(ctx.proba));
+        }
+
+        if (pred != wk->labels[i])
+            wk->errors++;
+    }
+
+    return NULL;
+}
+
+
+void lenet_eval(const lenet_ctx_t *proto,
+                lenet_load_fn load, void *load_arg,
+                const unsigned char *labels, int n, int nthreads,
+                lenet_eval_result_t *res)
+{
+    int next = 0;
+    int t;
+
+    if (nthreads < 1) nthreads = 1;
+
+    eval_worker_t *wk  = calloc(nthreads, sizeof(*wk));
+    pthread_t     *tid = calloc(nthreads, sizeof(*tid));
+    if (!wk || !tid) {
+        printf("ERROR: out of memory\n");
+        exit(1);
+    }
+
+    memset(res, 0, sizeof(*res));
+
+    for (t = 0; t < nthreads; t++) {
+        wk[t].proto    = proto;
+        wk[t].load     = load;
+        wk[t].load_arg = load_arg;
+        wk[t].labels   = labels;
+        wk[t].n        = n;
+        wk[t].next     = &next;
+        wk[t].res      = res;
+    }
+
+    /* le thread appelant sert de worker 0 */
+    for (t = 1; t < nthreads; t++) {
+        if (pthread_create(&tid[t], NULL, eval_worker, &wk[t]) != 0) {
+            printf("ERROR: pthread_create failed\n");
+            exit(1);
+        }
+    }
+    eval_worker(&wk[0]);
+
+    for (t = 1; t < nthreads; t++)
+        pthread_join(tid[t], NULL);
+
+    for (t = 0; t < nthreads; t++)
+        res->errors += wk[t].errors;
+    res->n = (n > 0) ? n : 0;
+
+    free(wk);
+    free(tid);
+}
+
+#endif
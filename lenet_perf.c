@@ -0,0 +1,276 @@
+/**
+  ******************************************************************************
+  * @file    lenet_perf.c
+  * @brief   Per-layer hardware performance counters (perf_event_open) :
+  *          instructions, cycles, L1D / LLC misses, branch misses
+  * @note    CPU only, Linux ; elsewhere lenet_perf_open() fails
+  ******************************************************************************
+  */
+
+#ifndef __SYNTHESIS__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "lenet_cnn_fixed_point.h"
+
+
+/**************************************
+ *  GROUPE DE COMPTEURS
+ *  Le premier compteur ouvert est le leader ; tous les autres sont lus
+ *  en une seule lecture (PERF_FORMAT_GROUP), comptage utilisateur seul.
+ **************************************/
+
+#ifdef __linux__
+
+static const struct {
+    unsigned int       type;
+    unsigned long long config;
+    const char        *name;
+} perf_ev[LENET_PERF_NCOUNTERS] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,       "cycles" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,     "instructions" },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+                        | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), "L1D read misses" },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL
+                        | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), "LLC read misses" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,    "branch misses" },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK,       "task-clock" },
+};
+
+
+int lenet_perf_open(lenet_perf_t *p)
+{
+    struct perf_event_attr attr;
+    int c;
+
+    p->leader = -1;
+    p->nopen  = 0;
+
+    for (c = 0; c < LENET_PERF_NCOUNTERS; c++) {
+        memset(&attr, 0, sizeof(attr));
+        attr.size           = sizeof(attr);
+        attr.type           = perf_ev[c].type;
+        attr.config         = perf_ev[c].config;
+        attr.read_format    = PERF_FORMAT_GROUP;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.disabled       = (p->leader < 0);      // le leader démarre le groupe
+
+        p->fd[c]  = (int)syscall(__NR_perf_event_open, &attr, 0, -1, p->leader, 0);
+        p->pos[c] = -1;
+
+        if (p->fd[c] < 0) {
+            printf("WARNING: perf counter '%s' unavailable (%s)\n",
+                   perf_ev[c].name, strerror(errno));
+            continue;
+        }
+        if (p->leader < 0)
+            p->leader = p->fd[c];
+        p->pos[c] = p->nopen++;
+    }
+
+    if (p->leader < 0) {
+        printf("ERROR: perf_event_open failed for every counter\n");
+        return -1;
+    }
+
+    ioctl(p->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(p->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    return 0;
+}
+
+
+void lenet_perf_close(lenet_perf_t *p)
+{
+    int c;
+
+    for (c = 0; c < LENET_PERF_NCOUNTERS; c++)
+        if (p->fd[c] >= 0 && p->fd[c] != p->leader)
+            close(p->fd[c]);
+    if (p->leader >= 0)
+        close(p->leader);
+    p->leader = -1;
+    p->nopen  = 0;
+}
+
+
+void lenet_perf_read(const lenet_perf_t *p, unsigned long long v[LENET_PERF_NCOUNTERS])
+{
+    unsigned long long buf[1 + LENET_PERF_NCOUNTERS];     // nr, valeurs
+    int c;
+
+    if (read(p->leader, buf, sizeof(buf)) < (ssize_t)sizeof(unsigned long long))
+        buf[0] = 0;
+
+    for (c = 0; c < LENET_PERF_NCOUNTERS; c++)
+        v[c] = (p->pos[c] >= 0 && (unsigned long long)p->pos[c] < buf[0]) ? buf[1 + p->pos[c]] : 0;
+}
+
+#else
+
+int lenet_perf_open(lenet_perf_t *p)
+{
+    p->leader = -1;
+    p->nopen  = 0;
+    printf("ERROR: perf counters need Linux perf_event_open\n");
+    return -1;
+}
+
+void lenet_perf_close(lenet_perf_t *p)
+{
+    (void)p;
+}
+
+void lenet_perf_read(const lenet_perf_t *p, unsigned long long v[LENET_PERF_NCOUNTERS])
+{
+    (void)p;
+    memset(v, 0, LENET_PERF_NCOUNTERS * sizeof(v[0]));
+}
+
+#endif
+
+
+/**************************************
+ *  PROFIL PAR COUCHE
+ **************************************/
+
+enum { L_CONV1, L_POOL1, L_CONV2, L_POOL2, L_FC1, L_FC2, L_COUNT };
+
+static const char *layer_name[L_COUNT] = { "Conv1", "Pool1", "Conv2", "Pool2", "FC1", "FC2" };
+static const long  layer_macs[L_COUNT] = { CONV1_MACS, 0, CONV2_MACS, 0, FC1_MACS, FC2_MACS };
+
+typedef struct {
+    lenet_perf_t       *p;
+    unsigned long long  t[LENET_PERF_NCOUNTERS];    // dernière lecture
+    unsigned long long  sum[L_COUNT][LENET_PERF_NCOUNTERS];
+} perf_acc_t;
+
+/* Attribue à la couche l tout ce qui a été compté depuis la lecture précédente */
+static void perf_mark(perf_acc_t *a, int l)
+{
+    unsigned long long v[LENET_PERF_NCOUNTERS];
+    int c;
+
+    lenet_perf_read(a->p, v);
+    if (l >= 0)
+        for (c = 0; c < LENET_PERF_NCOUNTERS; c++)
+            a->sum[l][c] += v[c] - a->t[c];
+    memcpy(a->t, v, sizeof(v));
+}
+
+
+int lenet_perf_profile(const lenet_ctx_t *proto, lenet_load_fn load, void *load_arg, int n)
+{
+    const lenet_weights_t *w = proto->w;
+    lenet_ctx_t ctx = *proto;
+    lenet_perf_t p;
+    perf_acc_t *a;
+    unsigned char buf[IMG_WIDTH * IMG_HEIGHT];
+    int i, l, c;
+
+    short conv1_out[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH];
+    short pool1_out[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH];
+    short conv2_out[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH];
+    short pool2_out[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH];
+    short fc1_out[FC1_NBOUTPUT];
+
+    if (lenet_perf_open(&p) != 0)
+        return -1;
+
+    a = calloc(1, sizeof(*a));
+    if (!a) {
+        printf("ERROR: out of memory\n");
+        lenet_perf_close(&p);
+        return -1;
+    }
+    a->p = &p;
+
+    /* les couches fusionnées sont mesurées séparément : conv + pool */
+    if (ctx.conv1_pool) {
+        printf("NOTE: fused backend profiled as separate scalar conv / pool\n");
+        lenet_ctx_set_conv(&ctx, LENET_CONV_SCALAR);
+    }
+
+    for (i = 0; i < n; i++) {
+        const unsigned char *pix = load(load_arg, i, buf);
+
+        /* Conv1 sur les pixels bruts si la normalisation est repliée */
+        ctx.pix = w->conv1_u8 ? pix : NULL;
+        if (!ctx.pix)
+            NormalizeImg_fixed(pix, (short*)ctx.input, IMG_WIDTH, IMG_HEIGHT);
+
+        perf_mark(a, -1);
+
+        lenet_ctx_conv1(&ctx, conv1_out);
+        perf_mark(a, L_CONV1);
+
+        Pool1_24x24x20_2x2x20_2_0_fixed(conv1_out, pool1_out);
+        perf_mark(a, L_POOL1);
+
+        lenet_ctx_conv2(&ctx, pool1_out, conv2_out);
+        perf_mark(a, L_CONV2);
+
+        Pool2_8x8x40_2x2x40_2_0_fixed(conv2_out, pool2_out);
+        perf_mark(a, L_POOL2);
+
+        lenet_ctx_fc1(&ctx, pool2_out, fc1_out);
+        perf_mark(a, L_FC1);
+
+        lenet_ctx_fc2(&ctx, fc1_out, ctx.logits);
+        perf_mark(a, L_FC2);
+    }
+
+    lenet_perf_close(&p);
+
+    /* valeurs par appel ; -1 : compteur absent */
+    printf("\nPer-layer counters (%d images, per call, user mode)\n", n);
+    printf("  %-6s %10s %12s %12s %6s %10s %10s %10s %10s\n",
+           "layer", "time (us)", "cycles", "instr", "IPC",
+           "L1D miss", "LLC miss", "br miss", "MACs/cyc");
+
+    for (l = 0; l < L_COUNT && n > 0; l++) {
+        double v[LENET_PERF_NCOUNTERS];
+        char col[LENET_PERF_NCOUNTERS][16];
+        char ipc[16], mpc[16];
+
+        for (c = 0; c < LENET_PERF_NCOUNTERS; c++) {
+            v[c] = (p.pos[c] >= 0) ? (double)a->sum[l][c] / n : -1.0;
+            if (v[c] < 0) snprintf(col[c], sizeof(col[c]), "n/a");
+            else          snprintf(col[c], sizeof(col[c]), "%.0f", v[c]);
+        }
+        if (v[LENET_PERF_TASK_NS] >= 0)
+            snprintf(col[LENET_PERF_TASK_NS], sizeof(col[0]), "%.2f", v[LENET_PERF_TASK_NS] * 1e-3);
+
+        if (v[LENET_PERF_CYCLES] > 0 && v[LENET_PERF_INSTR] >= 0)
+            snprintf(ipc, sizeof(ipc), "%.2f", v[LENET_PERF_INSTR] / v[LENET_PERF_CYCLES]);
+        else
+            snprintf(ipc, sizeof(ipc), "n/a");
+
+        if (v[LENET_PERF_CYCLES] > 0 && layer_macs[l])
+            snprintf(mpc, sizeof(mpc), "%.2f", layer_macs[l] / v[LENET_PERF_CYCLES]);
+        else
+            snprintf(mpc, sizeof(mpc), "%s", layer_macs[l] ? "n/a" : "-");
+
+        printf("  %-6s %10s %12s %12s %6s %10s %10s %10s %10s\n", layer_name[l],
+               col[LENET_PERF_TASK_NS], col[LENET_PERF_CYCLES], col[LENET_PERF_INSTR], ipc,
+               col[LENET_PERF_L1D_MISS], col[LENET_PERF_LLC_MISS], col[LENET_PERF_BR_MISS], mpc);
+    }
+
+    free(a);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,304 @@
+/**
+  ******************************************************************************
+  * @file    lenet_pipeline.c
+  * @brief   Producer / consumer evaluation : loader threads decode and
+  *          normalize images while compute threads run the network
+  * @note    CPU only (pthreads + builtins atomiques GCC)
+  ******************************************************************************
+  */
+
+#ifndef __SYNTHESIS__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/time.h>
+
+#include "lenet_cnn_fixed_point.h"
+
+#if (LENET_PIPE_SLOTS & (LENET_PIPE_SLOTS - 1)) != 0
+#error "LENET_PIPE_SLOTS must be a power of 2"
+#endif
+
+
+/**************************************
+ *  FILE BORNEE SANS VERROU (MPMC)
+ *  Anneau de cases numérotées : la case i est libre pour le producteur
+ *  quand seq == pos, prête pour le consommateur quand seq == pos + 1.
+ *  Une case contient directement l'image normalisée (pas d'allocation).
+ **************************************/
+
+typedef struct {
+    unsigned long seq;
+    int   idx;                                  // numéro de l'image
+    short input[IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH];
+    unsigned char pix[IMG_DEPTH * IMG_HEIGHT * IMG_WIDTH];  // w->conv1_u8 : pixels bruts
+} pipe_cell_t;
+
+typedef struct {
+    pipe_cell_t   cell[LENET_PIPE_SLOTS];
+    unsigned long head __attribute__((aligned(64)));    // prochain retrait
+    unsigned long tail __attribute__((aligned(64)));    // prochain ajout
+} pipe_ring_t;
+
+
+static void ring_init(pipe_ring_t *r)
+{
+    unsigned long i;
+    for (i = 0; i < LENET_PIPE_SLOTS; i++)
+        r->cell[i].seq = i;
+    r->head = 0;
+    r->tail = 0;
+}
+
+/* Réserve une case libre (NULL si la file est pleine) */
+static pipe_cell_t *ring_reserve(pipe_ring_t *r, unsigned long *pos)
+{
+    unsigned long p = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+
+    while (1) {
+        pipe_cell_t *c = &r->cell[p & (LENET_PIPE_SLOTS - 1)];
+        long dif = (long)(__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) - p);
+
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&r->tail, &p, p + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *pos = p;
+                return c;
+            }
+        } else if (dif < 0) {
+            return NULL;
+        } else {
+            p = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void ring_publish(pipe_cell_t *c, unsigned long pos)
+{
+    __atomic_store_n(&c->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+/* Prend une case prête (NULL si la file est vide) */
+static pipe_cell_t *ring_take(pipe_ring_t *r, unsigned long *pos)
+{
+    unsigned long p = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+
+    while (1) {
+        pipe_cell_t *c = &r->cell[p & (LENET_PIPE_SLOTS - 1)];
+        long dif = (long)(__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) - (p + 1));
+
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&r->head, &p, p + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *pos = p;
+                return c;
+            }
+        } else if (dif < 0) {
+            return NULL;
+        } else {
+            p = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void ring_release(pipe_cell_t *c, unsigned long pos)
+{
+    __atomic_store_n(&c->seq, pos + LENET_PIPE_SLOTS, __ATOMIC_RELEASE);
+}
+
+
+/**************************************
+ *  THREADS
+ **************************************/
+
+typedef struct {
+    pipe_ring_t           *ring;
+    const lenet_ctx_t     *proto;
+    lenet_load_fn          load;
+    void                  *load_arg;
+    const unsigned char   *labels;
+    int                    n;
+    int                   *next_load;       // prochaine image à charger
+    int                   *next_take;       // tickets de retrait
+    lenet_eval_result_t   *res;             // image 0 uniquement
+    unsigned int           errors;          // locaux au thread
+    lenet_pipe_stats_t     st;
+} pipe_thread_t;
+
+
+static double now_s(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+
+static void *loader_thread(void *p)
+{
+    pipe_thread_t *th = (pipe_thread_t*)p;
+    unsigned char buf[IMG_WIDTH * IMG_HEIGHT];
+
+    LENET_TRACE_THREAD("loader");
+
+    while (1) {
+        int i = __sync_fetch_and_add(th->next_load, 1);
+        if (i >= th->n) break;
+
+        unsigned long pos;
+        pipe_cell_t *c;
+
+        while ((c = ring_reserve(th->ring, &pos)) == NULL) {
+            th->st.full_stalls++;
+            sched_yield();
+        }
+
+        double t0 = now_s();
+        LENET_TRACE_BEGIN(LOAD);
+        const unsigned char *pix = th->load(th->load_arg, i, buf);
+        LENET_TRACE_END(LOAD);
+
+        if (th->proto->w->conv1_u8 && !th->proto->int8) {
+            memcpy(c->pix, pix, sizeof(c->pix));
+        } else {
+            LENET_TRACE_BEGIN(NORMALIZE);
+            NormalizeImg_fixed(pix, (short*)c->input, IMG_WIDTH, IMG_HEIGHT);
+            LENET_TRACE_END(NORMALIZE);
+        }
+        c->idx = i;
+        th->st.load_s += now_s() - t0;
+
+        ring_publish(c, pos);
+        th->st.pushes++;
+    }
+
+    return NULL;
+}
+
+
+static void *compute_thread(void *p)
+{
+    pipe_thread_t *th = (pipe_thread_t*)p;
+    lenet_ctx_t ctx;
+    unsigned char pix[IMG_DEPTH * IMG_HEIGHT * IMG_WIDTH];
+    int raw;
+
+    ctx = *th->proto;
+    raw = (ctx.w->conv1_u8 && !ctx.int8);
+    LENET_TRACE_THREAD("compute");
+
+    while (__sync_fetch_and_add(th->next_take, 1) < th->n) {
+
+        unsigned long pos;
+        pipe_cell_t *c;
+
+        while ((c = ring_take(th->ring, &pos)) == NULL) {
+            th->st.empty_stalls++;
+            sched_yield();
+        }
+
+        /* profondeur au moment du retrait (cette image comprise) */
+        unsigned long tail  = __atomic_load_n(&th->ring->tail, __ATOMIC_RELAXED);
+        unsigned int  depth = (tail > pos) ? (unsigned int)(tail - pos) : 1;
+        th->st.depth_sum += depth;
+        if (depth > th->st.depth_max) th->st.depth_max = depth;
+
+        int i = c->idx;
+        if (raw)
+            memcpy(pix, c->pix, sizeof(pix));
+        else
+            memcpy(ctx.input, c->input, sizeof(ctx.input));
+        ring_release(c, pos);
+
+        ctx.pix = raw ? pix : NULL;
+
+        double t0 = now_s();
+        int pred = lenet_ctx_run(&ctx);
+        th->st.compute_s += now_s() - t0;
+
+        if (i == 0) {
+            th->res->first_pred = pred;
+            memcpy(th->res->first_logits, ctx.logits, sizeof(ctx.logits));
+            memcpy(th->res->first_proba, ctx.proba, sizeof(ctx.proba));
+        }
+
+        if (pred != th->labels[i])
+            th->errors++;
+    }
+
+    return NULL;
+}
+
+
+/**************************************
+ *  EVALUATION PIPELINEE
+ **************************************/
+
+void lenet_eval_pipelined(const lenet_ctx_t *proto,
+                          lenet_load_fn load, void *load_arg,
+                          const unsigned char *labels, int n,
+                          int nloaders, int nworkers,
+                          lenet_eval_result_t *res, lenet_pipe_stats_t *stats)
+{
+    int next_load = 0, next_take = 0;
+    int nth, t;
+
+    if (nloaders < 1) nloaders = 1;
+    if (nworkers < 1) nworkers = 1;
+    nth = nloaders + nworkers;
+
+    pipe_ring_t   *ring = malloc(sizeof(*ring));
+    pipe_thread_t *th   = calloc(nth, sizeof(*th));
+    pthread_t     *tid  = calloc(nth, sizeof(*tid));
+    if (!ring || !th || !tid) {
+        printf("ERROR: out of memory\n");
+        exit(1);
+    }
+
+    ring_init(ring);
+    memset(res, 0, sizeof(*res));
+    memset(stats, 0, sizeof(*stats));
+
+    for (t = 0; t < nth; t++) {
+        th[t].ring      = ring;
+        th[t].proto     = proto;
+        th[t].load      = load;
+        th[t].load_arg  = load_arg;
+        th[t].labels    = labels;
+        th[t].n         = n;
+        th[t].next_load = &next_load;
+        th[t].next_take = &next_take;
+        th[t].res       = res;
+
+        if (pthread_create(&tid[t], NULL,
+                           (t < nloaders) ? loader_thread : compute_thread,
+                           &th[t]) != 0) {
+            printf("ERROR: pthread_create failed\n");
+            exit(1);
+        }
+    }
+
+    for (t = 0; t < nth; t++) {
+        pthread_join(tid[t], NULL);
+
+        res->errors         += th[t].errors;
+        stats->pushes       += th[t].st.pushes;
+        stats->full_stalls  += th[t].st.full_stalls;
+        stats->empty_stalls += th[t].st.empty_stalls;
+        stats->depth_sum    += th[t].st.depth_sum;
+        stats->load_s       += th[t].st.load_s;
+        stats->compute_s    += th[t].st.compute_s;
+        if (th[t].st.depth_max > stats->depth_max)
+            stats->depth_max = th[t].st.depth_max;
+    }
+    res->n = (n > 0) ? n : 0;
+
+    free(ring);
+    free(th);
+    free(tid);
+}
+
+#endif
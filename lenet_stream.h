@@ -0,0 +1,119 @@
+/**
+  ******************************************************************************
+  * @file    lenet_stream.h
+  * @brief   FIFO de short entre couches (stream_fixed.c) : hls::stream en
+  *          synthèse, file FIFO équivalente en C sous gcc
+  * @note    Header-only. En C-simulation les étapes d'une région DATAFLOW
+  *          s'exécutent l'une après l'autre : comme hls::stream (std::deque),
+  *          la file grandit autant que nécessaire et la profondeur déclarée
+  *          ne sert qu'à la synthèse.
+  ******************************************************************************
+  */
+
+#ifndef LENET_STREAM_H
+#define LENET_STREAM_H
+
+#include "lenet_cnn_fixed_point.h"     // LENET_PRAGMA
+
+
+#if defined(__SYNTHESIS__)
+
+/**************************************
+ *  SYNTHESE : hls::stream<short>
+ *  Les streams sont passés par référence, stream_fixed.c est donc
+ *  ajouté au projet HLS en C++ (add_files stream_fixed.c -cflags "-x c++").
+ **************************************/
+#ifndef __cplusplus
+#error "lenet_stream.h : hls::stream requires stream_fixed.c to be compiled as C++"
+#endif
+
+#include <hls_stream.h>
+
+typedef hls::stream<short> lenet_stream_t;
+
+#define LENET_STREAM_ARG(s)         lenet_stream_t &s
+#define LENET_STREAM_PASS(s)        s
+#define LENET_STREAM_DECL(s, d)     lenet_stream_t s; LENET_PRAGMA(HLS STREAM variable=s depth=d)
+#define LENET_STREAM_FREE(s)
+
+#define lenet_stream_write(s, v)    (s).write(v)
+#define lenet_stream_read(s)        (s).read()
+#define lenet_stream_empty(s)       (s).empty()
+
+#else
+
+/**************************************
+ *  C-SIMULATION : file circulaire qui double quand elle est pleine.
+ *  Lecture d'une file vide = interblocage en matériel : erreur fatale.
+ **************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    short       *buf;
+    unsigned int cap;           // puissance de 2
+    unsigned int head;          // prochain retrait
+    unsigned int count;
+    unsigned int depth;         // profondeur matérielle (information)
+    const char  *name;
+} lenet_stream_t;
+
+#define LENET_STREAM_ARG(s)         lenet_stream_t *s
+#define LENET_STREAM_PASS(s)        (&(s))
+#define LENET_STREAM_DECL(s, d)     lenet_stream_t s; lenet_stream_init(&(s), #s, d)
+#define LENET_STREAM_FREE(s)        free((s).buf)
+
+static inline void lenet_stream_init(lenet_stream_t *s, const char *name, unsigned int depth)
+{
+    s->buf   = NULL;
+    s->cap   = 0;
+    s->head  = 0;
+    s->count = 0;
+    s->depth = depth;
+    s->name  = name;
+}
+
+static inline void lenet_stream_write(lenet_stream_t *s, short v)
+{
+    if (s->count == s->cap) {
+        unsigned int cap = s->cap ? 2 * s->cap : 256;
+        short *buf = (short*)malloc(cap * sizeof(short));
+        unsigned int i;
+
+        if (!buf) {
+            printf("ERROR: stream %s : out of memory\n", s->name);
+            exit(1);
+        }
+        for (i = 0; i < s->count; i++)
+            buf[i] = s->buf[(s->head + i) & (s->cap - 1)];
+        free(s->buf);
+        s->buf  = buf;
+        s->cap  = cap;
+        s->head = 0;
+    }
+    s->buf[(s->head + s->count) & (s->cap - 1)] = v;
+    s->count++;
+}
+
+static inline short lenet_stream_read(lenet_stream_t *s)
+{
+    short v;
+
+    if (s->count == 0) {
+        printf("ERROR: stream %s : read while empty (deadlock in hardware)\n", s->name);
+        exit(1);
+    }
+    v = s->buf[s->head];
+    s->head = (s->head + 1) & (s->cap - 1);
+    s->count--;
+    return v;
+}
+
+static inline int lenet_stream_empty(const lenet_stream_t *s)
+{
+    return s->count == 0;
+}
+
+#endif
+
+#endif /* LENET_STREAM_H */
@@ -0,0 +1,195 @@
+/**
+  ******************************************************************************
+  * @file    lenet_trace.c
+  * @brief   Per-layer latency tracing : per-thread event buffers dumped as
+  *          trace-event JSON (chrome://tracing, Perfetto)
+  * @note    CPU only, compiled with -DLENET_TRACE
+  ******************************************************************************
+  */
+
+#if defined(LENET_TRACE) && !defined(__SYNTHESIS__)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "lenet_cnn_fixed_point.h"
+
+
+static const char *ev_name[LENET_EV_COUNT] = {
+    "load", "normalize",
+    "Conv1", "Pool1", "Conv1+Pool1",
+    "Conv2", "Pool2", "Conv2+Pool2",
+    "FC1", "FC2", "softmax"
+};
+
+
+/**************************************
+ *  BUFFERS PAR THREAD
+ *  Alloués au premier événement du thread et chaînés dans une liste
+ *  globale (seul point protégé par le mutex) ; l'enregistrement est
+ *  ensuite sans verrou. Les buffers survivent aux threads pour le dump.
+ **************************************/
+
+typedef struct {
+    unsigned long long t0, t1;
+    int                ev;
+} trace_event_t;
+
+typedef struct trace_buf_s {
+    struct trace_buf_s *next;
+    int                 tid;
+    char                name[32];
+    unsigned int        n;
+    unsigned int        dropped;
+    trace_event_t       ev[LENET_TRACE_MAX_EVENTS];
+} trace_buf_t;
+
+static int                 trace_on = 0;
+static unsigned long long  trace_t0;        // origine des timestamps
+static struct timespec     trace_ts0;       // même instant, horloge système
+static trace_buf_t        *trace_list = NULL;
+static int                 trace_ntid = 0;
+static pthread_mutex_t     trace_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread trace_buf_t *trace_self = NULL;
+
+
+void lenet_trace_start(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &trace_ts0);
+    trace_t0 = lenet_trace_now();
+    trace_on = 1;
+}
+
+
+static trace_buf_t *trace_buf(void)
+{
+    if (trace_self)
+        return trace_self;
+
+    trace_buf_t *b = malloc(sizeof(*b));
+    if (!b) {
+        printf("ERROR: out of memory (trace buffer)\n");
+        exit(1);
+    }
+    b->n = 0;
+    b->dropped = 0;
+
+    pthread_mutex_lock(&trace_lock);
+    b->tid = trace_ntid++;
+    snprintf(b->name, sizeof(b->name), "thread %d", b->tid);
+    b->next = trace_list;
+    trace_list = b;
+    pthread_mutex_unlock(&trace_lock);
+
+    trace_self = b;
+    return b;
+}
+
+
+void lenet_trace_thread(const char *name)
+{
+    if (!trace_on) return;
+
+    trace_buf_t *b = trace_buf();
+    snprintf(b->name, sizeof(b->name), "%s %d", name, b->tid);
+}
+
+
+void lenet_trace_record(lenet_trace_ev_t ev,
+                        unsigned long long t0, unsigned long long t1)
+{
+    if (!trace_on) return;
+
+    trace_buf_t *b = trace_buf();
+
+    if (b->n >= LENET_TRACE_MAX_EVENTS) {
+        b->dropped++;
+        return;
+    }
+    b->ev[b->n].t0 = t0;
+    b->ev[b->n].t1 = t1;
+    b->ev[b->n].ev = ev;
+    b->n++;
+}
+
+
+/**************************************
+ *  EXPORT JSON
+ *  Evénements complets ("ph":"X") en µs ; la fréquence du compteur est
+ *  mesurée entre lenet_trace_start() et le dump contre CLOCK_MONOTONIC.
+ *  A appeler une fois tous les threads terminés.
+ **************************************/
+
+int lenet_trace_dump(const char *filename)
+{
+    struct timespec ts1;
+    unsigned long long t1 = lenet_trace_now();
+    clock_gettime(CLOCK_MONOTONIC, &ts1);
+
+    double us = (ts1.tv_sec - trace_ts0.tv_sec) * 1e6 + (ts1.tv_nsec - trace_ts0.tv_nsec) * 1e-3;
+    double ticks_per_us = (us > 0.0) ? (double)(t1 - trace_t0) / us : 1.0;
+
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        printf("ERROR: Could not open trace file %s\n", filename);
+        return -1;
+    }
+
+    unsigned long long count[LENET_EV_COUNT] = {0};
+    unsigned long long ticks[LENET_EV_COUNT] = {0};
+    unsigned int dropped = 0;
+    int first = 1;
+    trace_buf_t *b;
+
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"ticks_per_us\":%.3f},\n", ticks_per_us);
+    fprintf(f, "\"traceEvents\":[\n");
+
+    for (b = trace_list; b; b = b->next) {
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                   "\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", b->tid, b->name);
+        first = 0;
+
+        for (unsigned int i = 0; i < b->n; i++) {
+            const trace_event_t *e = &b->ev[i];
+            unsigned long long d = e->t1 - e->t0;
+
+            fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"lenet\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                       "\"ts\":%.3f,\"dur\":%.3f}",
+                    ev_name[e->ev], b->tid,
+                    (double)(long long)(e->t0 - trace_t0) / ticks_per_us, d / ticks_per_us);
+
+            count[e->ev]++;
+            ticks[e->ev] += d;
+        }
+        dropped += b->dropped;
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+
+    printf("\nTrace: %s (%.0f ticks/us)\n", filename, ticks_per_us);
+    printf("  %-12s %10s %12s %12s\n", "event", "count", "mean (us)", "total (ms)");
+    for (int k = 0; k < LENET_EV_COUNT; k++) {
+        if (!count[k]) continue;
+        printf("  %-12s %10llu %12.2f %12.2f\n", ev_name[k], count[k],
+               ticks[k] / ticks_per_us / count[k], ticks[k] / ticks_per_us * 1e-3);
+    }
+    if (dropped)
+        printf("  %u events dropped (LENET_TRACE_MAX_EVENTS = %d per thread)\n",
+               dropped, LENET_TRACE_MAX_EVENTS);
+
+    while (trace_list) {
+        b = trace_list->next;
+        free(trace_list);
+        trace_list = b;
+    }
+    trace_self = NULL;
+    trace_ntid = 0;
+    trace_on = 0;
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,191 @@
+/**
+  ******************************************************************************
+  * @file    lowrank_fixed.c
+  * @brief   Low-rank factored FC1 (FC1_KERNEL ≈ L · R) : versioned file
+  *          (writer + read-only mmap loader) and two-stage kernel
+  * @note    CPU only. Le fichier est produit par lowrank_tool.c.
+  ******************************************************************************
+  */
+
+#ifndef __SYNTHESIS__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "lenet_cnn_fixed_point.h"
+
+
+static inline short relu_fixed(short x)
+{
+    return (x > 0) ? x : 0;
+}
+
+static unsigned int lowrank_align(unsigned int off)
+{
+    return (off + LENET_WEIGHTS_ALIGN - 1) & ~(LENET_WEIGHTS_ALIGN - 1);
+}
+
+
+/**************************************
+ *  FICHIER FC1 FACTORISE
+ *
+ *    lenet_lowrank_header_t
+ *    R  int16 [rank][cols]      aligné sur LENET_WEIGHTS_ALIGN
+ *    L  int16 [rows][rank]      aligné
+ **************************************/
+int lenet_lowrank_save(const char *filename, const lenet_lowrank_t *f)
+{
+    static const char pad[LENET_WEIGHTS_ALIGN];
+    lenet_lowrank_header_t h;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, LENET_LOWRANK_MAGIC, sizeof(h.magic));
+    h.version     = LENET_LOWRANK_VERSION;
+    h.endian      = 0x01020304;
+    h.fixed_point = FIXED_POINT;
+    h.rows        = f->rows;
+    h.cols        = f->cols;
+    h.rank        = f->rank;
+    h.r_off       = lowrank_align(sizeof(h));
+    h.l_off       = lowrank_align(h.r_off + f->rank * f->cols * sizeof(short));
+    h.file_size   = lowrank_align(h.l_off + f->rows * f->rank * sizeof(short));
+
+    FILE *fp = fopen(filename, "wb");
+    if (!fp) {
+        printf("ERROR: Cannot create %s\n", filename);
+        return -1;
+    }
+
+    long pos = (long)fwrite(&h, 1, sizeof(h), fp);
+    pos += (long)fwrite(pad, 1, h.r_off - pos, fp);
+    pos += (long)fwrite(f->r, 1, f->rank * f->cols * sizeof(short), fp);
+    pos += (long)fwrite(pad, 1, h.l_off - pos, fp);
+    pos += (long)fwrite(f->l, 1, f->rows * f->rank * sizeof(short), fp);
+    pos += (long)fwrite(pad, 1, h.file_size - pos, fp);
+
+    if (fclose(fp) != 0 || pos != (long)h.file_size) {
+        printf("ERROR: Write error on %s\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+
+int lenet_lowrank_map(const char *filename, int rows, int cols, lenet_lowrank_t *f)
+{
+    struct stat st;
+    const lenet_lowrank_header_t *h;
+    const unsigned char *base;
+
+    memset(f, 0, sizeof(*f));
+    f->fd = open(filename, O_RDONLY);
+    if (f->fd < 0) {
+        printf("ERROR: Cannot open %s\n", filename);
+        return -1;
+    }
+
+    if (fstat(f->fd, &st) != 0 || (size_t)st.st_size < sizeof(*h)) {
+        printf("ERROR: %s is not a low-rank FC1 file\n", filename);
+        lenet_lowrank_free(f);
+        return -1;
+    }
+
+    f->size = (size_t)st.st_size;
+    f->map  = mmap(NULL, f->size, PROT_READ, MAP_SHARED, f->fd, 0);
+    if (f->map == MAP_FAILED) {
+        f->map = NULL;
+        printf("ERROR: Cannot mmap %s\n", filename);
+        lenet_lowrank_free(f);
+        return -1;
+    }
+
+    base = (const unsigned char*)f->map;
+    h    = (const lenet_lowrank_header_t*)base;
+
+    if (memcmp(h->magic, LENET_LOWRANK_MAGIC, sizeof(h->magic)) != 0) {
+        printf("ERROR: %s is not a low-rank FC1 file\n", filename);
+        lenet_lowrank_free(f);
+        return -1;
+    }
+    /* rank <= rows : le noyau garde les r sorties intermédiaires dans un tableau [FC1_NBOUTPUT] */
+    if (h->version != LENET_LOWRANK_VERSION || h->endian != 0x01020304 ||
+        h->fixed_point != FIXED_POINT ||
+        h->rows != (unsigned int)rows || h->cols != (unsigned int)cols ||
+        h->rank < 1 || h->rank > h->rows || h->rank > h->cols ||
+        h->file_size > f->size ||
+        ((h->r_off | h->l_off) & (LENET_WEIGHTS_ALIGN - 1)) != 0 ||
+        /* en 64 bits : size_t fait 32 bits sur le Zynq PS */
+        h->r_off + (unsigned long long)h->rank * h->cols * sizeof(short) > h->file_size ||
+        h->l_off + (unsigned long long)h->rows * h->rank * sizeof(short) > h->file_size) {
+        printf("ERROR: %s : bad header or shape (%ux%u rank %u, expected %dx%d)\n",
+               filename, h->rows, h->cols, h->rank, rows, cols);
+        lenet_lowrank_free(f);
+        return -1;
+    }
+
+    f->rows = rows;
+    f->cols = cols;
+    f->rank = h->rank;
+    f->r    = (const short*)(base + h->r_off);
+    f->l    = (const short*)(base + h->l_off);
+    return 0;
+}
+
+
+void lenet_lowrank_free(lenet_lowrank_t *f)
+{
+    if (f->map)
+        munmap(f->map, f->size);
+    if (f->fd >= 0)
+        close(f->fd);
+    free(f->mem);
+
+    memset(f, 0, sizeof(*f));
+    f->fd = -1;
+}
+
+
+/**************************************
+ *  FC1 FACTORISE
+ *  Étage 1 : t = R · x          (rank sorties Q8, sans ReLU)
+ *  Étage 2 : y = ReLU(L · t + b)
+ *  rank * (FC1_NBINPUT + FC1_NBOUTPUT) MACs : ~3x moins que dense à r = 64.
+ **************************************/
+void Fc1_40_400_fixed_lowrank(
+        short input [POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        const lenet_lowrank_t *f,
+        short bias  [FC1_NBOUTPUT],
+        short output[FC1_NBOUTPUT])
+{
+    const short *in = &input[0][0][0];
+    const int rank = f->rank;
+    short t[FC1_NBOUTPUT];
+    int j, i, k;
+
+    for (j = 0; j < rank; j++) {
+        const short *r = f->r + j * FC1_NBINPUT;
+        int acc = 0;
+
+        for (i = 0; i < FC1_NBINPUT; i++)
+            acc += (int)r[i] * (int)in[i];
+
+        t[j] = (short)(acc >> FIXED_POINT);
+    }
+
+    for (k = 0; k < FC1_NBOUTPUT; k++) {
+        const short *l = f->l + k * rank;
+        int acc = ((int)bias[k]) << FIXED_POINT;
+
+        for (j = 0; j < rank; j++)
+            acc += (int)l[j] * (int)t[j];
+
+        output[k] = relu_fixed((short)(acc >> FIXED_POINT));
+    }
+}
+
+#endif
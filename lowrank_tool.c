@@ -0,0 +1,330 @@
+/**
+  ******************************************************************************
+  * @file    lowrank_tool.c
+  * @brief   Offline low-rank factorization of FC1 : truncated SVD of
+  *          FC1_KERNEL, Q8 re-quantization of both factors, rank chosen by
+  *          an accuracy budget on the MNIST test set
+  * @note    gcc -O2 -o lowrank_tool lowrank_tool.c lenet_ctx.c lowrank_fixed.c
+  *              codebook_fixed.c csr_fixed.c sparse_fixed.c packed_fixed.c
+  *              conv_fixed.c conv_simd.c conv_gemm.c conv_int8.c pool_fixed.c
+  *              pool_int8.c fc_fixed.c fc_int8.c quant_int8.c utils_fixed.c
+  *              mnist_idx.c tiled_fixed.c -lm -lpthread
+  *          ./lowrank_tool --budget 0.5 -o fc1_lowrank.bin
+  *          ./lenet --fc1-lowrank fc1_lowrank.bin
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "lenet_cnn_fixed_point.h"
+#include LENET_WEIGHTS_FILE
+
+
+#define ROWS  FC1_NBOUTPUT
+#define COLS  FC1_NBINPUT
+
+/*
+   W = FC1_KERNEL (ROWS x COLS, réels) = U S V^T.
+   Valeurs propres de G = W W^T (ROWS x ROWS) : S^2, vecteurs propres : U.
+   Facteurs équilibrés pour la quantification Q8 :
+       L = U_r sqrt(S_r)              [ROWS][r]
+       R = sqrt(S_r)^-1 U_r^T W       [r][COLS]   ( = sqrt(S_r) V_r^T )
+*/
+
+static double W[ROWS][COLS];
+static double G[ROWS][ROWS];
+static double U[ROWS][ROWS];        // vecteurs propres en colonnes
+static double sv[ROWS];             // valeurs singulières, décroissantes
+static double UW[ROWS][COLS];       // ligne j : u_j^T W
+
+
+/* Diagonalisation de Jacobi (cyclique) d'une matrice symétrique n x n.
+   a est détruite (valeurs propres sur la diagonale), v reçoit les vecteurs propres. */
+static void jacobi_eigen(double *a, double *v, int n)
+{
+    int p, q, k, sweep;
+
+    for (p = 0; p < n; p++)
+        for (q = 0; q < n; q++)
+            v[p * n + q] = (p == q);
+
+    for (sweep = 0; sweep < 50; sweep++) {
+        double off = 0.0, diag = 0.0;
+
+        for (p = 0; p < n; p++) {
+            diag += a[p * n + p] * a[p * n + p];
+            for (q = p + 1; q < n; q++)
+                off += a[p * n + q] * a[p * n + q];
+        }
+        if (off <= 1e-24 * diag)
+            break;
+
+        for (p = 0; p < n - 1; p++)
+            for (q = p + 1; q < n; q++) {
+                double apq = a[p * n + q];
+                if (fabs(apq) < 1e-300)
+                    continue;
+
+                double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * apq);
+                double t = ((theta >= 0) ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+                double c = 1.0 / sqrt(t * t + 1.0);
+                double s = t * c;
+
+                for (k = 0; k < n; k++) {           // colonnes p, q
+                    double akp = a[k * n + p], akq = a[k * n + q];
+                    a[k * n + p] = c * akp - s * akq;
+                    a[k * n + q] = s * akp + c * akq;
+                }
+                for (k = 0; k < n; k++) {           // lignes p, q
+                    double apk = a[p * n + k], aqk = a[q * n + k];
+                    a[p * n + k] = c * apk - s * aqk;
+                    a[q * n + k] = s * apk + c * aqk;
+                }
+                for (k = 0; k < n; k++) {
+                    double vkp = v[k * n + p], vkq = v[k * n + q];
+                    v[k * n + p] = c * vkp - s * vkq;
+                    v[k * n + q] = s * vkp + c * vkq;
+                }
+            }
+    }
+}
+
+static void factorize(void)
+{
+    static double a[ROWS][ROWS];
+    static double vec[ROWS][ROWS];
+    int order[ROWS];
+    int i, j, k;
+
+    for (k = 0; k < ROWS; k++) {
+        const short *w = &FC1_KERNEL[k][0][0][0];
+        for (i = 0; i < COLS; i++)
+            W[k][i] = (double)w[i] / (1 << FIXED_POINT);
+    }
+
+    for (k = 0; k < ROWS; k++)
+        for (j = k; j < ROWS; j++) {
+            double acc = 0.0;
+            for (i = 0; i < COLS; i++)
+                acc += W[k][i] * W[j][i];
+            G[k][j] = G[j][k] = acc;
+        }
+
+    memcpy(a, G, sizeof(a));
+    jacobi_eigen(&a[0][0], &vec[0][0], ROWS);
+
+    /* tri par valeur propre décroissante */
+    for (k = 0; k < ROWS; k++)
+        order[k] = k;
+    for (k = 1; k < ROWS; k++)
+        for (j = k; j > 0 && a[order[j]][order[j]] > a[order[j - 1]][order[j - 1]]; j--) {
+            int tmp = order[j]; order[j] = order[j - 1]; order[j - 1] = tmp;
+        }
+
+    for (j = 0; j < ROWS; j++) {
+        double lambda = a[order[j]][order[j]];
+        sv[j] = (lambda > 0.0) ? sqrt(lambda) : 0.0;
+        for (k = 0; k < ROWS; k++)
+            U[k][j] = vec[k][order[j]];
+    }
+
+    for (j = 0; j < ROWS; j++)
+        for (i = 0; i < COLS; i++) {
+            double acc = 0.0;
+            for (k = 0; k < ROWS; k++)
+                acc += U[k][j] * W[k][i];
+            UW[j][i] = acc;
+        }
+}
+
+
+static short to_q8(double x)
+{
+    long v = lround(x * (1 << FIXED_POINT));
+    return (short)(v > 32767 ? 32767 : v < -32768 ? -32768 : v);
+}
+
+/* Facteurs Q8 de rang r dans un bloc unique (libéré par lenet_lowrank_free) */
+static int quantize(int rank, lenet_lowrank_t *f)
+{
+    short *mem = malloc((size_t)rank * (COLS + ROWS) * sizeof(short));
+    short *r, *l;
+    int i, j, k;
+
+    if (!mem) {
+        printf("ERROR: out of memory\n");
+        return -1;
+    }
+    r = mem;
+    l = mem + rank * COLS;
+
+    for (j = 0; j < rank; j++) {
+        double s = sqrt(sv[j]);
+        for (i = 0; i < COLS; i++)
+            r[j * COLS + i] = (s > 0.0) ? to_q8(UW[j][i] / s) : 0;
+        for (k = 0; k < ROWS; k++)
+            l[k * rank + j] = to_q8(U[k][j] * s);
+    }
+
+    memset(f, 0, sizeof(*f));
+    f->fd   = -1;
+    f->rows = ROWS;
+    f->cols = COLS;
+    f->rank = rank;
+    f->r    = r;
+    f->l    = l;
+    f->mem  = mem;
+    return 0;
+}
+
+/* Erreur relative ||W - L R||_F / ||W||_F des facteurs quantifiés */
+static double rel_error(const lenet_lowrank_t *f)
+{
+    double err = 0.0, ref = 0.0;
+    int i, j, k;
+
+    for (k = 0; k < ROWS; k++)
+        for (i = 0; i < COLS; i++) {
+            double acc = 0.0;
+            for (j = 0; j < f->rank; j++)
+                acc += (double)f->l[k * f->rank + j] * f->r[j * COLS + i];
+            acc /= (double)(1 << FIXED_POINT) * (1 << FIXED_POINT);
+            err += (acc - W[k][i]) * (acc - W[k][i]);
+            ref += W[k][i] * W[k][i];
+        }
+    return sqrt(err / ref);
+}
+
+
+static double accuracy(const lenet_lowrank_t *f, lenet_idx_t *images, const unsigned char *labels,
+                       int n, int nthreads)
+{
+    lenet_weights_t w;
+    lenet_ctx_t proto;
+    lenet_eval_result_t res;
+
+    lenet_weights_init(&w);
+    w.conv1_k = CONV1_KERNEL;  w.conv1_b = CONV1_BIAS;
+    w.conv2_k = CONV2_KERNEL;  w.conv2_b = CONV2_BIAS;
+    w.fc1_k   = FC1_KERNEL;    w.fc1_b   = FC1_BIAS;
+    w.fc2_k   = FC2_KERNEL;    w.fc2_b   = FC2_BIAS;
+    w.fc1_lowrank = f;
+
+    lenet_ctx_init(&proto, &w);
+    proto.int_output = 1;
+    lenet_eval(&proto, lenet_load_idx, images, labels, n, nthreads, &res);
+
+    return 100.0 * (1.0 - (double)res.errors / res.n);
+}
+
+
+int main(int argc, char **argv)
+{
+    const char *images_file = "mnist/t10k-images-idx3-ubyte";
+    const char *labels_file = "mnist/t10k-labels-idx1-ubyte";
+    const char *out = "fc1_lowrank.bin";
+    double budget = 0.5;        // perte de précision tolérée (points)
+    int rank = 0;               // > 0 : rang imposé
+    int nthreads = 1;
+    int a;
+
+    for (a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "--budget") && a + 1 < argc) {
+            budget = atof(argv[++a]);
+        } else if (!strcmp(argv[a], "--rank") && a + 1 < argc) {
+            rank = atoi(argv[++a]);
+        } else if (!strcmp(argv[a], "--threads") && a + 1 < argc) {
+            nthreads = atoi(argv[++a]);
+        } else if (!strcmp(argv[a], "--images") && a + 1 < argc) {
+            images_file = argv[++a];
+        } else if (!strcmp(argv[a], "--labels") && a + 1 < argc) {
+            labels_file = argv[++a];
+        } else if (!strcmp(argv[a], "-o") && a + 1 < argc) {
+            out = argv[++a];
+        } else {
+            printf("usage: %s [--budget 0.5 | --rank r] [--threads N] [--images idx3] [--labels idx1] [-o fc1_lowrank.bin]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (rank < 0 || rank > ROWS || rank > COLS) {
+        printf("ERROR: --rank must be in [1, %d]\n", ROWS < COLS ? ROWS : COLS);
+        return -1;
+    }
+
+    lenet_idx_t label_idx, image_idx;
+
+    if (lenet_idx_open(&label_idx, labels_file) != 0 || lenet_idx_open(&image_idx, images_file) != 0)
+        return -1;
+    if (image_idx.rows != IMG_HEIGHT || image_idx.cols != IMG_WIDTH) {
+        printf("ERROR: %s : images %dx%d, expected %dx%d\n", images_file,
+               image_idx.rows, image_idx.cols, IMG_HEIGHT, IMG_WIDTH);
+        return -1;
+    }
+    int n = (image_idx.n < label_idx.n) ? image_idx.n : label_idx.n;
+
+    double acc_ref = accuracy(NULL, &image_idx, label_idx.data, n, nthreads);
+    printf("Dense FC1: %dx%d, %d MACs, %ld weight bytes, accuracy %.2f%% (%d images)\n",
+           ROWS, COLS, FC1_MACS, (long)FC1_MACS * (long)sizeof(short), acc_ref, n);
+
+    factorize();
+
+    double energy = 0.0, e;
+    int j;
+
+    for (j = 0; j < ROWS; j++)
+        energy += sv[j] * sv[j];
+
+    /* rang : imposé, ou le plus petit de la liste qui tient le budget */
+    static const int ranks[] = { 8, 16, 24, 32, 48, 64, 80, 96, 128, 160, 200 };
+    lenet_lowrank_t f;
+    double acc = 0.0;
+    int chosen = 0;
+    unsigned int c;
+
+    printf("\n%6s %8s %10s %10s %9s %9s\n", "rank", "energy", "rel.err", "MACs", "accuracy", "delta");
+    for (c = 0; c < (rank ? 1 : sizeof(ranks) / sizeof(ranks[0])); c++) {
+        int r = rank ? rank : ranks[c];
+
+        if (quantize(r, &f) != 0)
+            return -1;
+        acc = accuracy(&f, &image_idx, label_idx.data, n, nthreads);
+
+        for (e = 0.0, j = 0; j < r; j++)
+            e += sv[j] * sv[j];
+        printf("%6d %7.2f%% %10.4f %10d %8.2f%% %+9.2f\n",
+               r, 100.0 * e / energy, rel_error(&f), r * (ROWS + COLS), acc, acc - acc_ref);
+
+        if (rank || acc >= acc_ref - budget) {
+            chosen = r;
+            break;
+        }
+        lenet_lowrank_free(&f);
+    }
+
+    if (!chosen) {
+        printf("ERROR: no rank <= %d within %.2f points of the dense accuracy, keep the dense FC1\n",
+               ranks[sizeof(ranks) / sizeof(ranks[0]) - 1], budget);
+        return -1;
+    }
+
+    long dense_bytes = (long)FC1_MACS * sizeof(short);
+    long lr_bytes    = (long)chosen * (ROWS + COLS) * sizeof(short);
+
+    printf("\nRank %d%s:\n", chosen, rank ? "" : " (smallest within budget)");
+    printf("  MACs per image  : %d -> %d (%.2fx fewer)\n", FC1_MACS, chosen * (ROWS + COLS),
+           (double)FC1_MACS / (chosen * (ROWS + COLS)));
+    printf("  FC1 weight bytes: %ld -> %ld\n", dense_bytes, lr_bytes);
+    printf("  accuracy        : %.2f%% -> %.2f%% (delta %+.2f)\n", acc_ref, acc, acc - acc_ref);
+
+    if (lenet_lowrank_save(out, &f) != 0)
+        return -1;
+    printf("\nLow-rank FC1 written to %s (use ./lenet --fc1-lowrank %s)\n", out, out);
+
+    lenet_lowrank_free(&f);
+    lenet_idx_close(&image_idx);
+    lenet_idx_close(&label_idx);
+    return 0;
+}
@@ -0,0 +1,121 @@
+/**
+  ******************************************************************************
+  * @file    mnist_idx.c
+  * @brief   Memory-mapped MNIST IDX3 (images) / IDX1 (labels) reader
+  * @note    CPU only (POSIX mmap). Les images sont des vues directes dans
+  *          le fichier mappé : ni copie, ni appel libc par pixel.
+  ******************************************************************************
+  */
+
+#ifndef __SYNTHESIS__
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "lenet_cnn_fixed_point.h"
+
+
+/* entiers 32 bits big-endian de l'en-tête IDX */
+static unsigned int be32(const unsigned char *p)
+{
+    return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) |
+           ((unsigned int)p[2] << 8)  |  (unsigned int)p[3];
+}
+
+
+/*
+ *  Format IDX :
+ *    magic (0x00000801 labels, 0x00000803 images), nombre d'éléments,
+ *    [lignes, colonnes] pour les images, puis les données unsigned char.
+ */
+int lenet_idx_open(lenet_idx_t *idx, const char *filename)
+{
+    struct stat st;
+    const unsigned char *p;
+    size_t header, item;
+
+    memset(idx, 0, sizeof(*idx));
+    idx->fd = -1;
+
+    idx->fd = open(filename, O_RDONLY);
+    if (idx->fd < 0) {
+        printf("ERROR: Cannot open %s\n", filename);
+        return -1;
+    }
+
+    if (fstat(idx->fd, &st) != 0 || st.st_size < 8) {
+        printf("ERROR: %s is not an IDX file\n", filename);
+        lenet_idx_close(idx);
+        return -1;
+    }
+
+    idx->size = (size_t)st.st_size;
+    idx->map  = mmap(NULL, idx->size, PROT_READ, MAP_SHARED, idx->fd, 0);
+    if (idx->map == MAP_FAILED) {
+        idx->map = NULL;
+        printf("ERROR: Cannot mmap %s\n", filename);
+        lenet_idx_close(idx);
+        return -1;
+    }
+
+    p = (const unsigned char*)idx->map;
+
+    switch (be32(p)) {
+    case LENET_IDX1_MAGIC:
+        header = 8;
+        idx->rows = idx->cols = 1;
+        break;
+    case LENET_IDX3_MAGIC:
+        header = 16;
+        if (idx->size < header) goto bad;
+        idx->rows = (int)be32(p + 8);
+        idx->cols = (int)be32(p + 12);
+        break;
+    default:
+        goto bad;
+    }
+
+    idx->n    = (int)be32(p + 4);
+    idx->data = p + header;
+    item      = (size_t)idx->rows * idx->cols;
+
+    if (idx->n < 0 || (size_t)idx->n * item > idx->size - header)
+        goto bad;
+
+    /* lecture séquentielle : lecture anticipée agressive du noyau */
+    madvise(idx->map, idx->size, MADV_SEQUENTIAL);
+
+    return 0;
+
+bad:
+    printf("ERROR: %s : bad IDX header\n", filename);
+    lenet_idx_close(idx);
+    return -1;
+}
+
+
+void lenet_idx_close(lenet_idx_t *idx)
+{
+    if (idx->map)
+        munmap(idx->map, idx->size);
+    if (idx->fd >= 0)
+        close(idx->fd);
+
+    memset(idx, 0, sizeof(*idx));
+    idx->fd = -1;
+}
+
+
+/* Chargeur pour lenet_eval : vue directe, buf inutilisé */
+const unsigned char *lenet_load_idx(void *arg, int i, unsigned char *buf)
+{
+    const lenet_idx_t *idx = (const lenet_idx_t*)arg;
+    (void)buf;
+    return idx->data + (size_t)i * idx->rows * idx->cols;
+}
+
+#endif
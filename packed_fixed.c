@@ -0,0 +1,207 @@
+/**
+  ******************************************************************************
+  * @file    packed_fixed.c
+  * @brief   One-time weight repacking into blocked, padded, 64-byte aligned
+  *          layouts + the Conv / FC1 kernels that consume them
+  * @note    CPU only. Bit-exact avec conv_fixed.c / fc_fixed.c.
+  ******************************************************************************
+  */
+
+#ifndef __SYNTHESIS__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lenet_cnn_fixed_point.h"
+
+
+static inline short relu_fixed(short x)
+{
+    return (x > 0) ? x : 0;
+}
+
+static short *alloc_aligned(size_t count)
+{
+    void *p = NULL;
+    size_t bytes = (count * sizeof(short) + 63) & ~(size_t)63;
+
+    if (posix_memalign(&p, 64, bytes) != 0) {
+        printf("ERROR: out of memory\n");
+        exit(1);
+    }
+    memset(p, 0, bytes);
+    return (short*)p;
+}
+
+
+/**************************************
+ *  REEMPAQUETAGE (une fois au chargement)
+ **************************************
+ *
+ *  conv : [k / KB][z][ky][kx][KB]   KB = LENET_CONV_KB sorties voisines
+ *  FC1  : [k / KB][i][KB]           KB = LENET_FC1_KB, i = entrée aplatie
+ *
+ *  Pour un coefficient donné, les poids de KB sorties sont contigus : une
+ *  seule lecture vectorielle alimente KB accumulateurs, et FC1 se lit
+ *  comme un flux séquentiel (prefetch matériel efficace). Les sorties de
+ *  bourrage ont des poids nuls et ne sont jamais écrites.
+ */
+
+static void pack_conv(const short *kernel, int nk, int nz, int dim, short *dst)
+{
+    int nkb = (nk + LENET_CONV_KB - 1) / LENET_CONV_KB;
+    int taps = nz * dim * dim;
+    int kb, t, j;
+
+    for (kb = 0; kb < nkb; kb++)
+        for (t = 0; t < taps; t++)
+            for (j = 0; j < LENET_CONV_KB; j++) {
+                int k = kb * LENET_CONV_KB + j;
+                dst[(kb * taps + t) * LENET_CONV_KB + j] =
+                    (k < nk) ? kernel[k * taps + t] : 0;
+            }
+}
+
+void lenet_weights_pack(const lenet_weights_t *w, lenet_packed_t *p)
+{
+    int kb, i, j;
+
+    p->conv1_k = alloc_aligned((size_t)LENET_CONV1_KBLOCKS * LENET_CONV_KB *
+                               IMG_DEPTH * CONV1_DIM * CONV1_DIM);
+    p->conv2_k = alloc_aligned((size_t)LENET_CONV2_KBLOCKS * LENET_CONV_KB *
+                               POOL1_NBOUTPUT * CONV2_DIM * CONV2_DIM);
+    p->fc1_k   = NULL;
+
+    pack_conv(&w->conv1_k[0][0][0][0], CONV1_NBOUTPUT, IMG_DEPTH, CONV1_DIM, p->conv1_k);
+    pack_conv(&w->conv2_k[0][0][0][0], CONV2_NBOUTPUT, POOL1_NBOUTPUT, CONV2_DIM, p->conv2_k);
+
+    // --codebook : FC1 reste indexé, pas de noyau dense à réempaqueter
+    if (!w->fc1_k)
+        return;
+    p->fc1_k   = alloc_aligned((size_t)LENET_FC1_KBLOCKS * LENET_FC1_KB * FC1_NBINPUT);
+    for (kb = 0; kb < LENET_FC1_KBLOCKS; kb++)
+        for (i = 0; i < FC1_NBINPUT; i++)
+            for (j = 0; j < LENET_FC1_KB; j++) {
+                int k = kb * LENET_FC1_KB + j;
+                p->fc1_k[((size_t)kb * FC1_NBINPUT + i) * LENET_FC1_KB + j] =
+                    (k < FC1_NBOUTPUT) ? (&w->fc1_k[k][0][0][0])[i] : 0;
+            }
+}
+
+void lenet_packed_free(lenet_packed_t *p)
+{
+    free(p->conv1_k);
+    free(p->conv2_k);
+    free(p->fc1_k);
+    memset(p, 0, sizeof(*p));
+}
+
+
+/**************************************
+ *  CONVOLUTION SUR NOYAU EMPAQUETE
+ **************************************/
+
+static void conv_packed(const short *input, int nz, int ih, int iw, int dim,
+                        const short *pk, const short *bias, int nk,
+                        short *output, int oh, int ow)
+{
+    int nkb  = (nk + LENET_CONV_KB - 1) / LENET_CONV_KB;
+    int taps = nz * dim * dim;
+    int kb, y, x, z, ky, kx, j;
+
+    for (kb = 0; kb < nkb; kb++) {
+        const short *wb = pk + (size_t)kb * taps * LENET_CONV_KB;
+        int kn = nk - kb * LENET_CONV_KB;
+        if (kn > LENET_CONV_KB) kn = LENET_CONV_KB;
+
+        int b0[LENET_CONV_KB];
+        for (j = 0; j < LENET_CONV_KB; j++)
+            b0[j] = (j < kn) ? ((int)bias[kb * LENET_CONV_KB + j]) << FIXED_POINT : 0;
+
+        for (y = 0; y < oh; y++) {
+            for (x = 0; x < ow; x++) {
+
+                int acc[LENET_CONV_KB];
+                const short *w = wb;
+
+                for (j = 0; j < LENET_CONV_KB; j++)
+                    acc[j] = b0[j];
+
+                for (z = 0; z < nz; z++)
+                    for (ky = 0; ky < dim; ky++) {
+                        const short *in = input + (z * ih + y + ky) * iw + x;
+                        for (kx = 0; kx < dim; kx++, w += LENET_CONV_KB) {
+                            int v = in[kx];
+                            for (j = 0; j < LENET_CONV_KB; j++)
+                                acc[j] += v * w[j];
+                        }
+                    }
+
+                for (j = 0; j < kn; j++)
+                    output[((kb * LENET_CONV_KB + j) * oh + y) * ow + x] =
+                        relu_fixed((short)(acc[j] >> FIXED_POINT));
+            }
+        }
+    }
+}
+
+void Conv1_28x28x1_5x5x20_1_0_fixed_packed(
+        short input[IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        const lenet_packed_t *p,
+        short bias[CONV1_NBOUTPUT],
+        short output[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH])
+{
+    conv_packed(&input[0][0][0], IMG_DEPTH, IMG_HEIGHT, IMG_WIDTH, CONV1_DIM,
+                p->conv1_k, bias, CONV1_NBOUTPUT,
+                &output[0][0][0], CONV1_HEIGHT, CONV1_WIDTH);
+}
+
+void Conv2_12x12x20_5x5x40_1_0_fixed_packed(
+        short input[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH],
+        const lenet_packed_t *p,
+        short bias[CONV2_NBOUTPUT],
+        short output[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH])
+{
+    conv_packed(&input[0][0][0], POOL1_NBOUTPUT, POOL1_HEIGHT, POOL1_WIDTH, CONV2_DIM,
+                p->conv2_k, bias, CONV2_NBOUTPUT,
+                &output[0][0][0], CONV2_HEIGHT, CONV2_WIDTH);
+}
+
+
+/**************************************
+ *  FC1 SUR PANNEAUX EMPAQUETES
+ *  Lecture strictement séquentielle de p->fc1_k : LENET_FC1_KB sorties
+ *  accumulées ensemble pour chaque entrée.
+ **************************************/
+void Fc1_40_400_fixed_packed(
+        short input[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        const lenet_packed_t *p,
+        short bias[FC1_NBOUTPUT],
+        short output[FC1_NBOUTPUT])
+{
+    const short *in = &input[0][0][0];
+    const short *w  = p->fc1_k;
+    int kb, i, j;
+
+    for (kb = 0; kb < LENET_FC1_KBLOCKS; kb++) {
+
+        int acc[LENET_FC1_KB];
+        int kn = FC1_NBOUTPUT - kb * LENET_FC1_KB;
+        if (kn > LENET_FC1_KB) kn = LENET_FC1_KB;
+
+        for (j = 0; j < LENET_FC1_KB; j++)
+            acc[j] = (j < kn) ? ((int)bias[kb * LENET_FC1_KB + j]) << FIXED_POINT : 0;
+
+        for (i = 0; i < FC1_NBINPUT; i++, w += LENET_FC1_KB) {
+            int v = in[i];
+            for (j = 0; j < LENET_FC1_KB; j++)
+                acc[j] += v * w[j];
+        }
+
+        for (j = 0; j < kn; j++)
+            output[kb * LENET_FC1_KB + j] = relu_fixed((short)(acc[j] >> FIXED_POINT));
+    }
+}
+
+#endif
@@ -0,0 +1,52 @@
+/**
+  ******************************************************************************
+  * @file    pool_int8.c
+  * @brief   Max-pooling layers for LeNet (UINT8 activations)
+  * @note    Le max commute avec la quantification : aucune échelle ici
+  ******************************************************************************
+  */
+
+#include "lenet_cnn_fixed_point.h"
+
+
+static void pool2x2_u8(const unsigned char *input, int nz, int ih, int iw,
+                       unsigned char *output, int oh, int ow)
+{
+    int z, y, x;
+
+    for (z = 0; z < nz; z++) {
+        for (y = 0; y < oh; y++) {
+            for (x = 0; x < ow; x++) {
+
+                const unsigned char *in = input + (z * ih + 2 * y) * iw + 2 * x;
+
+                unsigned char max_val = in[0];
+                if (in[1]      > max_val) max_val = in[1];
+                if (in[iw]     > max_val) max_val = in[iw];
+                if (in[iw + 1] > max_val) max_val = in[iw + 1];
+
+                output[(z * oh + y) * ow + x] = max_val;
+            }
+        }
+    }
+}
+
+
+/* POOL1  (24×24×20  →  12×12×20) */
+void Pool1_24x24x20_2x2x20_2_0_int8(
+        unsigned char input [CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH],    // IN
+        unsigned char output[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH])    // OUT
+{
+    pool2x2_u8(&input[0][0][0], POOL1_NBOUTPUT, CONV1_HEIGHT, CONV1_WIDTH,
+               &output[0][0][0], POOL1_HEIGHT, POOL1_WIDTH);
+}
+
+
+/* POOL2  (8×8×40  →  4×4×40) */
+void Pool2_8x8x40_2x2x40_2_0_int8(
+        unsigned char input [CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH],    // IN
+        unsigned char output[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH])    // OUT
+{
+    pool2x2_u8(&input[0][0][0], POOL2_NBOUTPUT, CONV2_HEIGHT, CONV2_WIDTH,
+               &output[0][0][0], POOL2_HEIGHT, POOL2_WIDTH);
+}
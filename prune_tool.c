@@ -0,0 +1,208 @@
+/**
+  ******************************************************************************
+  * @file    prune_tool.c
+  * @brief   Offline magnitude pruning of FC1 : zeroes the smallest Q8
+  *          weights (threshold or target sparsity), re-measures accuracy on
+  *          the MNIST test set and writes the pruned FC1 in CSR format
+  * @note    gcc -O2 -o prune_tool prune_tool.c lenet_ctx.c csr_fixed.c
+  *              lowrank_fixed.c codebook_fixed.c sparse_fixed.c packed_fixed.c conv_fixed.c conv_simd.c
+  *              conv_gemm.c conv_int8.c pool_fixed.c pool_int8.c fc_fixed.c
+  *              fc_int8.c quant_int8.c tiled_fixed.c utils_fixed.c mnist_idx.c
+  *              -lm -lpthread
+  *          ./prune_tool --sparsity 0.9 -o fc1_csr.bin
+  *          ./lenet --fc1-csr fc1_csr.bin
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lenet_cnn_fixed_point.h"
+#include LENET_WEIGHTS_FILE
+
+
+#define FC1_NBWEIGHTS ( FC1_NBOUTPUT * FC1_NBINPUT )
+
+static int cmp_short(const void *a, const void *b)
+{
+    return *(const short*)a - *(const short*)b;
+}
+
+
+/* Seuil |w| <= t tel qu'au moins une part `sparsity` des poids soit nulle */
+static short prune_threshold(const short *w, int n, double sparsity)
+{
+    short *mag = malloc(n * sizeof(short));
+    short t;
+    int i, k;
+
+    if (!mag) {
+        printf("ERROR: out of memory\n");
+        exit(1);
+    }
+    for (i = 0; i < n; i++)
+        mag[i] = (short)(w[i] < 0 ? -w[i] : w[i]);
+    qsort(mag, n, sizeof(short), cmp_short);
+
+    k = (int)(sparsity * n + 0.5);
+    t = (k > 0) ? mag[(k < n ? k : n) - 1] : -1;
+
+    free(mag);
+    return t;
+}
+
+/* Copie de src dans dst avec les poids |w| <= t mis à zéro, renvoie le nombre de zéros */
+static int prune(const short *src, short *dst, int n, short t)
+{
+    int i, zeros = 0;
+
+    for (i = 0; i < n; i++) {
+        int m = (src[i] < 0) ? -src[i] : src[i];
+        dst[i] = (m <= t) ? 0 : src[i];
+        zeros += (dst[i] == 0);
+    }
+    return zeros;
+}
+
+
+static double accuracy(const lenet_weights_t *w, lenet_idx_t *images, const unsigned char *labels,
+                       int n, int nthreads)
+{
+    lenet_ctx_t proto;
+    lenet_eval_result_t res;
+
+    lenet_ctx_init(&proto, w);
+    proto.int_output = 1;
+    lenet_eval(&proto, lenet_load_idx, images, labels, n, nthreads, &res);
+
+    return 100.0 * (1.0 - (double)res.errors / res.n);
+}
+
+
+int main(int argc, char **argv)
+{
+    const char *images_file = "mnist/t10k-images-idx3-ubyte";
+    const char *labels_file = "mnist/t10k-labels-idx1-ubyte";
+    const char *out = "fc1_csr.bin";
+    double sparsity = 0.9;
+    int threshold = -1;         // >= 0 : seuil Q8 explicite
+    int sweep = 0;
+    int nthreads = 1;
+    int a;
+
+    for (a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "--sparsity") && a + 1 < argc) {
+            sparsity = atof(argv[++a]);
+        } else if (!strcmp(argv[a], "--threshold") && a + 1 < argc) {
+            threshold = atoi(argv[++a]);
+        } else if (!strcmp(argv[a], "--sweep")) {
+            sweep = 1;
+        } else if (!strcmp(argv[a], "--threads") && a + 1 < argc) {
+            nthreads = atoi(argv[++a]);
+        } else if (!strcmp(argv[a], "--images") && a + 1 < argc) {
+            images_file = argv[++a];
+        } else if (!strcmp(argv[a], "--labels") && a + 1 < argc) {
+            labels_file = argv[++a];
+        } else if (!strcmp(argv[a], "-o") && a + 1 < argc) {
+            out = argv[++a];
+        } else {
+            printf("usage: %s [--sparsity 0.9 | --threshold T] [--sweep] [--threads N] [--images idx3] [--labels idx1] [-o fc1_csr.bin]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (sparsity < 0.0 || sparsity > 1.0) {
+        printf("ERROR: sparsity must be in [0, 1]\n");
+        return -1;
+    }
+
+    lenet_idx_t label_idx, image_idx;
+
+    if (lenet_idx_open(&label_idx, labels_file) != 0 || lenet_idx_open(&image_idx, images_file) != 0)
+        return -1;
+    if (image_idx.rows != IMG_HEIGHT || image_idx.cols != IMG_WIDTH) {
+        printf("ERROR: %s : images %dx%d, expected %dx%d\n", images_file,
+               image_idx.rows, image_idx.cols, IMG_HEIGHT, IMG_WIDTH);
+        return -1;
+    }
+    int n = (image_idx.n < label_idx.n) ? image_idx.n : label_idx.n;
+
+    /* FC1 élagué dans une copie ; les autres couches restent celles de Weights.h */
+    short (*fc1_pruned)[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH] = malloc(sizeof(FC1_KERNEL));
+    if (!fc1_pruned) {
+        printf("ERROR: out of memory\n");
+        return -1;
+    }
+    const short *fc1 = &FC1_KERNEL[0][0][0][0];
+    short *dst = &fc1_pruned[0][0][0][0];
+
+    lenet_weights_t w;
+    lenet_weights_init(&w);
+    w.conv1_k = CONV1_KERNEL;  w.conv1_b = CONV1_BIAS;
+    w.conv2_k = CONV2_KERNEL;  w.conv2_b = CONV2_BIAS;
+    w.fc1_k   = FC1_KERNEL;    w.fc1_b   = FC1_BIAS;
+    w.fc2_k   = FC2_KERNEL;    w.fc2_b   = FC2_BIAS;
+
+    double acc_ref = accuracy(&w, &image_idx, label_idx.data, n, nthreads);
+    int zeros_ref = prune(fc1, dst, FC1_NBWEIGHTS, -1);
+
+    printf("FC1: %d weights, %d already zero in Q8 (%.1f%%)\n",
+           FC1_NBWEIGHTS, zeros_ref, 100.0 * zeros_ref / FC1_NBWEIGHTS);
+    printf("Reference accuracy: %.2f%% (%d images)\n\n", acc_ref, n);
+
+    w.fc1_k = fc1_pruned;
+
+    if (sweep) {
+        static const double s[] = { 0.5, 0.6, 0.7, 0.8, 0.85, 0.9, 0.95, 0.97, 0.99 };
+        unsigned int i;
+
+        printf("%9s %9s %9s %9s %10s\n", "target", "threshold", "sparsity", "accuracy", "delta");
+        for (i = 0; i < sizeof(s) / sizeof(s[0]); i++) {
+            short t = prune_threshold(fc1, FC1_NBWEIGHTS, s[i]);
+            int z = prune(fc1, dst, FC1_NBWEIGHTS, t);
+            double acc = accuracy(&w, &image_idx, label_idx.data, n, nthreads);
+            printf("%8.0f%% %9d %8.1f%% %8.2f%% %+9.2f\n",
+                   100.0 * s[i], t, 100.0 * z / FC1_NBWEIGHTS, acc, acc - acc_ref);
+        }
+        printf("\n");
+    }
+
+    /* élagage retenu */
+    short t = (threshold >= 0) ? (short)threshold : prune_threshold(fc1, FC1_NBWEIGHTS, sparsity);
+    int zeros = prune(fc1, dst, FC1_NBWEIGHTS, t);
+    double acc_dense = accuracy(&w, &image_idx, label_idx.data, n, nthreads);
+
+    lenet_csr_t csr;
+    if (lenet_csr_from_dense(dst, FC1_NBOUTPUT, FC1_NBINPUT, &csr) != 0)
+        return -1;
+
+    /* même réseau, FC1 par le noyau CSR : doit donner exactement la même précision */
+    w.fc1_csr = &csr;
+    double acc_csr = accuracy(&w, &image_idx, label_idx.data, n, nthreads);
+
+    long dense_bytes = (long)FC1_NBWEIGHTS * sizeof(short);
+    long csr_bytes   = (long)(FC1_NBOUTPUT + 1) * sizeof(unsigned int)
+                     + (long)csr.nnz * (sizeof(unsigned short) + sizeof(short));
+
+    printf("Pruned FC1: |w| <= %d (Q8) -> 0\n", t);
+    printf("  sparsity        : %.1f%% (%d / %d zero)\n", 100.0 * zeros / FC1_NBWEIGHTS, zeros, FC1_NBWEIGHTS);
+    printf("  MACs per image  : %d -> %d\n", FC1_MACS, csr.nnz);
+    printf("  FC1 weight bytes: %ld -> %ld (CSR, %.1f%%)\n", dense_bytes, csr_bytes, 100.0 * csr_bytes / dense_bytes);
+    printf("  accuracy        : %.2f%% -> %.2f%% (delta %+.2f), CSR kernel %.2f%%\n",
+           acc_ref, acc_dense, acc_dense - acc_ref, acc_csr);
+
+    if (acc_csr != acc_dense) {
+        printf("ERROR: CSR kernel does not match the pruned dense FC1\n");
+        return -1;
+    }
+
+    if (lenet_csr_save(out, &csr) != 0)
+        return -1;
+    printf("\nCSR FC1 written to %s (use ./lenet --fc1-csr %s)\n", out, out);
+
+    lenet_csr_free(&csr);
+    free(fc1_pruned);
+    lenet_idx_close(&image_idx);
+    lenet_idx_close(&label_idx);
+    return 0;
+}
@@ -0,0 +1,220 @@
+/**
+  ******************************************************************************
+  * @file    quant_int8.c
+  * @brief   INT8 LeNet : forward pass, calibration and quantization of the
+  *          Q8 weights (per-output-channel weight scales)
+  * @note    lenet_int8_forward est synthétisable ; calibration CPU only
+  ******************************************************************************
+  */
+
+#include "lenet_cnn_fixed_point.h"
+
+
+/**************************************
+ *  FORWARD INT8
+ **************************************/
+void lenet_int8_forward(lenet_int8_model_t *m,
+                        short input [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+                        short logits[FC2_NBOUTPUT])
+{
+    unsigned char in_u8    [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH];
+    unsigned char conv1_out[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH];
+    unsigned char pool1_out[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH];
+    unsigned char conv2_out[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH];
+    unsigned char pool2_out[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH];
+    unsigned char fc1_out  [FC1_NBOUTPUT];
+
+    unsigned short z, y, x;
+
+    /* entrée Q8 → pixel uint8. NormalizeImg_fixed donne q = floor(p * 2^Q / 255) :
+       p = ceil(q * 255 / 2^Q), inverse exact tant que FIXED_POINT >= 8 */
+    for (z = 0; z < IMG_DEPTH; z++)
+        for (y = 0; y < IMG_HEIGHT; y++)
+            for (x = 0; x < IMG_WIDTH; x++) {
+                int v = ((int)input[z][y][x] * 255 + (1 << FIXED_POINT) - 1) >> FIXED_POINT;
+                in_u8[z][y][x] = (unsigned char)((v < 0) ? 0 : (v > 255) ? 255 : v);
+            }
+
+    LENET_TRACE_BEGIN(CONV1);
+    Conv1_28x28x1_5x5x20_1_0_int8(in_u8, m->conv1_k, m->conv1_b, m->conv1_m, conv1_out);
+    LENET_TRACE_END(CONV1);
+
+    LENET_TRACE_BEGIN(POOL1);
+    Pool1_24x24x20_2x2x20_2_0_int8(conv1_out, pool1_out);
+    LENET_TRACE_END(POOL1);
+
+    LENET_TRACE_BEGIN(CONV2);
+    Conv2_12x12x20_5x5x40_1_0_int8(pool1_out, m->conv2_k, m->conv2_b, m->conv2_m, conv2_out);
+    LENET_TRACE_END(CONV2);
+
+    LENET_TRACE_BEGIN(POOL2);
+    Pool2_8x8x40_2x2x40_2_0_int8(conv2_out, pool2_out);
+    LENET_TRACE_END(POOL2);
+
+    LENET_TRACE_BEGIN(FC1);
+    Fc1_40_400_int8(pool2_out, m->fc1_k, m->fc1_b, m->fc1_m, fc1_out);
+    LENET_TRACE_END(FC1);
+
+    LENET_TRACE_BEGIN(FC2);
+    Fc2_400_10_int8(fc1_out, m->fc2_k, m->fc2_b, m->fc2_m, logits);
+    LENET_TRACE_END(FC2);
+}
+
+
+#ifndef __SYNTHESIS__
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+
+/**************************************
+ *  CALIBRATION
+ *  Passe Q8 de référence sur un échantillon d'images : max de chaque
+ *  activation quantifiée (sorties ReLU de conv1, conv2, fc1).
+ **************************************/
+
+void lenet_int8_calib_init(lenet_int8_calib_t *c)
+{
+    memset(c, 0, sizeof(*c));
+}
+
+static short max_of(const short *v, int n, short cur)
+{
+    int i;
+    for (i = 0; i < n; i++)
+        if (v[i] > cur) cur = v[i];
+    return cur;
+}
+
+void lenet_int8_calib_observe(lenet_int8_calib_t *c, const lenet_weights_t *w,
+                              short input[IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH])
+{
+    short conv1_out[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH];
+    short pool1_out[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH];
+    short conv2_out[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH];
+    short pool2_out[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH];
+    short fc1_out[FC1_NBOUTPUT];
+
+    Conv1_28x28x1_5x5x20_1_0_fixed(input, w->conv1_k, w->conv1_b, conv1_out);
+    Pool1_24x24x20_2x2x20_2_0_fixed(conv1_out, pool1_out);
+    Conv2_12x12x20_5x5x40_1_0_fixed(pool1_out, w->conv2_k, w->conv2_b, conv2_out);
+    Pool2_8x8x40_2x2x40_2_0_fixed(conv2_out, pool2_out);
+    Fc1_40_400_fixed(pool2_out, w->fc1_k, w->fc1_b, fc1_out);
+
+    c->conv1_max = max_of(&conv1_out[0][0][0], sizeof(conv1_out) / sizeof(short), c->conv1_max);
+    c->conv2_max = max_of(&conv2_out[0][0][0], sizeof(conv2_out) / sizeof(short), c->conv2_max);
+    c->fc1_max   = max_of(fc1_out, FC1_NBOUTPUT, c->fc1_max);
+    c->nb_images++;
+}
+
+
+/**************************************
+ *  QUANTIFICATION
+ **************************************/
+
+/* m > 0  →  m ~= mult * 2^-shift, mult dans [2^30, 2^31) */
+static lenet_q_mult_t make_mult(double m)
+{
+    lenet_q_mult_t q;
+    int e;
+    double f = frexp(m, &e);                        // m = f * 2^e, f dans [0.5, 1)
+    long long m0 = llround(f * 2147483648.0);       // f * 2^31
+
+    if (m0 == 2147483648LL) {
+        m0 /= 2;
+        e++;
+    }
+    q.mult  = (int)m0;
+    q.shift = 31 - e;
+    return q;
+}
+
+static double act_scale(short max)
+{
+    return (max > 0) ? (double)max / 255.0 : 1.0;
+}
+
+/*
+ *  Une couche : n_out canaux de n_in poids Q8 (short).
+ *    s_w[k]  = max|w[k]| / 127
+ *    w_i8    = round(w / s_w[k])
+ *    bias_q  = round(b * 2^Q / (s_in * s_w[k]))      (domaine de acc)
+ *    mult[k] = s_in * s_w[k] / (2^Q * s_out)         (s_out = 1 : sortie Q8)
+ */
+static void quantize_layer(const short *w, const short *b, int n_out, int n_in,
+                           double s_in, double s_out,
+                           signed char *wq, int *bq, lenet_q_mult_t *mult)
+{
+    int k, i;
+
+    for (k = 0; k < n_out; k++) {
+
+        const short *wk = w + (size_t)k * n_in;
+        int maxabs = 0;
+
+        for (i = 0; i < n_in; i++) {
+            int a = (wk[i] < 0) ? -wk[i] : wk[i];
+            if (a > maxabs) maxabs = a;
+        }
+
+        double s_w = (maxabs > 0) ? maxabs / 127.0 : 1.0;
+
+        for (i = 0; i < n_in; i++) {
+            long v = lround(wk[i] / s_w);
+            wq[(size_t)k * n_in + i] = (signed char)((v < -127) ? -127 : (v > 127) ? 127 : v);
+        }
+
+        bq[k]   = (int)lround(b[k] * (double)(1 << FIXED_POINT) / (s_in * s_w));
+        mult[k] = make_mult(s_in * s_w / ((double)(1 << FIXED_POINT) * s_out));
+    }
+}
+
+void lenet_int8_quantize(const lenet_weights_t *w, const lenet_int8_calib_t *c,
+                         lenet_int8_model_t *m)
+{
+    m->in_scale    = 256.0f / 255.0f;
+    m->conv1_scale = (float)act_scale(c->conv1_max);
+    m->conv2_scale = (float)act_scale(c->conv2_max);
+    m->fc1_scale   = (float)act_scale(c->fc1_max);
+
+    quantize_layer(&w->conv1_k[0][0][0][0], w->conv1_b,
+                   CONV1_NBOUTPUT, IMG_DEPTH * CONV1_DIM * CONV1_DIM,
+                   m->in_scale, m->conv1_scale,
+                   &m->conv1_k[0][0][0][0], m->conv1_b, m->conv1_m);
+
+    quantize_layer(&w->conv2_k[0][0][0][0], w->conv2_b,
+                   CONV2_NBOUTPUT, POOL1_NBOUTPUT * CONV2_DIM * CONV2_DIM,
+                   m->conv1_scale, m->conv2_scale,
+                   &m->conv2_k[0][0][0][0], m->conv2_b, m->conv2_m);
+
+    quantize_layer(&w->fc1_k[0][0][0][0], w->fc1_b,
+                   FC1_NBOUTPUT, FC1_NBINPUT,
+                   m->conv2_scale, m->fc1_scale,
+                   &m->fc1_k[0][0][0][0], m->fc1_b, m->fc1_m);
+
+    quantize_layer(&w->fc2_k[0][0], w->fc2_b,
+                   FC2_NBOUTPUT, FC1_NBOUTPUT,
+                   m->fc1_scale, 1.0,
+                   &m->fc2_k[0][0], m->fc2_b, m->fc2_m);
+}
+
+
+void lenet_int8_report(const lenet_int8_model_t *m, const lenet_int8_calib_t *c)
+{
+    size_t q8   = sizeof(short) * ((size_t)CONV1_NBOUTPUT * IMG_DEPTH * CONV1_DIM * CONV1_DIM +
+                                   (size_t)CONV2_NBOUTPUT * POOL1_NBOUTPUT * CONV2_DIM * CONV2_DIM +
+                                   (size_t)FC1_NBOUTPUT * FC1_NBINPUT +
+                                   (size_t)FC2_NBOUTPUT * FC1_NBOUTPUT);
+    size_t i8   = sizeof(m->conv1_k) + sizeof(m->conv2_k) + sizeof(m->fc1_k) + sizeof(m->fc2_k);
+
+    printf("\nINT8 calibration (%d images)\n", c->nb_images);
+    printf("  activation max (Q8) : conv1 %d  conv2 %d  fc1 %d\n",
+           c->conv1_max, c->conv2_max, c->fc1_max);
+    printf("  activation scales   : in %.4f  conv1 %.4f  conv2 %.4f  fc1 %.4f\n",
+           m->in_scale, m->conv1_scale, m->conv2_scale, m->fc1_scale);
+    printf("  weights             : %zu KB (Q8/int16) -> %zu KB (int8), FC1 %zu KB\n",
+           q8 / 1024, i8 / 1024, sizeof(m->fc1_k) / 1024);
+}
+
+#endif
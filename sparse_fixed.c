@@ -0,0 +1,261 @@
+/**
+  ******************************************************************************
+  * @file    sparse_fixed.c
+  * @brief   Activation-sparsity kernels : post-ReLU activations compressed
+  *          into nonzero lists, only the matching weights are accumulated
+  * @note    CPU only ; bit-exact with conv_fixed.c / fc_fixed.c (the
+  *          skipped products are all 0)
+  ******************************************************************************
+  */
+
+#ifndef __SYNTHESIS__
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lenet_cnn_fixed_point.h"
+
+
+static inline short relu_fixed(short x)
+{
+    return (x > 0) ? x : 0;
+}
+
+
+/**************************************
+ *  COMPRESSION
+ *  Liste (indice, valeur) des activations non nulles, dans l'ordre.
+ *  Sans branchement : chaque case est écrite, n n'avance que si la
+ *  valeur est non nulle (motif zéro / non nul imprévisible).
+ **************************************/
+int lenet_compress_nz(const short *in, int len, unsigned short *idx, short *val)
+{
+    int i, n = 0;
+
+    for (i = 0; i < len; i++) {
+        idx[n] = (unsigned short)i;
+        val[n] = in[i];
+        n += (in[i] != 0);
+    }
+    return n;
+}
+
+
+/**************************************
+ *  CONV2 PAR DIFFUSION
+ *  Pour chaque canal d'entrée, seules ses positions non nulles sont
+ *  parcourues : chacune ajoute v * noyau à toutes les sorties dont la
+ *  fenêtre 5x5 la contient. Un canal entièrement nul ne coûte rien.
+ **************************************/
+void Conv2_12x12x20_5x5x40_1_0_fixed_sparse(
+        short input [POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH],
+        short kernel[CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short bias  [CONV2_NBOUTPUT],
+        short output[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH])
+{
+    unsigned short idx[POOL1_NBOUTPUT][POOL1_HEIGHT * POOL1_WIDTH];
+    short          val[POOL1_NBOUTPUT][POOL1_HEIGHT * POOL1_WIDTH];
+    int            nnz[POOL1_NBOUTPUT];
+    int            acc[CONV2_HEIGHT][CONV2_WIDTH];
+    int k, z, j, ky, kx, y, x;
+
+    for (z = 0; z < POOL1_NBOUTPUT; z++)
+        nnz[z] = lenet_compress_nz(&input[z][0][0], POOL1_HEIGHT * POOL1_WIDTH, idx[z], val[z]);
+
+    for (k = 0; k < CONV2_NBOUTPUT; k++) {
+
+        int b = ((int)bias[k]) << FIXED_POINT;
+        for (y = 0; y < CONV2_HEIGHT; y++)
+            for (x = 0; x < CONV2_WIDTH; x++)
+                acc[y][x] = b;
+
+        for (z = 0; z < POOL1_NBOUTPUT; z++) {
+            short (*w)[CONV2_DIM] = kernel[k][z];
+
+            for (j = 0; j < nnz[z]; j++) {
+                int iy = idx[z][j] / POOL1_WIDTH;
+                int ix = idx[z][j] % POOL1_WIDTH;
+                int v  = val[z][j];
+
+                /* sorties (iy - ky, ix - kx) dans [0, CONV2_HEIGHT) x [0, CONV2_WIDTH) */
+                int ky0 = (iy - (CONV2_HEIGHT - 1) > 0) ? iy - (CONV2_HEIGHT - 1) : 0;
+                int ky1 = (iy < CONV2_DIM - 1) ? iy : CONV2_DIM - 1;
+                int kx0 = (ix - (CONV2_WIDTH - 1) > 0) ? ix - (CONV2_WIDTH - 1) : 0;
+                int kx1 = (ix < CONV2_DIM - 1) ? ix : CONV2_DIM - 1;
+
+                for (ky = ky0; ky <= ky1; ky++)
+                    for (kx = kx0; kx <= kx1; kx++)
+                        acc[iy - ky][ix - kx] += v * (int)w[ky][kx];
+            }
+        }
+
+        for (y = 0; y < CONV2_HEIGHT; y++)
+            for (x = 0; x < CONV2_WIDTH; x++)
+                output[k][y][x] = relu_fixed((short)(acc[y][x] >> FIXED_POINT));
+    }
+}
+
+
+/**************************************
+ *  FC1 / FC2 SUR LISTE DE NON NULS
+ *  Chaque sortie ne lit que les colonnes du noyau touchées par une
+ *  entrée non nulle.
+ **************************************/
+void Fc1_40_400_fixed_sparse(
+        short input [POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short kernel[FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short bias  [FC1_NBOUTPUT],
+        short output[FC1_NBOUTPUT])
+{
+    unsigned short idx[FC1_NBINPUT];
+    short          val[FC1_NBINPUT];
+    int n = lenet_compress_nz(&input[0][0][0], FC1_NBINPUT, idx, val);
+    int k, j;
+
+    for (k = 0; k < FC1_NBOUTPUT; k++) {
+        const short *w = &kernel[k][0][0][0];
+        int acc = ((int)bias[k]) << FIXED_POINT;
+
+        for (j = 0; j < n; j++)
+            acc += (int)val[j] * (int)w[idx[j]];
+
+        output[k] = relu_fixed((short)(acc >> FIXED_POINT));
+    }
+}
+
+
+/* Panneaux [k/16][i][16] : une entrée nulle saute une ligne entière de
+ * 32 octets, le trafic de poids baisse avec la densité. */
+void Fc1_40_400_fixed_packed_sparse(
+        short input[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        const lenet_packed_t *p,
+        short bias [FC1_NBOUTPUT],
+        short output[FC1_NBOUTPUT])
+{
+    unsigned short idx[FC1_NBINPUT];
+    short          val[FC1_NBINPUT];
+    int n = lenet_compress_nz(&input[0][0][0], FC1_NBINPUT, idx, val);
+    int kb, i, j;
+
+    for (kb = 0; kb < LENET_FC1_KBLOCKS; kb++) {
+
+        const short *wb = p->fc1_k + (size_t)kb * FC1_NBINPUT * LENET_FC1_KB;
+        int acc[LENET_FC1_KB];
+        int kn = FC1_NBOUTPUT - kb * LENET_FC1_KB;
+        if (kn > LENET_FC1_KB) kn = LENET_FC1_KB;
+
+        for (j = 0; j < LENET_FC1_KB; j++)
+            acc[j] = (j < kn) ? ((int)bias[kb * LENET_FC1_KB + j]) << FIXED_POINT : 0;
+
+        for (i = 0; i < n; i++) {
+            const short *w = wb + (size_t)idx[i] * LENET_FC1_KB;
+            int v = val[i];
+            for (j = 0; j < LENET_FC1_KB; j++)
+                acc[j] += v * w[j];
+        }
+
+        for (j = 0; j < kn; j++)
+            output[kb * LENET_FC1_KB + j] = relu_fixed((short)(acc[j] >> FIXED_POINT));
+    }
+}
+
+
+void Fc2_400_10_fixed_sparse(
+        short input [FC1_NBOUTPUT],
+        short kernel[FC2_NBOUTPUT][FC1_NBOUTPUT],
+        short bias  [FC2_NBOUTPUT],
+        short output[FC2_NBOUTPUT])
+{
+    unsigned short idx[FC1_NBOUTPUT];
+    short          val[FC1_NBOUTPUT];
+    int n = lenet_compress_nz(input, FC1_NBOUTPUT, idx, val);
+    int k, j;
+
+    for (k = 0; k < FC2_NBOUTPUT; k++) {
+        int acc = ((int)bias[k]) << FIXED_POINT;
+
+        for (j = 0; j < n; j++)
+            acc += (int)val[j] * (int)kernel[k][idx[j]];
+
+        output[k] = (short)(acc >> FIXED_POINT);   // logits, pas de ReLU
+    }
+}
+
+
+/**************************************
+ *  MESURE DE LA DENSITE
+ *  Passe de référence (couches denses) sur n images : part des
+ *  activations nulles en entrée de Conv2, FC1 et FC2, et part des MACs
+ *  que les noyaux ci-dessus évitent.
+ **************************************/
+void lenet_sparsity_profile(const lenet_weights_t *w, lenet_load_fn load, void *load_arg,
+                            int n, lenet_sparsity_t *s)
+{
+    unsigned char buf[IMG_WIDTH * IMG_HEIGHT];
+    short input    [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH];
+    short conv1_out[CONV1_NBOUTPUT][CONV1_HEIGHT][CONV1_WIDTH];
+    short pool1_out[POOL1_NBOUTPUT][POOL1_HEIGHT][POOL1_WIDTH];
+    short conv2_out[CONV2_NBOUTPUT][CONV2_HEIGHT][CONV2_WIDTH];
+    short pool2_out[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH];
+    short fc1_out  [FC1_NBOUTPUT];
+    short logits   [FC2_NBOUTPUT];
+    int i, z, y, x, ky, kx;
+
+    memset(s, 0, sizeof(*s));
+
+    for (i = 0; i < n; i++) {
+        NormalizeImg_fixed(load(load_arg, i, buf), (short*)input, IMG_WIDTH, IMG_HEIGHT);
+
+        Conv1_28x28x1_5x5x20_1_0_fixed(input, w->conv1_k, w->conv1_b, conv1_out);
+        Pool1_24x24x20_2x2x20_2_0_fixed(conv1_out, pool1_out);
+        Conv2_12x12x20_5x5x40_1_0_fixed(pool1_out, w->conv2_k, w->conv2_b, conv2_out);
+        Pool2_8x8x40_2x2x40_2_0_fixed(conv2_out, pool2_out);
+        Fc1_40_400_fixed(pool2_out, w->fc1_k, w->fc1_b, fc1_out);
+        Fc2_400_10_fixed(fc1_out, w->fc2_k, w->fc2_b, logits);
+
+        /* Conv2 : MACs réels = somme des fenêtres valides des non nuls */
+        for (z = 0; z < POOL1_NBOUTPUT; z++)
+            for (y = 0; y < POOL1_HEIGHT; y++)
+                for (x = 0; x < POOL1_WIDTH; x++) {
+                    if (!pool1_out[z][y][x]) continue;
+                    s->nz[LENET_SP_POOL1]++;
+                    for (ky = 0; ky < CONV2_DIM; ky++)
+                        for (kx = 0; kx < CONV2_DIM; kx++)
+                            if (y - ky >= 0 && y - ky < CONV2_HEIGHT &&
+                                x - kx >= 0 && x - kx < CONV2_WIDTH)
+                                s->macs[LENET_SP_POOL1] += CONV2_NBOUTPUT;
+                }
+
+        for (z = 0; z < FC1_NBINPUT; z++)
+            s->nz[LENET_SP_POOL2] += ((short*)pool2_out)[z] != 0;
+        for (z = 0; z < FC1_NBOUTPUT; z++)
+            s->nz[LENET_SP_FC1] += fc1_out[z] != 0;
+    }
+
+    s->macs[LENET_SP_POOL2] = s->nz[LENET_SP_POOL2] * FC1_NBOUTPUT;
+    s->macs[LENET_SP_FC1]   = s->nz[LENET_SP_FC1] * FC2_NBOUTPUT;
+    s->nb_images = n;
+}
+
+
+void lenet_sparsity_report(const lenet_sparsity_t *s)
+{
+    static const char *name[LENET_SP_COUNT] = { "pool1_out -> Conv2", "pool2_out -> FC1", "fc1_out -> FC2" };
+    static const long  len [LENET_SP_COUNT] = { POOL1_NBOUTPUT * POOL1_HEIGHT * POOL1_WIDTH, FC1_NBINPUT, FC1_NBOUTPUT };
+    static const long  macs[LENET_SP_COUNT] = { CONV2_MACS, FC1_MACS, FC2_MACS };
+    int l;
+
+    if (s->nb_images <= 0)
+        return;
+
+    printf("\nActivation sparsity (%d images)\n", s->nb_images);
+    printf("  %-20s %10s %10s %12s\n", "layer input", "zeros", "nnz/img", "MACs skipped");
+    for (l = 0; l < LENET_SP_COUNT; l++) {
+        double nz   = (double)s->nz[l] / s->nb_images;
+        double done = (double)s->macs[l] / s->nb_images;
+        printf("  %-20s %9.1f%% %10.1f %11.1f%%\n", name[l],
+               100.0 * (1.0 - nz / len[l]), nz, 100.0 * (1.0 - done / macs[l]));
+    }
+}
+
+#endif
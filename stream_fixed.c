@@ -0,0 +1,378 @@
+/**
+  ******************************************************************************
+  * @file    stream_fixed.c
+  * @brief   Streaming top level (HLS DATAFLOW) : layers connected by FIFOs,
+  *          convolutions on line buffers, bit-exact with lenet_cnn_fixed()
+  * @note    Designed for Vivado HLS synthesis (compiled as C++, cf.
+  *          lenet_stream.h) ; sous gcc les FIFOs sont émulées en C.
+  ******************************************************************************
+  */
+
+#include "lenet_cnn_fixed_point.h"
+#include "lenet_stream.h"
+
+
+/* ============================================================================
+ *  Principe
+ * ============================================================================
+ *
+ *  lenet_cnn_fixed() enchaîne les couches sur des tableaux complets : en
+ *  matériel une seule couche travaille à la fois (750 K cycles / image en
+ *  HW_PAR). Ici chaque couche est un processus DATAFLOW qui lit et écrit
+ *  des FIFOs de short, pixel par pixel, canaux entrelacés : ordre (y, x, z).
+ *
+ *    input ─▶ conv1 ─▶ pool1 ─▶ conv2 ─▶ pool2 ─▶ fc1 ─▶ fc2 ─▶ out
+ *
+ *  Les convolutions gardent les CONVx_DIM dernières lignes (line buffer)
+ *  et une fenêtre glissante 5x5 par canal ; les pools une ligne de maxima
+ *  partiels. FC1 est "input stationary" : chaque activation reçue est
+ *  multipliée par ses 400 poids, les 400 sommes sortent à la fin.
+ *
+ *  L'intervalle d'initiation est celui de l'étape la plus lente, pas la
+ *  somme des couches. Estimation avant synthèse (boucles internes 5x5
+ *  déroulées, II=1, FC1 déroulé par FC1_UNROLL) :
+ *
+ *    conv1  576 x 20            ≈  11.5 K cycles
+ *    pool1  24 x 24 x 20        ≈  11.5 K
+ *    conv2  64 x 40 x 20        ≈  51.2 K     ← étape limitante
+ *    pool2  8 x 8 x 40          ≈   2.6 K
+ *    fc1    640 x 400 / 8       ≈  32.0 K
+ *    fc2    400 x 10            ≈   4.0 K
+ *
+ *  soit un II de l'ordre de 50 K cycles (contre 750 K), à confirmer par
+ *  le rapport de synthèse.
+ *
+ *  Les sommes entières portent sur les mêmes produits que les versions
+ *  tableau, dans un autre ordre : résultat bit-exact.
+ */
+
+#define FC1_UNROLL      8       // sorties FC1 mises à jour par cycle
+
+#define S_DEPTH_PIX     2       // profondeurs matérielles des FIFOs
+#define S_DEPTH_C1      40
+#define S_DEPTH_P1      40
+#define S_DEPTH_C2      80
+#define S_DEPTH_P2      80
+#define S_DEPTH_F1      2
+
+
+static inline short relu_fixed(short x)
+{
+    return (x > 0) ? x : 0;
+}
+
+
+/**************************************
+ *  ENTREE : tableau → stream, ordre (y, x, z)
+ **************************************/
+static void stream_input(
+        short input[IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        LENET_STREAM_ARG(out))
+{
+    unsigned short y, x, z;
+
+    for (y = 0; y < IMG_HEIGHT; y++)
+        for (x = 0; x < IMG_WIDTH; x++)
+            for (z = 0; z < IMG_DEPTH; z++) {
+LENET_PRAGMA(HLS PIPELINE II=1)
+                lenet_stream_write(out, input[z][y][x]);
+            }
+}
+
+
+/**************************************
+ *  CONV1 + ReLU  (28×28×1 → 24×24×20)
+ *  lb  : les CONV1_DIM dernières lignes de l'image
+ *  win : fenêtre 5x5 courante, décalée d'une colonne par pixel
+ **************************************/
+static void stream_conv1(
+        LENET_STREAM_ARG(in),
+        short kernel[CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        short bias[CONV1_NBOUTPUT],
+        LENET_STREAM_ARG(out))
+{
+    short lb [IMG_DEPTH][CONV1_DIM][IMG_WIDTH];
+    short win[IMG_DEPTH][CONV1_DIM][CONV1_DIM];
+LENET_PRAGMA(HLS ARRAY_PARTITION variable=lb complete dim=2)
+LENET_PRAGMA(HLS ARRAY_PARTITION variable=win complete dim=0)
+LENET_PRAGMA(HLS ARRAY_PARTITION variable=kernel complete dim=3)
+LENET_PRAGMA(HLS ARRAY_PARTITION variable=kernel complete dim=4)
+    unsigned short y, x, z, k, ky, kx;
+
+    for (z = 0; z < IMG_DEPTH; z++)
+        for (ky = 0; ky < CONV1_DIM; ky++)
+            for (x = 0; x < IMG_WIDTH; x++)
+                lb[z][ky][x] = 0;
+
+    for (y = 0; y < IMG_HEIGHT; y++) {
+        for (x = 0; x < IMG_WIDTH; x++) {
+
+            for (z = 0; z < IMG_DEPTH; z++) {
+LENET_PRAGMA(HLS PIPELINE II=1)
+                short v = lenet_stream_read(in);
+
+                for (ky = 0; ky < CONV1_DIM - 1; ky++)
+                    lb[z][ky][x] = lb[z][ky + 1][x];
+                lb[z][CONV1_DIM - 1][x] = v;
+
+                for (ky = 0; ky < CONV1_DIM; ky++) {
+                    for (kx = 0; kx < CONV1_DIM - 1; kx++)
+                        win[z][ky][kx] = win[z][ky][kx + 1];
+                    win[z][ky][CONV1_DIM - 1] = lb[z][ky][x];
+                }
+            }
+
+            if (y < CONV1_DIM - 1 || x < CONV1_DIM - 1)
+                continue;
+
+            for (k = 0; k < CONV1_NBOUTPUT; k++) {
+LENET_PRAGMA(HLS PIPELINE II=1)
+                int acc = ((int)bias[k]) << FIXED_POINT;
+
+                for (z = 0; z < IMG_DEPTH; z++)
+                    for (ky = 0; ky < CONV1_DIM; ky++)
+                        for (kx = 0; kx < CONV1_DIM; kx++)
+                            acc += (int)win[z][ky][kx] * (int)kernel[k][z][ky][kx];
+
+                acc >>= FIXED_POINT;
+                lenet_stream_write(out, relu_fixed((short)acc));
+            }
+        }
+    }
+}
+
+
+/**************************************
+ *  POOL1  (24×24×20 → 12×12×20)
+ *  Ligne paire : maxima partiels ; ligne impaire : sortie sur x impair
+ **************************************/
+static void stream_pool1(
+        LENET_STREAM_ARG(in),
+        LENET_STREAM_ARG(out))
+{
+    short row[POOL1_WIDTH][CONV1_NBOUTPUT];
+    unsigned short y, x, z;
+
+    for (y = 0; y < CONV1_HEIGHT; y++) {
+        for (x = 0; x < CONV1_WIDTH; x++) {
+            for (z = 0; z < CONV1_NBOUTPUT; z++) {
+LENET_PRAGMA(HLS PIPELINE II=1)
+                short v = lenet_stream_read(in);
+                short m = row[x / POOL1_STRIDE][z];
+
+                if (((y % POOL1_STRIDE) == 0 && (x % POOL1_STRIDE) == 0) || v > m)
+                    m = v;
+                row[x / POOL1_STRIDE][z] = m;
+
+                if ((y % POOL1_STRIDE) == POOL1_STRIDE - 1 && (x % POOL1_STRIDE) == POOL1_STRIDE - 1)
+                    lenet_stream_write(out, m);
+            }
+        }
+    }
+}
+
+
+/**************************************
+ *  CONV2 + ReLU  (12×12×20 → 8×8×40)
+ *  Même schéma que CONV1, une fenêtre 5x5 par canal d'entrée
+ **************************************/
+static void stream_conv2(
+        LENET_STREAM_ARG(in),
+        short kernel[CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short bias[CONV2_NBOUTPUT],
+        LENET_STREAM_ARG(out))
+{
+    short lb [POOL1_NBOUTPUT][CONV2_DIM][POOL1_WIDTH];
+    short win[POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM];
+LENET_PRAGMA(HLS ARRAY_PARTITION variable=lb complete dim=2)
+LENET_PRAGMA(HLS ARRAY_PARTITION variable=win complete dim=2)
+LENET_PRAGMA(HLS ARRAY_PARTITION variable=win complete dim=3)
+LENET_PRAGMA(HLS ARRAY_PARTITION variable=kernel complete dim=3)
+LENET_PRAGMA(HLS ARRAY_PARTITION variable=kernel complete dim=4)
+    unsigned short y, x, z, k, ky, kx;
+
+    for (z = 0; z < POOL1_NBOUTPUT; z++)
+        for (ky = 0; ky < CONV2_DIM; ky++)
+            for (x = 0; x < POOL1_WIDTH; x++)
+                lb[z][ky][x] = 0;
+
+    for (y = 0; y < POOL1_HEIGHT; y++) {
+        for (x = 0; x < POOL1_WIDTH; x++) {
+
+            for (z = 0; z < POOL1_NBOUTPUT; z++) {
+LENET_PRAGMA(HLS PIPELINE II=1)
+                short v = lenet_stream_read(in);
+
+                for (ky = 0; ky < CONV2_DIM - 1; ky++)
+                    lb[z][ky][x] = lb[z][ky + 1][x];
+                lb[z][CONV2_DIM - 1][x] = v;
+
+                for (ky = 0; ky < CONV2_DIM; ky++) {
+                    for (kx = 0; kx < CONV2_DIM - 1; kx++)
+                        win[z][ky][kx] = win[z][ky][kx + 1];
+                    win[z][ky][CONV2_DIM - 1] = lb[z][ky][x];
+                }
+            }
+
+            if (y < CONV2_DIM - 1 || x < CONV2_DIM - 1)
+                continue;
+
+            for (k = 0; k < CONV2_NBOUTPUT; k++) {
+                int acc = ((int)bias[k]) << FIXED_POINT;
+
+                for (z = 0; z < POOL1_NBOUTPUT; z++) {
+LENET_PRAGMA(HLS PIPELINE II=1)
+                    for (ky = 0; ky < CONV2_DIM; ky++)
+                        for (kx = 0; kx < CONV2_DIM; kx++)
+                            acc += (int)win[z][ky][kx] * (int)kernel[k][z][ky][kx];
+                }
+
+                acc >>= FIXED_POINT;
+                lenet_stream_write(out, relu_fixed((short)acc));
+            }
+        }
+    }
+}
+
+
+/**************************************
+ *  POOL2  (8×8×40 → 4×4×40)
+ **************************************/
+static void stream_pool2(
+        LENET_STREAM_ARG(in),
+        LENET_STREAM_ARG(out))
+{
+    short row[POOL2_WIDTH][CONV2_NBOUTPUT];
+    unsigned short y, x, z;
+
+    for (y = 0; y < CONV2_HEIGHT; y++) {
+        for (x = 0; x < CONV2_WIDTH; x++) {
+            for (z = 0; z < CONV2_NBOUTPUT; z++) {
+LENET_PRAGMA(HLS PIPELINE II=1)
+                short v = lenet_stream_read(in);
+                short m = row[x / POOL2_STRIDE][z];
+
+                if (((y % POOL2_STRIDE) == 0 && (x % POOL2_STRIDE) == 0) || v > m)
+                    m = v;
+                row[x / POOL2_STRIDE][z] = m;
+
+                if ((y % POOL2_STRIDE) == POOL2_STRIDE - 1 && (x % POOL2_STRIDE) == POOL2_STRIDE - 1)
+                    lenet_stream_write(out, m);
+            }
+        }
+    }
+}
+
+
+/**************************************
+ *  FC1 + ReLU  (640 → 400), input stationary
+ *  Les activations arrivent en (y, x, z) ; le noyau reste indexé
+ *  [k][z][y][x] comme Fc1_40_400_fixed.
+ **************************************/
+static void stream_fc1(
+        LENET_STREAM_ARG(in),
+        short kernel[FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short bias[FC1_NBOUTPUT],
+        LENET_STREAM_ARG(out))
+{
+    int acc[FC1_NBOUTPUT];
+LENET_PRAGMA(HLS ARRAY_PARTITION variable=acc cyclic factor=FC1_UNROLL)
+LENET_PRAGMA(HLS ARRAY_PARTITION variable=kernel cyclic factor=FC1_UNROLL dim=1)
+    unsigned short y, x, z, k;
+
+    for (k = 0; k < FC1_NBOUTPUT; k++)
+        acc[k] = ((int)bias[k]) << FIXED_POINT;
+
+    for (y = 0; y < POOL2_HEIGHT; y++) {
+        for (x = 0; x < POOL2_WIDTH; x++) {
+            for (z = 0; z < POOL2_NBOUTPUT; z++) {
+                int v = lenet_stream_read(in);
+
+                for (k = 0; k < FC1_NBOUTPUT; k++) {
+LENET_PRAGMA(HLS PIPELINE II=1)
+LENET_PRAGMA(HLS UNROLL factor=FC1_UNROLL)
+                    acc[k] += v * (int)kernel[k][z][y][x];
+                }
+            }
+        }
+    }
+
+    for (k = 0; k < FC1_NBOUTPUT; k++) {
+LENET_PRAGMA(HLS PIPELINE II=1)
+        lenet_stream_write(out, relu_fixed((short)(acc[k] >> FIXED_POINT)));
+    }
+}
+
+
+/**************************************
+ *  FC2  (400 → 10), logits dans le tableau de sortie
+ **************************************/
+static void stream_fc2(
+        LENET_STREAM_ARG(in),
+        short kernel[FC2_NBOUTPUT][FC1_NBOUTPUT],
+        short bias[FC2_NBOUTPUT],
+        short output[FC2_NBOUTPUT])
+{
+    int acc[FC2_NBOUTPUT];
+LENET_PRAGMA(HLS ARRAY_PARTITION variable=acc complete)
+LENET_PRAGMA(HLS ARRAY_PARTITION variable=kernel complete dim=1)
+    unsigned short i, k;
+
+    for (k = 0; k < FC2_NBOUTPUT; k++)
+        acc[k] = ((int)bias[k]) << FIXED_POINT;
+
+    for (i = 0; i < FC1_NBOUTPUT; i++) {
+LENET_PRAGMA(HLS PIPELINE II=1)
+        int v = lenet_stream_read(in);
+
+        for (k = 0; k < FC2_NBOUTPUT; k++)
+            acc[k] += v * (int)kernel[k][i];
+    }
+
+    for (k = 0; k < FC2_NBOUTPUT; k++)
+        output[k] = (short)(acc[k] >> FIXED_POINT);
+}
+
+
+/**************************************
+ *  TOP LEVEL DATAFLOW
+ *  Même interface que lenet_cnn_fixed(). En matériel (ap_ctrl_chain),
+ *  Conv1 démarre l'image i+1 pendant que FC1 termine l'image i.
+ **************************************/
+void lenet_cnn_fixed_stream(
+        short  input   [IMG_DEPTH][IMG_HEIGHT][IMG_WIDTH],
+        short  conv1_k [CONV1_NBOUTPUT][IMG_DEPTH][CONV1_DIM][CONV1_DIM],
+        short  conv1_b [CONV1_NBOUTPUT],
+        short  conv2_k [CONV2_NBOUTPUT][POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM],
+        short  conv2_b [CONV2_NBOUTPUT],
+        short  fc1_k   [FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short  fc1_b   [FC1_NBOUTPUT],
+        short  fc2_k   [FC2_NBOUTPUT][FC1_NBOUTPUT],
+        short  fc2_b   [FC2_NBOUTPUT],
+        short  out     [FC2_NBOUTPUT])
+{
+LENET_PRAGMA(HLS INTERFACE ap_ctrl_chain port=return)
+LENET_PRAGMA(HLS DATAFLOW)
+
+    LENET_STREAM_DECL(s_pix, S_DEPTH_PIX);
+    LENET_STREAM_DECL(s_c1,  S_DEPTH_C1);
+    LENET_STREAM_DECL(s_p1,  S_DEPTH_P1);
+    LENET_STREAM_DECL(s_c2,  S_DEPTH_C2);
+    LENET_STREAM_DECL(s_p2,  S_DEPTH_P2);
+    LENET_STREAM_DECL(s_f1,  S_DEPTH_F1);
+
+    stream_input(input, LENET_STREAM_PASS(s_pix));
+    stream_conv1(LENET_STREAM_PASS(s_pix), conv1_k, conv1_b, LENET_STREAM_PASS(s_c1));
+    stream_pool1(LENET_STREAM_PASS(s_c1), LENET_STREAM_PASS(s_p1));
+    stream_conv2(LENET_STREAM_PASS(s_p1), conv2_k, conv2_b, LENET_STREAM_PASS(s_c2));
+    stream_pool2(LENET_STREAM_PASS(s_c2), LENET_STREAM_PASS(s_p2));
+    stream_fc1(LENET_STREAM_PASS(s_p2), fc1_k, fc1_b, LENET_STREAM_PASS(s_f1));
+    stream_fc2(LENET_STREAM_PASS(s_f1), fc2_k, fc2_b, out);
+
+    LENET_STREAM_FREE(s_pix);
+    LENET_STREAM_FREE(s_c1);
+    LENET_STREAM_FREE(s_p1);
+    LENET_STREAM_FREE(s_c2);
+    LENET_STREAM_FREE(s_p2);
+    LENET_STREAM_FREE(s_f1);
+}
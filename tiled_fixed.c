@@ -0,0 +1,181 @@
+/**
+  ******************************************************************************
+  * @file    tiled_fixed.c
+  * @brief   FC1 by output tiles : burst read of the weights of tile t+1
+  *          into one local buffer while tile t is computed from the other
+  *          (ping-pong), + transfer / overlap model per tile size
+  * @note    Designed for Vivado HLS synthesis ; le rapport est CPU only.
+  ******************************************************************************
+  */
+
+#include "lenet_cnn_fixed_point.h"
+
+
+/* ============================================================================
+ *  Principe
+ * ============================================================================
+ *
+ *  FC1_KERNEL (400 x 640 int16 = 500 Ko) ne tient pas en BRAM sur un
+ *  Zynq-7020 à côté des poids des convolutions. Il reste en DDR (m_axi) ;
+ *  les sorties sont traitées par tuiles de FC1_TILE neurones :
+ *
+ *      charge(0)
+ *      pour t : charge(t+1) -> buf[(t+1)&1]  ||  calcule(t) <- buf[t&1]
+ *
+ *  Les deux appels d'une itération travaillent sur des buffers distincts
+ *  nommés statiquement (ping / pong) : HLS peut les ordonnancer en
+ *  parallèle. Chaque poids est lu une seule fois : 512 000 octets par
+ *  image quelle que soit la tuile ; seule la BRAM occupée en dépend.
+ *
+ *  Chaque sortie est la même somme, dans le même ordre, que
+ *  Fc1_40_400_fixed : bit-exact.
+ */
+
+static inline short relu_fixed(short x)
+{
+    return (x > 0) ? x : 0;
+}
+
+
+/* Burst : FC1_TILE lignes contiguës de kernel vers buf */
+static void fc1_tile_load(
+        short kernel[FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        unsigned short t,
+        short buf[FC1_TILE][FC1_NBINPUT])
+{
+    const short *src = &kernel[t * FC1_TILE][0][0][0];
+    unsigned short j, i;
+
+    for (j = 0; j < FC1_TILE; j++)
+        for (i = 0; i < FC1_NBINPUT; i++) {
+LENET_PRAGMA(HLS PIPELINE II=1)
+            buf[j][i] = src[j * FC1_NBINPUT + i];
+        }
+}
+
+
+static void fc1_tile_compute(
+        const short *in,
+        short buf[FC1_TILE][FC1_NBINPUT],
+        short bias[FC1_NBOUTPUT],
+        unsigned short t,
+        short output[FC1_NBOUTPUT])
+{
+    unsigned short j, i;
+
+    for (j = 0; j < FC1_TILE; j++) {
+        unsigned short k = (unsigned short)(t * FC1_TILE + j);
+        int acc = ((int)bias[k]) << FIXED_POINT;
+
+        for (i = 0; i < FC1_NBINPUT; i++) {
+LENET_PRAGMA(HLS PIPELINE II=1)
+LENET_PRAGMA(HLS UNROLL factor=FC1_TILE_MACS)
+            acc += (int)in[i] * (int)buf[j][i];
+        }
+
+        acc = acc >> FIXED_POINT;
+        output[k] = relu_fixed((short)acc);
+    }
+}
+
+
+/**************************************
+ *  FC1 PAR TUILES (ping-pong)
+ **************************************/
+void Fc1_40_400_fixed_tiled(
+        short input [POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short kernel[FC1_NBOUTPUT][POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH],
+        short bias  [FC1_NBOUTPUT],
+        short output[FC1_NBOUTPUT])
+{
+LENET_PRAGMA(HLS INTERFACE m_axi port=kernel offset=slave depth=LENET_PW_FC1_K)
+    short ping[FC1_TILE][FC1_NBINPUT];
+    short pong[FC1_TILE][FC1_NBINPUT];
+LENET_PRAGMA(HLS ARRAY_PARTITION variable=ping cyclic factor=FC1_TILE_MACS dim=2)
+LENET_PRAGMA(HLS ARRAY_PARTITION variable=pong cyclic factor=FC1_TILE_MACS dim=2)
+    const short *in = &input[0][0][0];
+    unsigned short t;
+
+    fc1_tile_load(kernel, 0, ping);
+
+    for (t = 0; t < FC1_NTILES; t++) {
+        if ((t & 1) == 0) {
+            if (t + 1 < FC1_NTILES)
+                fc1_tile_load(kernel, (unsigned short)(t + 1), pong);
+            fc1_tile_compute(in, ping, bias, t, output);
+        } else {
+            if (t + 1 < FC1_NTILES)
+                fc1_tile_load(kernel, (unsigned short)(t + 1), ping);
+            fc1_tile_compute(in, pong, bias, t, output);
+        }
+    }
+}
+
+
+#ifndef __SYNTHESIS__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/**************************************
+ *  MODELE DE TRANSFERT / RECOUVREMENT
+ *  burst d'une tuile : FC1_AXI_LATENCY + octets / FC1_AXI_BYTES cycles
+ *  calcul d'une tuile : T x FC1_NBINPUT / FC1_TILE_MACS cycles
+ *  série     : N x (burst + calcul)
+ *  ping-pong : burst(0) + (N-1) x max(burst, calcul) + calcul
+ *  masqué    : gain / (N x min(burst, calcul)), 100 % = recouvrement parfait
+ **************************************/
+int lenet_fc1_tiled_report(const lenet_weights_t *w)
+{
+    short input[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH];
+    short ref[FC1_NBOUTPUT], out[FC1_NBOUTPUT];
+    int r, i, t;
+
+    /* noyau compilé contre la référence, activations aléatoires (ReLU : >= 0) */
+    srand(1);
+    for (r = 0; r < 16; r++) {
+        for (i = 0; i < FC1_NBINPUT; i++)
+            (&input[0][0][0])[i] = (short)(rand() % 1024);
+        Fc1_40_400_fixed(input, w->fc1_k, w->fc1_b, ref);
+        Fc1_40_400_fixed_tiled(input, w->fc1_k, w->fc1_b, out);
+        if (memcmp(ref, out, sizeof(ref)) != 0) {
+            printf("ERROR: Fc1_40_400_fixed_tiled (FC1_TILE %d) differs from Fc1_40_400_fixed\n", FC1_TILE);
+            return -1;
+        }
+    }
+
+    printf("\nFC1 tiles (compiled FC1_TILE %d, bit-exact) : %d-byte AXI beats, %d-cycle burst latency, %d MACs/cycle\n",
+           FC1_TILE, FC1_AXI_BYTES, FC1_AXI_LATENCY, FC1_TILE_MACS);
+    printf("  %5s %5s %10s %9s %7s %9s %9s %10s %10s %7s %7s\n",
+           "tile", "tiles", "bytes read", "on-chip", "BRAM18",
+           "burst/t", "calc/t", "serial", "ping-pong", "hidden", "speedup");
+
+    for (t = 1; t <= FC1_NBOUTPUT; t++) {
+        long n, bytes, buf_bytes, bram, load, calc, serial, pp, gain;
+
+        if (FC1_NBOUTPUT % t)
+            continue;
+
+        n         = FC1_NBOUTPUT / t;
+        bytes     = (long)FC1_NBOUTPUT * FC1_NBINPUT * sizeof(short);
+        buf_bytes = 2L * t * FC1_NBINPUT * sizeof(short);
+        bram      = 2L * ((t * FC1_NBINPUT + 1023) / 1024);      // BRAM18 en 1K x 16
+        load      = FC1_AXI_LATENCY + (t * FC1_NBINPUT * (long)sizeof(short) + FC1_AXI_BYTES - 1) / FC1_AXI_BYTES;
+        calc      = ((long)t * FC1_NBINPUT + FC1_TILE_MACS - 1) / FC1_TILE_MACS;
+        serial    = n * (load + calc);
+        pp        = load + (n - 1) * (load > calc ? load : calc) + calc;
+        gain      = serial - pp;
+
+        printf("  %5d %5ld %10ld %8.1fK %7ld %9ld %9ld %10ld %10ld %6.1f%% %6.2fx%s\n",
+               t, n, bytes, buf_bytes / 1024.0, bram, load, calc, serial, pp,
+               100.0 * gain / (n * (load < calc ? load : calc)),
+               (double)serial / pp, (t == FC1_TILE) ? "  <-" : "");
+    }
+    printf("  (full FC1 on chip : %ld BRAM18 out of 280 on a Zynq-7020)\n",
+           (long)((FC1_NBOUTPUT * FC1_NBINPUT + 1023) / 1024));
+    return 0;
+}
+
+#endif
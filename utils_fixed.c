@@ -237,7 +237,7 @@ void ConvertWeightsToFixed(
  * 3) NORMALISATION DES IMAGES MNIST → FIXED POINT
  ****************************************************/
 
-void NormalizeImg_fixed(unsigned char *input, short *output,
+void NormalizeImg_fixed(const unsigned char *input, short *output,
                         short width, short height)
 {
     int size = width * height;
@@ -249,6 +249,29 @@ void NormalizeImg_fixed(unsigned char *input, short *output,
 }
 
 
+#ifndef __SYNTHESIS__
+/* Normalisation repliée dans Conv1 (Conv1_..._u8) : calculé une fois par modèle */
+int lenet_conv1_fold_u8(const lenet_weights_t *w, lenet_conv1_u8_t *f)
+{
+    const short *src = &w->conv1_k[0][0][0][0];
+    short *dst = &f->k[0][0][0][0];
+    int i;
+
+    for (i = 0; i < CONV1_NBOUTPUT * IMG_DEPTH * CONV1_DIM * CONV1_DIM; i++) {
+        long v = (long)src[i] << (FIXED_POINT + CONV1_U8_SHIFT);
+        long q = (v >= 0) ? (v + 127) / 255 : -((-v + 127) / 255);
+        if (q > 32767 || q < -32768)
+            return -1;
+        dst[i] = (short)q;
+    }
+    for (i = 0; i < CONV1_NBOUTPUT; i++)
+        f->b[i] = (int)w->conv1_b[i] << (FIXED_POINT + CONV1_U8_SHIFT);
+
+    return 0;
+}
+#endif
+
+
 
 /****************************************************
  * 4) LECTURE DES IMAGES PGM MNIST
@@ -264,10 +287,11 @@ void ReadPgmFile(char *filename, unsigned char *pix)
 
     char header[10];
     int width, height, max;
-    fscanf(f, "%s", header);
+    fscanf(f, "%9s", header);
     fscanf(f, "%d", &width);
     fscanf(f, "%d", &height);
     fscanf(f, "%d", &max);
+    fgetc(f);               // unique blanc qui sépare maxval des pixels (P5)
 
     for (int i = 0; i < width * height; i++)
         fscanf(f, "%c", &pix[i]);
@@ -0,0 +1,199 @@
+/**
+  ******************************************************************************
+  * @file    weights_blob.c
+  * @brief   Versioned binary weight file : writer + read-only mmap loader
+  * @note    CPU only. Remplace Weights.h à l'exécution : un seul mmap, pas
+  *          d'analyse, pages partagées entre tous les processus.
+  ******************************************************************************
+  */
+
+#ifndef __SYNTHESIS__
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "lenet_cnn_fixed_point.h"
+
+
+/*
+ *  Format (version 1), entiers natifs little-endian :
+ *
+ *    lenet_weights_header_t   (magic, version, FIXED_POINT, table)
+ *    tenseur 0 .. 7           int16, chacun aligné sur 64 octets
+ *
+ *  Ordre des tenseurs : conv1_k, conv1_b, conv2_k, conv2_b,
+ *                       fc1_k, fc1_b, fc2_k, fc2_b
+ *  dims[] = dimensions C du tableau (1 pour les dimensions absentes).
+ */
+
+static const unsigned int tensor_dims[LENET_WEIGHTS_TENSORS][4] = {
+    { CONV1_NBOUTPUT, IMG_DEPTH,      CONV1_DIM,    CONV1_DIM    },
+    { CONV1_NBOUTPUT, 1,              1,            1            },
+    { CONV2_NBOUTPUT, POOL1_NBOUTPUT, CONV2_DIM,    CONV2_DIM    },
+    { CONV2_NBOUTPUT, 1,              1,            1            },
+    { FC1_NBOUTPUT,   POOL2_NBOUTPUT, POOL2_HEIGHT, POOL2_WIDTH  },
+    { FC1_NBOUTPUT,   1,              1,            1            },
+    { FC2_NBOUTPUT,   FC1_NBOUTPUT,   1,            1            },
+    { FC2_NBOUTPUT,   1,              1,            1            },
+};
+
+static unsigned int tensor_count(int t)
+{
+    return tensor_dims[t][0] * tensor_dims[t][1] * tensor_dims[t][2] * tensor_dims[t][3];
+}
+
+static void tensor_ptrs(const lenet_weights_t *w, const short *p[LENET_WEIGHTS_TENSORS])
+{
+    p[0] = &w->conv1_k[0][0][0][0];   p[1] = w->conv1_b;
+    p[2] = &w->conv2_k[0][0][0][0];   p[3] = w->conv2_b;
+    p[4] = &w->fc1_k[0][0][0][0];     p[5] = w->fc1_b;
+    p[6] = &w->fc2_k[0][0];           p[7] = w->fc2_b;
+}
+
+
+/**************************************
+ *  ECRITURE
+ **************************************/
+
+int lenet_weights_save(const char *filename, const lenet_weights_t *w)
+{
+    static const char pad[LENET_WEIGHTS_ALIGN];
+    lenet_weights_header_t h;
+    const short *p[LENET_WEIGHTS_TENSORS];
+    unsigned int off;
+    int t;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, LENET_WEIGHTS_MAGIC, sizeof(h.magic));
+    h.version     = LENET_WEIGHTS_VERSION;
+    h.endian      = 0x01020304;
+    h.fixed_point = FIXED_POINT;
+    h.nb_tensors  = LENET_WEIGHTS_TENSORS;
+
+    off = (sizeof(h) + LENET_WEIGHTS_ALIGN - 1) & ~(LENET_WEIGHTS_ALIGN - 1);
+    for (t = 0; t < LENET_WEIGHTS_TENSORS; t++) {
+        memcpy(h.tensor[t].dims, tensor_dims[t], sizeof(h.tensor[t].dims));
+        h.tensor[t].offset = off;
+        h.tensor[t].count  = tensor_count(t);
+        off += h.tensor[t].count * sizeof(short);
+        off  = (off + LENET_WEIGHTS_ALIGN - 1) & ~(LENET_WEIGHTS_ALIGN - 1);
+    }
+    h.file_size = off;
+
+    FILE *f = fopen(filename, "wb");
+    if (!f) {
+        printf("ERROR: Cannot create %s\n", filename);
+        return -1;
+    }
+
+    tensor_ptrs(w, p);
+
+    long pos = (long)fwrite(&h, 1, sizeof(h), f);
+    for (t = 0; t < LENET_WEIGHTS_TENSORS; t++) {
+        pos += (long)fwrite(pad, 1, h.tensor[t].offset - pos, f);
+        pos += (long)fwrite(p[t], 1, h.tensor[t].count * sizeof(short), f);
+    }
+    pos += (long)fwrite(pad, 1, h.file_size - pos, f);
+
+    if (fclose(f) != 0 || pos != (long)h.file_size) {
+        printf("ERROR: Write error on %s\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+
+/**************************************
+ *  CHARGEMENT (mmap lecture seule)
+ **************************************/
+
+int lenet_weights_map(const char *filename, lenet_weights_blob_t *blob,
+                      lenet_weights_t *w)
+{
+    struct stat st;
+    const lenet_weights_header_t *h;
+    const unsigned char *base;
+    short *p[LENET_WEIGHTS_TENSORS];
+    int t;
+
+    memset(blob, 0, sizeof(*blob));
+    blob->fd = -1;
+
+    blob->fd = open(filename, O_RDONLY);
+    if (blob->fd < 0) {
+        printf("ERROR: Cannot open %s\n", filename);
+        return -1;
+    }
+
+    if (fstat(blob->fd, &st) != 0 || (size_t)st.st_size < sizeof(*h)) {
+        printf("ERROR: %s is not a weight file\n", filename);
+        lenet_weights_unmap(blob);
+        return -1;
+    }
+
+    blob->size = (size_t)st.st_size;
+    blob->map  = mmap(NULL, blob->size, PROT_READ, MAP_SHARED, blob->fd, 0);
+    if (blob->map == MAP_FAILED) {
+        blob->map = NULL;
+        printf("ERROR: Cannot mmap %s\n", filename);
+        lenet_weights_unmap(blob);
+        return -1;
+    }
+
+    base = (const unsigned char*)blob->map;
+    h    = (const lenet_weights_header_t*)base;
+
+    if (memcmp(h->magic, LENET_WEIGHTS_MAGIC, sizeof(h->magic)) != 0 ||
+        h->version != LENET_WEIGHTS_VERSION || h->endian != 0x01020304 ||
+        h->fixed_point != FIXED_POINT || h->nb_tensors != LENET_WEIGHTS_TENSORS ||
+        h->file_size > blob->size) {
+        printf("ERROR: %s : bad header (version %u, Q%u)\n",
+               filename, h->version, h->fixed_point);
+        lenet_weights_unmap(blob);
+        return -1;
+    }
+
+    for (t = 0; t < LENET_WEIGHTS_TENSORS; t++) {
+        if (memcmp(h->tensor[t].dims, tensor_dims[t], sizeof(tensor_dims[t])) != 0 ||
+            h->tensor[t].count != tensor_count(t) ||
+            (h->tensor[t].offset & (LENET_WEIGHTS_ALIGN - 1)) != 0 ||
+            h->tensor[t].offset > h->file_size ||
+            h->tensor[t].count > (h->file_size - h->tensor[t].offset) / sizeof(short)) {
+            printf("ERROR: %s : tensor %d does not match this build\n", filename, t);
+            lenet_weights_unmap(blob);
+            return -1;
+        }
+        p[t] = (short*)(base + h->tensor[t].offset);
+    }
+
+    /* les noyaux ne modifient jamais les poids : pages en lecture seule */
+    lenet_weights_init(w);
+    w->conv1_k = (short (*)[IMG_DEPTH][CONV1_DIM][CONV1_DIM])p[0];
+    w->conv1_b = p[1];
+    w->conv2_k = (short (*)[POOL1_NBOUTPUT][CONV2_DIM][CONV2_DIM])p[2];
+    w->conv2_b = p[3];
+    w->fc1_k   = (short (*)[POOL2_NBOUTPUT][POOL2_HEIGHT][POOL2_WIDTH])p[4];
+    w->fc1_b   = p[5];
+    w->fc2_k   = (short (*)[FC1_NBOUTPUT])p[6];
+    w->fc2_b   = p[7];
+
+    return 0;
+}
+
+
+void lenet_weights_unmap(lenet_weights_blob_t *blob)
+{
+    if (blob->map)
+        munmap(blob->map, blob->size);
+    if (blob->fd >= 0)
+        close(blob->fd);
+
+    memset(blob, 0, sizeof(*blob));
+    blob->fd = -1;
+}
+
+#endif
@@ -0,0 +1,32 @@
+/**
+  ******************************************************************************
+  * @file    weights_export.c
+  * @brief   Converter : Weights.h arrays → binary weight file
+  * @note    gcc -O2 -o weights_export weights_export.c weights_blob.c
+  *          ./weights_export lenet_weights.bin
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+
+#include "lenet_cnn_fixed_point.h"
+#include LENET_WEIGHTS_FILE
+
+
+int main(int argc, char **argv)
+{
+    const char *out = (argc > 1) ? argv[1] : "lenet_weights.bin";
+    lenet_weights_t w;
+
+    lenet_weights_init(&w);
+    w.conv1_k = CONV1_KERNEL;  w.conv1_b = CONV1_BIAS;
+    w.conv2_k = CONV2_KERNEL;  w.conv2_b = CONV2_BIAS;
+    w.fc1_k   = FC1_KERNEL;    w.fc1_b   = FC1_BIAS;
+    w.fc2_k   = FC2_KERNEL;    w.fc2_b   = FC2_BIAS;
+
+    if (lenet_weights_save(out, &w) != 0)
+        return -1;
+
+    printf("Weights written to %s\n", out);
+    return 0;
+}